@@ -30,6 +30,7 @@
 #define TOON_INCLUDE_CHOLESKY_H
 
 #include <TooN/TooN.h>
+#include <TooN/SymmetricMatrix.h>
 
 namespace TooN {
 
@@ -73,11 +74,18 @@ public:
     /// Run time is O(N^3)
 	template<class P2, class B2>
 	Cholesky(const Matrix<Size, Size, P2, B2>& m)
-		: my_cholesky(m) {
-		SizeMismatch<Size,Size>::test(m.num_rows(), m.num_cols());
-		do_compute();
+		: my_cholesky(m.num_rows(), m.num_cols()) {
+		compute(m);
 	}
 	
+	/// Construct the Cholesky decomposition of a packed symmetric matrix.
+	/// Run time is O(N^3)
+	template<class P2>
+	Cholesky(const SymmetricMatrix<Size, P2>& m)
+		: my_cholesky(m.num_rows(), m.num_cols()) {
+		compute(m);
+	}
+
 	/// Constructor for Size=Dynamic
 	Cholesky(int size) : my_cholesky(size,size) {}
 
@@ -87,25 +95,61 @@ public:
 	template<class P2, class B2> void compute(const Matrix<Size, Size, P2, B2>& m){
 		SizeMismatch<Size,Size>::test(m.num_rows(), m.num_cols());
 		SizeMismatch<Size,Size>::test(m.num_rows(), my_cholesky.num_rows());
-		my_cholesky=m;
+		my_cholesky.own(m.num_rows(), m.num_cols()) = m;
 		do_compute();
 	}
+
+	/// Compute the LDL^T decomposition of a packed symmetric matrix.
+	/// The matrix is unpacked into the full sized storage used for the
+	/// factors, so this saves no memory over a full Matrix. Use
+	/// Lapack_Cholesky to keep the factors packed.
+	/// Run time is O(N^3)
+	template<class P2> void compute(const SymmetricMatrix<Size, P2>& m){
+		SizeMismatch<Size,Size>::test(m.num_rows(), my_cholesky.num_rows());
+		const int size = m.num_rows();
+		View chol = my_cholesky.own(size, size);
+		// only the lower half is read by the decomposition
+		for(int row=0; row < size; row++)
+			for(int col=0; col <= row; col++)
+				chol(row,col) = m(col,row);
+		do_compute();
+	}
+
+	/// Compute the LDL^T decomposition of a matrix in place, without copying it.
+	/// The matrix is overwritten by the decomposition, and must remain in existence
+	/// for as long as this object (or any copy of it) is used. If it is not densely
+	/// packed in row major order (like a normal Matrix or the result of wrapMatrix()),
+	/// it is copied instead and left unmodified.
+	/// Run time is O(N^3)
+	template<int R, int C, class B2> void compute_in_place(Matrix<R, C, Precision, B2>& m){
+		SizeMismatch<Size,R>::test(my_cholesky.num_rows(), m.num_rows());
+		SizeMismatch<Size,C>::test(my_cholesky.num_rows(), m.num_cols());
+		my_cholesky.borrow(m);
+		do_compute();
+	}
+
+	///@overload
+	///This allows the result of wrapMatrix() to be used directly.
+	template<int R, int C> void compute_in_place(Matrix<R, C, Precision, Reference::RowMajor> m){
+		compute_in_place<R, C, Reference::RowMajor>(m);
+	}
 	
 	private:
 	void do_compute() {
-		int size=my_cholesky.num_rows();
+		View chol = my_cholesky.view();
+		int size=chol.num_rows();
 		for(int col=0; col<size; col++){
 			Precision inv_diag = 1;
 			for(int row=col; row < size; row++){
 				// correct for the parts of cholesky already computed
-				Precision val = my_cholesky(row,col);
+				Precision val = chol(row,col);
 				for(int col2=0; col2<col; col2++){
-					// val-=my_cholesky(col,col2)*my_cholesky(row,col2)*my_cholesky(col2,col2);
-					val-=my_cholesky(col2,col)*my_cholesky(row,col2);
+					// val-=chol(col,col2)*chol(row,col2)*chol(col2,col2);
+					val-=chol(col2,col)*chol(row,col2);
 				}
 				if(row==col){
 					// this is the diagonal element so don't divide
-					my_cholesky(row,col)=val;
+					chol(row,col)=val;
 					if(val == 0){
 						my_rank = row;
 						return;
@@ -113,9 +157,9 @@ public:
 					inv_diag=1/val;
 				} else {
 					// cache the value without division in the upper half
-					my_cholesky(col,row)=val;
+					chol(col,row)=val;
 					// divide my the diagonal element for all others
-					my_cholesky(row,col)=val*inv_diag;
+					chol(row,col)=val*inv_diag;
 				}
 			}
 		}
@@ -128,7 +172,8 @@ public:
     /// Run time is O(N^2)
 	template<int Size2, class P2, class B2>
 	Vector<Size, Precision> backsub (const Vector<Size2, P2, B2>& v) const {
-		int size=my_cholesky.num_rows();
+		const View chol = my_cholesky.view();
+		int size=chol.num_rows();
 		SizeMismatch<Size,Size2>::test(size, v.size());
 
 		// first backsub through L
@@ -136,14 +181,14 @@ public:
 		for(int i=0; i<size; i++){
 			Precision val = v[i];
 			for(int j=0; j<i; j++){
-				val -= my_cholesky(i,j)*y[j];
+				val -= chol(i,j)*y[j];
 			}
 			y[i]=val;
 		}
 		
 		// backsub through diagonal
 		for(int i=0; i<size; i++){
-			y[i]/=my_cholesky(i,i);
+			y[i]/=chol(i,i);
 		}
 
 		// backsub through L.T()
@@ -151,7 +196,7 @@ public:
 		for(int i=size-1; i>=0; i--){
 			Precision val = y[i];
 			for(int j=i+1; j<size; j++){
-				val -= my_cholesky(j,i)*result[j];
+				val -= chol(j,i)*result[j];
 			}
 			result[i]=val;
 		}
@@ -163,7 +208,8 @@ public:
 	*/
 	template<int Size2, int C2, class P2, class B2>
 	Matrix<Size, C2, Precision> backsub (const Matrix<Size2, C2, P2, B2>& m) const {
-		int size=my_cholesky.num_rows();
+		const View chol = my_cholesky.view();
+		int size=chol.num_rows();
 		SizeMismatch<Size,Size2>::test(size, m.num_rows());
 
 		// first backsub through L
@@ -171,14 +217,14 @@ public:
 		for(int i=0; i<size; i++){
 			Vector<C2, Precision> val = m[i];
 			for(int j=0; j<i; j++){
-				val -= my_cholesky(i,j)*y[j];
+				val -= chol(i,j)*y[j];
 			}
 			y[i]=val;
 		}
 		
 		// backsub through diagonal
 		for(int i=0; i<size; i++){
-			y[i]*=(1/my_cholesky(i,i));
+			y[i]*=(1/chol(i,i));
 		}
 
 		// backsub through L.T()
@@ -186,7 +232,7 @@ public:
 		for(int i=size-1; i>=0; i--){
 			Vector<C2,Precision> val = y[i];
 			for(int j=i+1; j<size; j++){
-				val -= my_cholesky(j,i)*result[j];
+				val -= chol(j,i)*result[j];
 			}
 			result[i]=val;
 		}
@@ -204,9 +250,10 @@ public:
 	
 	///Compute the determinant.
 	Precision determinant(){
-		Precision answer=my_cholesky(0,0);
-		for(int i=1; i<my_cholesky.num_rows(); i++){
-			answer*=my_cholesky(i,i);
+		const View chol = my_cholesky.view();
+		Precision answer=chol(0,0);
+		for(int i=1; i<chol.num_rows(); i++){
+			answer*=chol(i,i);
 		}
 		return answer;
 	}
@@ -217,37 +264,40 @@ public:
 	}
 
 	Matrix<Size,Size,Precision> get_unscaled_L() const {
-		Matrix<Size,Size,Precision> m(my_cholesky.num_rows(),
-					      my_cholesky.num_rows());
+		const View chol = my_cholesky.view();
+		Matrix<Size,Size,Precision> m(chol.num_rows(),
+					      chol.num_rows());
 		m=Identity;
-		for (int i=1;i<my_cholesky.num_rows();i++) {
+		for (int i=1;i<chol.num_rows();i++) {
 			for (int j=0;j<i;j++) {
-				m(i,j)=my_cholesky(i,j);
+				m(i,j)=chol(i,j);
 			}
 		}
 		return m;
 	}
 			
 	Matrix<Size,Size,Precision> get_D() const {
-		Matrix<Size,Size,Precision> m(my_cholesky.num_rows(),
-					      my_cholesky.num_rows());
+		const View chol = my_cholesky.view();
+		Matrix<Size,Size,Precision> m(chol.num_rows(),
+					      chol.num_rows());
 		m=Zeros;
-		for (int i=0;i<my_cholesky.num_rows();i++) {
-			m(i,i)=my_cholesky(i,i);
+		for (int i=0;i<chol.num_rows();i++) {
+			m(i,i)=chol(i,i);
 		}
 		return m;
 	}
 	
 	Matrix<Size,Size,Precision> get_L() const {
 		using std::sqrt;
-		Matrix<Size,Size,Precision> m(my_cholesky.num_rows(),
-					      my_cholesky.num_rows());
+		const View chol = my_cholesky.view();
+		Matrix<Size,Size,Precision> m(chol.num_rows(),
+					      chol.num_rows());
 		m=Zeros;
-		for (int j=0;j<my_cholesky.num_cols();j++) {
-			Precision sqrtd=sqrt(my_cholesky(j,j));
+		for (int j=0;j<chol.num_cols();j++) {
+			Precision sqrtd=sqrt(chol(j,j));
 			m(j,j)=sqrtd;
-			for (int i=j+1;i<my_cholesky.num_rows();i++) {
-				m(i,j)=my_cholesky(i,j)*sqrtd;
+			for (int i=j+1;i<chol.num_rows();i++) {
+				m(i,j)=chol(i,j)*sqrtd;
 			}
 		}
 		return m;
@@ -256,7 +306,8 @@ public:
 	int rank() const { return my_rank; }
 
 private:
-	Matrix<Size,Size,Precision> my_cholesky;
+	typedef typename Internal::FactorStorage<Size,Size,Precision,RowMajor>::View View;
+	Internal::FactorStorage<Size,Size,Precision,RowMajor> my_cholesky;
 	int my_rank;
 };
 
@@ -0,0 +1,310 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_JACOBI_SVD_H
+#define TOON_INCLUDE_JACOBI_SVD_H
+
+#include <TooN/TooN.h>
+#include <cmath>
+#include <limits>
+
+namespace TooN
+{
+	namespace Internal
+	{
+		template<bool StaticBad> struct Jacobi_SVD_needs_static_size;
+
+		///@internal
+		///@brief The sizes of a Jacobi_SVD are OK.
+		///If the sizes are not static, this class is not specified and the
+		///function is therefore not callable, and a compile error results.
+		///@ingroup gInternal
+		template<> struct Jacobi_SVD_needs_static_size<0>
+		{
+			static void check(){} ///<This function does nothing: it merely exists.
+		};
+	}
+
+  /**
+     @class Jacobi_SVD TooN/Jacobi_SVD.h
+     Performs SVD and back substitute to solve equations, using the
+     one-sided Jacobi (Hestenes) method.
+
+     The columns of the matrix are repeatedly orthogonalised against each
+     other by plane rotations, which are accumulated in to V. Once all
+     pairs of columns are orthogonal, the column norms are the singular
+     values and the normalised columns form U.
+
+     This is intended as a drop in replacement for GR_SVD for small
+     matrices of static size (up to about 6x6), such as those which occur
+     in rotation fitting or essential matrix estimation. All loop bounds
+     are compile time constants, so the compiler is free to unroll
+     everything and there is no data dependent reordering. It is also
+     rather more accurate than GR_SVD for the small singular values.
+
+     The accessors are the same as GR_SVD: N singular values are always
+     computed, and they are not sorted unless reorder() is called.
+     If M<N, then at least N-M of the singular values are zero and the
+     corresponding columns of U are zero.
+
+     @param M Number of rows. Must be static.
+     @param N Number of columns. Must be static.
+     @param Precision Precision to perform the decomposition in.
+
+	 @ingroup gDecomps
+  **/
+  template<int M, int N = M, class Precision = DefaultPrecision>
+  class Jacobi_SVD
+  {
+  public:
+
+    /// Construct the %SVD decomposition of a matrix. This initialises the class, and
+    /// performs the decomposition immediately.
+    template<class Precision2, class Base> Jacobi_SVD(const Matrix<M, N, Precision2, Base> &A)
+    {
+      compute(A);
+    }
+
+    /// Compute the %SVD decomposition of another matrix.
+    template<class Precision2, class Base> void compute(const Matrix<M, N, Precision2, Base> &A)
+    {
+      Internal::Jacobi_SVD_needs_static_size<!(M > 0 && N > 0)>::check();
+      mU = A;
+      mV = Identity;
+      Orthogonalize();
+      Normalize();
+    }
+
+    const Matrix<M,N,Precision>& get_U() { return mU;}
+    const Matrix<N,N,Precision>& get_V() { return mV;}
+    const Vector<N, Precision>& get_diagonal() {return vDiagonal;}
+
+    /// Return the number of sweeps over all pairs of columns which were
+    /// required for convergence.
+    int get_sweeps() const { return nSweeps; }
+
+    Precision get_largest_singular_value();
+    Precision get_smallest_singular_value();
+    int get_smallest_singular_value_index();
+
+    ///Return the pesudo-inverse diagonal. The reciprocal of the diagonal elements
+    ///is returned if the elements are well scaled with respect to the largest element,
+    ///otherwise 0 is returned.
+    ///@param inv_diag Vector in which to return the inverse diagonal.
+    ///@param condition Elements must be larger than this factor times the largest diagonal element to be considered well scaled.
+    void get_inv_diag(Vector<N, Precision>& inv_diag, const Precision condition)
+    {
+      Precision dMax = get_largest_singular_value();
+      for(int i=0; i<N; ++i)
+	inv_diag[i] = (vDiagonal[i] * condition > dMax) ?
+	  static_cast<Precision>(1)/vDiagonal[i] : 0;
+    }
+
+    /// Calculate result of multiplying the (pseudo-)inverse of M by another matrix.
+    /// For a matrix \f$A\f$, this calculates \f$M^{\dagger}A\f$ by back substitution
+    /// (i.e. without explictly calculating the (pseudo-)inverse).
+    /// See the detailed description for a description of condition variables.
+    template <int Rows2, int Cols2, typename P2, typename B2>
+    Matrix<N,Cols2, typename Internal::MultiplyType<Precision,P2>::type >
+    backsub(const Matrix<Rows2,Cols2,P2,B2>& rhs, const Precision condition=1e9)
+    {
+      Vector<N,Precision> inv_diag;
+      get_inv_diag(inv_diag,condition);
+      return (get_V() * diagmult(inv_diag, (get_U().T() * rhs)));
+    }
+
+    /// Calculate result of multiplying the (pseudo-)inverse of M by a vector.
+    /// For a vector \f$b\f$, this calculates \f$M^{\dagger}b\f$ by back substitution
+    /// (i.e. without explictly calculating the (pseudo-)inverse).
+    /// See the detailed description for a description of condition variables.
+    template <int Size, typename P2, typename B2>
+    Vector<N, typename Internal::MultiplyType<Precision,P2>::type >
+    backsub(const Vector<Size,P2,B2>& rhs, const Precision condition=1e9)
+    {
+      Vector<N,Precision> inv_diag;
+      get_inv_diag(inv_diag,condition);
+      return (get_V() * diagmult(inv_diag, (get_U().T() * rhs)));
+    }
+
+    /// Get the pseudo-inverse \f$M^{\dagger}\f$
+    Matrix<N,M,Precision> get_pinv(const Precision condition=1e9)
+    {
+      Vector<N,Precision> inv_diag(N);
+      get_inv_diag(inv_diag,condition);
+      return diagmult(get_V(),inv_diag) * get_U().T();
+    }
+
+    /// Reorder the components so the singular values are in descending order.
+    /// This is a selection sort with column swaps, which is cheaper than
+    /// GR_SVD::reorder() for small N since nothing is copied.
+    void reorder();
+
+  protected:
+    void Orthogonalize();
+    void Normalize();
+
+    static const int MaxSweeps = 30;
+
+    Vector<N,Precision> vDiagonal;
+    Matrix<M, N, Precision> mU;
+    Matrix<N, N, Precision> mV;
+    int nSweeps;
+  };
+
+
+  template<int M, int N, class Precision>
+  void Jacobi_SVD<M,N,Precision>::Orthogonalize()
+  {
+    using std::abs;
+    using std::sqrt;
+    const Precision eps = numeric_limits<Precision>::epsilon();
+
+    for(nSweeps=0; nSweeps < MaxSweeps; ++nSweeps)
+      {
+	bool rotated = false;
+	for(int p=0; p<N-1; ++p)
+	  for(int q=p+1; q<N; ++q)
+	    {
+	      // The 2x2 Gram matrix of columns p and q
+	      Precision alpha = 0, beta = 0, gamma = 0;
+	      for(int k=0; k<M; ++k)
+		{
+		  alpha += mU[k][p] * mU[k][p];
+		  beta  += mU[k][q] * mU[k][q];
+		  gamma += mU[k][p] * mU[k][q];
+		}
+
+	      // Columns are already orthogonal to working precision
+	      if(abs(gamma) <= eps * sqrt(alpha * beta))
+		continue;
+	      rotated = true;
+
+	      // Rotation which diagonalises the Gram matrix. The smaller
+	      // root of t^2 + 2 zeta t - 1 = 0 is taken for stability.
+	      const Precision zeta = (beta - alpha) / (2 * gamma);
+	      const Precision t = (zeta >= 0 ? 1 : -1) / (abs(zeta) + sqrt(1 + zeta * zeta));
+	      const Precision c = 1 / sqrt(1 + t * t);
+	      const Precision s = c * t;
+
+	      for(int k=0; k<M; ++k)
+		{
+		  const Precision up = mU[k][p];
+		  const Precision uq = mU[k][q];
+		  mU[k][p] = c * up - s * uq;
+		  mU[k][q] = s * up + c * uq;
+		}
+
+	      for(int k=0; k<N; ++k)
+		{
+		  const Precision vp = mV[k][p];
+		  const Precision vq = mV[k][q];
+		  mV[k][p] = c * vp - s * vq;
+		  mV[k][q] = s * vp + c * vq;
+		}
+	    }
+
+	if(!rotated)
+	  return;
+      }
+  }
+
+  template<int M, int N, class Precision>
+  void Jacobi_SVD<M,N,Precision>::Normalize()
+  {
+    using std::sqrt;
+    for(int j=0; j<N; ++j)
+      {
+	Precision s = 0;
+	for(int k=0; k<M; ++k)
+	  s += mU[k][j] * mU[k][j];
+	vDiagonal[j] = sqrt(s);
+
+	if(vDiagonal[j] != 0)
+	  {
+	    const Precision inv = static_cast<Precision>(1) / vDiagonal[j];
+	    for(int k=0; k<M; ++k)
+	      mU[k][j] *= inv;
+	  }
+      }
+  }
+
+  template<int M, int N, class Precision>
+  Precision Jacobi_SVD<M,N,Precision>::get_largest_singular_value()
+  {
+    using std::max;
+    Precision d = vDiagonal[0];
+    for(int i=1; i<N; ++i) d = max(d, vDiagonal[i]);
+    return d;
+  }
+
+  template<int M, int N, class Precision>
+  Precision Jacobi_SVD<M,N,Precision>::get_smallest_singular_value()
+  {
+    using std::min;
+    Precision d = vDiagonal[0];
+    for(int i=1; i<N; ++i) d = min(d, vDiagonal[i]);
+    return d;
+  }
+
+  template<int M, int N, class Precision>
+  int Jacobi_SVD<M,N,Precision>::get_smallest_singular_value_index()
+  {
+    int nMin=0;
+    Precision d = vDiagonal[0];
+    for(int i=1; i<N; ++i)
+      if(vDiagonal[i] < d)
+	{
+	  d = vDiagonal[i];
+	  nMin = i;
+	}
+    return nMin;
+  }
+
+  template<int M, int N, class Precision>
+  void Jacobi_SVD<M,N,Precision>::reorder()
+  {
+    using std::swap;
+    for(int i=0; i<N-1; ++i)
+      {
+	int nMax = i;
+	for(int j=i+1; j<N; ++j)
+	  if(vDiagonal[j] > vDiagonal[nMax])
+	    nMax = j;
+
+	if(nMax == i)
+	  continue;
+
+	swap(vDiagonal[i], vDiagonal[nMax]);
+	for(int k=0; k<M; ++k)
+	  swap(mU[k][i], mU[k][nMax]);
+	for(int k=0; k<N; ++k)
+	  swap(mV[k][i], mV[k][nMax]);
+      }
+  }
+
+}
+#endif
@@ -61,6 +61,9 @@ It can be used as follows to solve the \f$M\underline{x} = \underline{c}\f$ prob
 @endcode
 The convention LU<> (=LU<-1>) is used to create an LU decomposition whose size is 
 determined at runtime.
+
+Note that get_lu() returns a Reference view rather than a const reference to
+a Matrix, so that the factors can live in a matrix supplied to compute_in_place().
 @ingroup gDecomps
 **/
 template <int Size=-1, class Precision=double>
@@ -74,6 +77,13 @@ class LU {
 	:my_lu(m.num_rows(),m.num_cols()),my_IPIV(m.num_rows()){
 		compute(m);
 	}
+
+	/// Default constructor for Size>0. Use compute() to perform the decomposition.
+	LU():my_info(0){}
+
+	/// Constructor for Size=Dynamic. Use compute() to perform the decomposition.
+	LU(int size)
+	:my_lu(size,size),my_info(0),my_IPIV(size){}
 	
 	/// Perform the %LU decompsition of another matrix.
 	template<int S1, int S2, class Base>
@@ -83,17 +93,43 @@ class LU {
 		SizeMismatch<Size, S2>::test(my_lu.num_rows(),m.num_cols());
 	
 		//Make a local copy. This is guaranteed contiguous
-		my_lu=m;
-		FortranInteger lda = m.num_rows();
-		FortranInteger M = m.num_rows();
-		FortranInteger N = m.num_rows();
+		my_lu.own(m.num_rows(), m.num_cols()) = m;
+		do_compute();
+	}
 
-		getrf_(&M,&N,&my_lu[0][0],&lda,&my_IPIV[0],&my_info);
+	/// Perform the %LU decomposition of a matrix in place, without copying it.
+	/// The matrix is overwritten by the decomposition, and must remain in existence
+	/// for as long as this object (or any copy of it) is used. If it is not densely
+	/// packed in row major order (like a normal Matrix or the result of wrapMatrix()),
+	/// it is copied instead and left unmodified.
+	template<int S1, int S2, class Base>
+	void compute_in_place(Matrix<S1,S2,Precision,Base>& m){
+		SizeMismatch<Size, S1>::test(my_lu.num_rows(),m.num_rows());
+		SizeMismatch<Size, S2>::test(my_lu.num_rows(),m.num_cols());
+		my_lu.borrow(m);
+		do_compute();
+	}
+
+	///@overload
+	///This allows the result of wrapMatrix() to be used directly.
+	template<int S1, int S2>
+	void compute_in_place(Matrix<S1,S2,Precision,Reference::RowMajor> m){
+		compute_in_place<S1, S2, Reference::RowMajor>(m);
+	}
+
+	private:
+	void do_compute(){
+		FortranInteger lda = my_lu.num_rows();
+		FortranInteger M = my_lu.num_rows();
+		FortranInteger N = my_lu.num_rows();
+
+		getrf_(&M,&N,&my_lu.view()[0][0],&lda,&my_IPIV[0],&my_info);
 
 		if(my_info < 0){
 			std::cerr << "error in LU, INFO was " << my_info << std::endl;
 		}
 	}
+	public:
 
 	/// Calculate result of multiplying the inverse of M by another matrix. For a matrix \f$A\f$, this
 	/// calculates \f$M^{-1}A\f$ by back substitution (i.e. without explictly calculating the inverse).
@@ -106,11 +142,11 @@ class LU {
 
 		FortranInteger M=rhs.num_cols();
 		FortranInteger N=my_lu.num_rows();
-		double alpha=1;
+		Precision alpha=1;
 		FortranInteger lda=my_lu.num_rows();
 		FortranInteger ldb=rhs.num_cols();
-		trsm_("R","U","N","N",&M,&N,&alpha,&my_lu[0][0],&lda,&result[0][0],&ldb);
-		trsm_("R","L","N","U",&M,&N,&alpha,&my_lu[0][0],&lda,&result[0][0],&ldb);
+		trsm_("R","U","N","N",&M,&N,&alpha,&my_lu.view()[0][0],&lda,&result[0][0],&ldb);
+		trsm_("R","L","N","U",&M,&N,&alpha,&my_lu.view()[0][0],&lda,&result[0][0],&ldb);
 
 		// now do the row swapping (lapack dlaswp.f only shuffles fortran rows = Rowmajor cols)
 		for(int i=N-1; i>=0; i--){
@@ -135,11 +171,11 @@ class LU {
 
 		FortranInteger M=1;
 		FortranInteger N=my_lu.num_rows();
-		double alpha=1;
+		Precision alpha=1;
 		FortranInteger lda=my_lu.num_rows();
 		FortranInteger ldb=1;
-		trsm_("R","U","N","N",&M,&N,&alpha,&my_lu[0][0],&lda,&result[0],&ldb);
-		trsm_("R","L","N","U",&M,&N,&alpha,&my_lu[0][0],&lda,&result[0],&ldb);
+		trsm_("R","U","N","N",&M,&N,&alpha,&my_lu.view()[0][0],&lda,&result[0],&ldb);
+		trsm_("R","L","N","U",&M,&N,&alpha,&my_lu.view()[0][0],&lda,&result[0],&ldb);
 
 		// now do the row swapping (lapack dlaswp.f only shuffles fortran rows = Rowmajor cols)
 		for(int i=N-1; i>=0; i--){
@@ -154,7 +190,7 @@ class LU {
 	/// Calculate inverse of the matrix. This is not usually needed: if you need the inverse just to 
 	/// multiply it by a matrix or a vector, use one of the backsub() functions, which will be faster.
 	Matrix<Size,Size,Precision> get_inverse(){
-		Matrix<Size,Size,Precision> Inverse(my_lu);
+		Matrix<Size,Size,Precision> Inverse(my_lu.view());
 		FortranInteger N = my_lu.num_rows();
 		FortranInteger lda=my_lu.num_rows();
 		FortranInteger lwork=-1;
@@ -172,7 +208,13 @@ class LU {
 	/// and U is upper-triangular, these are returned conflated into one matrix, where the 
 	/// diagonal and above parts of the matrix are U and the below-diagonal part, plus a unit diagonal, 
 	/// are L.
-	const Matrix<Size,Size,Precision>& get_lu()const {return my_lu;}
+	///
+	/// The result is a Reference view onto the factors, which may be the memory of a
+	/// matrix passed to compute_in_place(). Earlier versions of TooN returned
+	/// <code>const Matrix<Size,Size,Precision>&</code>. Code which copies the result, or
+	/// binds it to a const reference, is unaffected. Code which keeps a pointer or
+	/// reference to the result must now keep the view, or a copy, instead.
+	const Matrix<Size,Size,Precision,Reference::RowMajor> get_lu()const {return my_lu.view();}
 	
 	private:
 	inline int get_sign() const {
@@ -190,7 +232,7 @@ class LU {
 	inline Precision determinant() const {
 		Precision result = get_sign();
 		for (int i=0; i<my_lu.num_rows(); i++){
-			result*=my_lu(i,i);
+			result*=my_lu.view()(i,i);
 		}
 		return result;
 	}
@@ -200,7 +242,7 @@ class LU {
 
  private:
 
-	Matrix<Size,Size,Precision> my_lu;
+	Internal::FactorStorage<Size,Size,Precision,RowMajor> my_lu;
 	FortranInteger my_info;
 	Vector<Size, FortranInteger> my_IPIV;	//Convenient static-or-dynamic array of ints :-)
 
@@ -32,8 +32,10 @@
 #include <TooN/TooN.h>
 
 #include <TooN/lapack.h>
+#include <TooN/SymmetricMatrix.h>
 
 #include <assert.h>
+#include <vector>
 
 namespace TooN {
 
@@ -63,6 +65,9 @@ Cholesky decomposition of a symmetric matrix.
 Only the lower half of the matrix is considered
 This uses the non-sqrt version of the decomposition
 giving symmetric M = L*D*L.T() where the diagonal of L contains ones
+
+A SymmetricMatrix is factored in packed storage (LAPACK's pptrf), so the
+decomposition only needs half the memory of a full matrix.
 @param Size the size of the matrix
 @param Precision the precision of the entries in the matrix and its decomposition
 **/
@@ -70,74 +75,105 @@ template <int Size, typename Precision=DefaultPrecision>
 class Lapack_Cholesky {
 public:
 
-    Lapack_Cholesky(){}
+    Lapack_Cholesky():my_rank(0){}
 	
 	template<class P2, class B2>
 	Lapack_Cholesky(const Matrix<Size, Size, P2, B2>& m) 
-	  : my_cholesky(m), my_cholesky_lapack(m) {
-		SizeMismatch<Size,Size>::test(m.num_rows(), m.num_cols());
-		do_compute();
+	  : my_cholesky_lapack(m.num_rows(), m.num_cols()) {
+		compute(m);
+	}
+
+	/// Construct the decomposition of a packed symmetric matrix.
+	template<class P2>
+	Lapack_Cholesky(const SymmetricMatrix<Size, P2>& m)
+	  : my_cholesky_lapack(m.num_rows(), m.num_cols()) {
+		compute(m);
 	}
 
 	/// Constructor for Size=Dynamic
-	Lapack_Cholesky(int size) : my_cholesky(size,size), my_cholesky_lapack(size,size) {}
+	Lapack_Cholesky(int size) : my_cholesky_lapack(size,size), my_rank(0) {}
 
 	template<class P2, class B2> void compute(const Matrix<Size, Size, P2, B2>& m){
 		SizeMismatch<Size,Size>::test(m.num_rows(), m.num_cols());
-		SizeMismatch<Size,Size>::test(m.num_rows(), my_cholesky.num_rows());
-		my_cholesky_lapack=m;
+		SizeMismatch<Size,Size>::test(m.num_rows(), my_cholesky_lapack.num_rows());
+		my_packed.clear();
+		my_cholesky_lapack.own(m.num_rows(), m.num_cols())=m;
 		do_compute();
 	}
 
+	/// Compute the decomposition of a packed symmetric matrix. The factor is
+	/// kept in packed form too, using pptrf, so only half the memory of the
+	/// full matrix is needed. Note that pptrf is unblocked, so for large
+	/// matrices it is slower than factoring a full Matrix.
+	template<class P2> void compute(const SymmetricMatrix<Size, P2>& m){
+		SizeMismatch<Size,Size>::test(m.num_rows(), my_cholesky_lapack.num_rows());
+		if(my_packed.empty())
+			my_packed.assign(1, SymmetricMatrix<Size, Precision>(m.num_rows()));
+		// the packed upper half in row major order is LAPACK's packed lower half
+		my_packed[0].get_packed() = m.get_packed();
+		FortranInteger N = m.num_rows();
+		FortranInteger info;
+		pptrf_("L", &N, &my_packed[0].get_packed()[0], &info);
+		set_rank(info);
+	}
+
+	/// Compute the decomposition of a matrix in place, without copying it.
+	/// The upper half of the matrix is overwritten by the decomposition,
+	/// and the matrix must remain in existence for as long as this object
+	/// (or any copy of it) is used. If it is not densely packed in row major
+	/// order (like a normal Matrix or the result of wrapMatrix()), it is
+	/// copied instead and left unmodified.
+	template<int R, int C, class B2> void compute_in_place(Matrix<R, C, Precision, B2>& m){
+		SizeMismatch<Size,R>::test(my_cholesky_lapack.num_rows(), m.num_rows());
+		SizeMismatch<Size,C>::test(my_cholesky_lapack.num_rows(), m.num_cols());
+		my_packed.clear();
+		my_cholesky_lapack.borrow(m);
+		do_compute();
+	}
 
+	///@overload
+	///This allows the result of wrapMatrix() to be used directly.
+	template<int R, int C> void compute_in_place(Matrix<R, C, Precision, Reference::RowMajor> m){
+		compute_in_place<R, C, Reference::RowMajor>(m);
+	}
 
 	void do_compute(){
-		FortranInteger N = my_cholesky.num_rows();
+		FortranInteger N = my_cholesky_lapack.num_rows();
 		FortranInteger info;
-		potrf_("L", &N, my_cholesky_lapack.my_data, &N, &info);
-		for (int i=0;i<N;i++) {
-		  int j;
-		  for (j=0;j<=i;j++) {
-		    my_cholesky[i][j]=my_cholesky_lapack[j][i];
-		  }
-		  // LAPACK does not set upper triangle to zero, 
-		  // must be done here
-		  for (;j<N;j++) {
-		    my_cholesky[i][j]=0;
-		  }
-		}
-		assert(info >= 0);
-		if (info > 0) {
-			my_rank = info-1;
-		} else {
-		    my_rank = N;
-		}
+		potrf_("L", &N, my_cholesky_lapack.view().my_data, &N, &info);
+		set_rank(info);
 	}
 
 	int rank() const { return my_rank; }
 
 	template <int Size2, typename P2, typename B2>
 		Vector<Size, Precision> backsub (const Vector<Size2, P2, B2>& v) const {
-		SizeMismatch<Size,Size2>::test(my_cholesky.num_cols(), v.size());
+		SizeMismatch<Size,Size2>::test(my_cholesky_lapack.num_cols(), v.size());
 
 		Vector<Size, Precision> result(v);
-		FortranInteger N=my_cholesky.num_rows();
+		FortranInteger N=my_cholesky_lapack.num_rows();
 		FortranInteger NRHS=1;
 		FortranInteger info;
-		potrs_("L", &N, &NRHS, my_cholesky_lapack.my_data, &N, result.my_data, &N, &info);     
+		if(is_packed())
+			pptrs_("L", &N, &NRHS, &my_packed[0].get_packed()[0], result.my_data, &N, &info);
+		else
+			potrs_("L", &N, &NRHS, my_cholesky_lapack.view().my_data, &N, result.my_data, &N, &info);     
 		assert(info==0);
 		return result;
 	}
 
 	template <int Size2, int Cols2, typename P2, typename B2>
 		Matrix<Size, Cols2, Precision, ColMajor> backsub (const Matrix<Size2, Cols2, P2, B2>& m) const {
-		SizeMismatch<Size,Size2>::test(my_cholesky.num_cols(), m.num_rows());
+		SizeMismatch<Size,Size2>::test(my_cholesky_lapack.num_cols(), m.num_rows());
 
 		Matrix<Size, Cols2, Precision, ColMajor> result(m);
-		FortranInteger N=my_cholesky.num_rows();
+		FortranInteger N=my_cholesky_lapack.num_rows();
 		FortranInteger NRHS=m.num_cols();
 		FortranInteger info;
-		potrs_("L", &N, &NRHS, my_cholesky_lapack.my_data, &N, result.my_data, &N, &info);     
+		if(is_packed())
+			pptrs_("L", &N, &NRHS, &my_packed[0].get_packed()[0], result.my_data, &N, &info);
+		else
+			potrs_("L", &N, &NRHS, my_cholesky_lapack.view().my_data, &N, result.my_data, &N, &info);     
 		assert(info==0);
 		return result;
 	}
@@ -148,20 +184,42 @@ public:
 	}
 
 	Matrix<Size,Size,Precision> get_L() const {
-		return my_cholesky;
+		const int N = my_cholesky_lapack.num_rows();
+		Matrix<Size,Size,Precision> L(N, N);
+		for (int i=0;i<N;i++) {
+		  int j;
+		  for (j=0;j<=i;j++) {
+		    L[i][j]=factor(j,i);
+		  }
+		  // LAPACK does not set upper triangle to zero, 
+		  // must be done here
+		  for (;j<N;j++) {
+		    L[i][j]=0;
+		  }
+		}
+		return L;
 	}
 
 	Precision determinant() const {
-		Precision det = my_cholesky[0][0];
-		for (int i=1; i<my_cholesky.num_rows(); i++)
-			det *= my_cholesky[i][i];
+		Precision det = factor(0,0);
+		for (int i=1; i<my_cholesky_lapack.num_rows(); i++)
+			det *= factor(i,i);
 		return det*det;
 	}
 
 	Matrix<> get_inverse() const {
-		Matrix<Size, Size, Precision> M(my_cholesky.num_rows(),my_cholesky.num_rows());
-		M=my_cholesky_lapack;
-		FortranInteger N = my_cholesky.num_rows();
+		if(is_packed()) {
+			SymmetricMatrix<Size, Precision> P = my_packed[0];
+			FortranInteger N = P.num_rows();
+			FortranInteger info;
+			pptri_("L", &N, &P.get_packed()[0], &info);
+			assert(info == 0);
+			return P.get_matrix();
+		}
+
+		Matrix<Size, Size, Precision> M(my_cholesky_lapack.num_rows(),my_cholesky_lapack.num_rows());
+		M=my_cholesky_lapack.view();
+		FortranInteger N = my_cholesky_lapack.num_rows();
 		FortranInteger info;
 		potri_("L", &N, M.my_data, &N, &info);
 		assert(info == 0);
@@ -174,8 +232,24 @@ public:
 	}
 
 private:
-	Matrix<Size,Size,Precision> my_cholesky;     
-	Matrix<Size,Size,Precision> my_cholesky_lapack;     
+	void set_rank(FortranInteger info){
+		assert(info >= 0);
+		if (info > 0) {
+			my_rank = info-1;
+		} else {
+		    my_rank = my_cholesky_lapack.num_rows();
+		}
+	}
+
+	bool is_packed() const { return !my_packed.empty(); }
+
+	//Element (r,c), r <= c, of the factor in row major order, ie L[c][r]
+	Precision factor(int r, int c) const {
+		return is_packed() ? my_packed[0](r,c) : my_cholesky_lapack.view()[r][c];
+	}
+
+	Internal::FactorStorage<Size,Size,Precision,RowMajor> my_cholesky_lapack;
+	std::vector<SymmetricMatrix<Size, Precision> > my_packed; //Holds the factor instead, when computed from a SymmetricMatrix
 	FortranInteger my_rank;
 };
 
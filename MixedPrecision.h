@@ -0,0 +1,199 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_MIXED_PRECISION_H
+#define TOON_INCLUDE_MIXED_PRECISION_H
+
+#include <TooN/TooN.h>
+#include <TooN/helpers.h>
+#include <TooN/LU.h>
+#include <cmath>
+#include <limits>
+#include <vector>
+
+namespace TooN {
+
+/**
+Solves \f$A\underline{x} = \underline{b}\f$ by factoring \f$A\f$ in low precision
+(float), and then refining the solution by iterative refinement with the
+residuals computed in high precision (double).
+
+For well conditioned matrices, this gives solutions as accurate as a double
+precision decomposition, but the \f$O(N^3)\f$ factorization runs in single
+precision, which is roughly twice as fast and moves half as much memory.
+Each refinement step costs only \f$O(N^2)\f$.
+
+If the refinement does not converge to double precision accuracy (which
+happens when the matrix is too badly conditioned for a single precision
+factorization to be of any use) then the matrix is automatically
+factored again in double precision and that is used from then on. This
+follows LAPACK's DSGESV and DSPOSV.
+
+The decomposition can be any class which can be constructed with a size,
+and provides compute() and backsub(), for instance LU or Lapack_Cholesky
+(for symmetric positive definite matrices).
+@code
+  Matrix<> A = ...;
+  Vector<> b = ...;
+  MixedPrecision<> mp(A);
+  Vector<> x = mp.backsub(b);
+
+  MixedPrecision<Dynamic, Lapack_Cholesky> mpc(A); //A is SPD
+  Vector<> x2 = mpc.backsub(b);
+@endcode
+
+Note that a copy of \f$A\f$ is kept, since it is required for computing
+the residuals. The double precision decomposition is only created if the
+fallback is needed.
+
+@param Size The size of the matrix
+@param Decomposition The decomposition to use (LU by default)
+@param Precision The high precision type
+@param LowPrecision The low precision type used for the factorization
+@ingroup gDecomps
+**/
+template<int Size=Dynamic, template<int DecompSize, class DecompPrecision> class Decomposition = LU,
+         class Precision=double, class LowPrecision=float>
+class MixedPrecision {
+public:
+
+	/// Construct the decomposition of a matrix. This initialises the class, and
+	/// performs the decomposition immediately.
+	template<int R, int C, class P2, class B2>
+	MixedPrecision(const Matrix<R, C, P2, B2>& m)
+	:my_matrix(m.num_rows(), m.num_cols()), my_low(m.num_rows())
+	{
+		init();
+		compute(m);
+	}
+
+	/// Constructor for Size=Dynamic. Use compute() to perform the decomposition.
+	MixedPrecision(int size=Size)
+	:my_matrix(size, size), my_low(size)
+	{
+		init();
+	}
+
+	/// Perform the decomposition of another matrix.
+	template<int R, int C, class P2, class B2>
+	void compute(const Matrix<R, C, P2, B2>& m)
+	{
+		SizeMismatch<Size, R>::test(my_matrix.num_rows(), m.num_rows());
+		SizeMismatch<Size, C>::test(my_matrix.num_cols(), m.num_cols());
+
+		my_matrix = m;
+		my_norm = norm_inf(my_matrix);
+		my_use_high = false;
+		my_iterations = 0;
+		my_high.clear();
+
+		const Matrix<Size, Size, LowPrecision> low = my_matrix;
+		my_low.compute(low);
+	}
+
+	/// Calculate result of multiplying the inverse of M by a vector. For a vector \f$b\f$, this
+	/// calculates \f$M^{-1}b\f$ by back substitution and iterative refinement.
+	template<int Size2, class P2, class B2>
+	Vector<Size, Precision> backsub(const Vector<Size2, P2, B2>& b)
+	{
+		using std::sqrt;
+		SizeMismatch<Size, Size2>::test(my_matrix.num_rows(), b.size());
+
+		if(my_use_high)
+			return my_high[0].backsub(Vector<Size, Precision>(b));
+
+		const Precision eps = numeric_limits<Precision>::epsilon();
+		const Precision tolerance = eps * sqrt(Precision(my_matrix.num_rows())) * my_norm;
+
+		Vector<Size, Precision> x = my_low.backsub(Vector<Size, LowPrecision>(b));
+
+		for(my_iterations=0; my_iterations < max_iterations; my_iterations++)
+		{
+			const Vector<Size, Precision> r = b - my_matrix * x;
+
+			//Written this way round so that NaNs from a failed factorization
+			//cause a fallback.
+			if(norm_inf(r) <= norm_inf(x) * tolerance)
+				return x;
+			else if(!(norm_inf(r) < numeric_limits<Precision>::max()))
+				break;
+
+			x += my_low.backsub(Vector<Size, LowPrecision>(r));
+		}
+
+		//The refinement did not converge, so do things the slow way.
+		//The high precision decomposition is only created here, so that
+		//it does not take up memory in the usual case.
+		my_use_high = true;
+		my_high.clear();
+		my_high.push_back(Decomposition<Size, Precision>(my_matrix));
+		return my_high[0].backsub(Vector<Size, Precision>(b));
+	}
+
+	/// Calculate result of multiplying the inverse of M by another matrix. For a matrix \f$A\f$, this
+	/// calculates \f$M^{-1}A\f$ by back substitution and iterative refinement, one column at a time.
+	template<int Rows2, int Cols2, class P2, class B2>
+	Matrix<Size, Cols2, Precision> backsub(const Matrix<Rows2, Cols2, P2, B2>& b)
+	{
+		SizeMismatch<Size, Rows2>::test(my_matrix.num_rows(), b.num_rows());
+		Matrix<Size, Cols2, Precision> result(b.num_rows(), b.num_cols());
+		for(int c=0; c < b.num_cols(); c++)
+			result.T()[c] = backsub(b.T()[c]);
+		return result;
+	}
+
+	/// Has the refinement failed, so that the double precision decomposition
+	/// is now being used?
+	bool is_high_precision() const { return my_use_high; }
+
+	/// The number of refinement iterations used by the last call to backsub().
+	int get_iterations() const { return my_iterations; }
+
+	/// Return the low precision decomposition
+	Decomposition<Size, LowPrecision>& get_low_decomposition() { return my_low; }
+
+	int max_iterations; ///< Maximum number of refinement steps before the fallback is used. Defaults to 30.
+
+private:
+	void init()
+	{
+		max_iterations = 30;
+		my_use_high = false;
+		my_iterations = 0;
+	}
+
+	Matrix<Size, Size, Precision> my_matrix;
+	Decomposition<Size, LowPrecision> my_low;
+	std::vector<Decomposition<Size, Precision> > my_high; //Empty unless the fallback is in use
+	Precision my_norm;
+	bool my_use_high;
+	int my_iterations;
+};
+
+}
+
+#endif
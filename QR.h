@@ -30,6 +30,8 @@
 #define TOON_INC_QR_H
 #include <TooN/TooN.h>
 #include <cmath>
+#include <limits>
+#include <algorithm>
 
 namespace TooN
 {
@@ -79,6 +81,32 @@ template<int Rows=Dynamic, int Cols=Rows, typename Precision=double> class QR
 			return Q;
 		}	
 
+		/// Compute the basic solution of \f$Ax = b\f$. Since A is wide, this
+		/// is the solution where the last \f$n-m\f$ variables are zero. This computes
+		/// \f$ x = R^{-1}Q^Tb \f$ using back substitution on R. If a diagonal
+		/// element of R is negligible (A is rank deficient), the corresponding
+		/// variable is set to zero instead of being divided by it.
+		///@param b Right hand side, with \f$m\f$ elements.
+		template<int Size, class P2, class B2> 
+		Vector<Cols, Precision> backsub(const Vector<Size, P2, B2>& b)
+		{
+			SizeMismatch<Rows, Size>::test(m.num_rows(), b.size());
+			const Vector<square_Size, Precision> c = Q.T() * b;
+
+			Precision largest = 0;
+			for(int i=0; i < square_size(); i++)
+				largest = std::max(largest, std::abs(m[i][i]));
+			const Precision tol = std::numeric_limits<Precision>::epsilon() * std::max(m.num_rows(), m.num_cols()) * largest;
+
+			Vector<Cols, Precision> x(m.num_cols());
+			x = Zeros;
+			for(int i=square_size()-1; i >= 0; i--)
+				if(std::abs(m[i][i]) > tol)
+					x[i] = (c[i] - m[i].slice(i+1, square_size()-i-1) * x.slice(i+1, square_size()-i-1)) / m[i][i];
+
+			return x;
+		}
+
 	private:
 
 		template<class B1, class B2>		
@@ -233,6 +261,383 @@ template<int Rows=Dynamic, int Cols=Rows, typename Precision=double> class QR
 
 
 
+/**
+Performs blocked %QR decomposition using the compact WY representation.
+
+Unlike QR, this works on matrices of any shape, and is intended for tall
+matrices with many more rows than columns. It computes the economy sized
+decomposition:
+\f[
+A = QR
+\f]
+where, if A is \f$m\times n\f$ and \f$k = \min(m,n)\f$, \f$Q\f$ is
+\f$m\times k\f$ with orthonormal columns and \f$R\f$ is \f$k\times n\f$ and
+upper triangular. If A is wide (the only case supported by QR) then these
+are the same as the matrices computed by QR.
+
+The least squares solution of \f$Ax = b\f$ can be found with backsub().
+
+The Householder reflectors are grouped in to panels of BlockSize columns.
+Each panel of reflectors is represented as \f$ I - VTV^T\f$, where \f$V\f$ holds
+the reflectors and \f$T\f$ is a small upper triangular matrix, so the update
+of the remainder of the matrix consists of matrix-matrix products rather
+than one rank-1 update per column.
+
+\f$Q\f$ is kept implicitly as the reflectors. It is never formed unless
+get_Q() is called, so for a \f$ 10000\times 50\f$ matrix, use apply_QT() and
+apply_Q() to multiply by \f$Q^T\f$ and \f$Q\f$ without ever forming it.
+
+@param Rows Number of rows
+@param Cols Number of columns
+@param Precision Precision to perform the decomposition in
+@param BlockSize Number of reflectors in each panel
+
+@ingroup gDecomps
+*/
+template<int Rows=Dynamic, int Cols=Rows, typename Precision=double, int BlockSize=16> class QR_Blocked
+{
+	private:
+		static const int square_Size = (Rows>=0 && Cols>=0)?(Rows<Cols?Rows:Cols):Dynamic;
+
+	public:
+		/// Construct the %QR decomposition of a matrix. This initialises the class, and
+		/// performs the decomposition immediately.
+		/// @param m The matrix to decompose
+		template<int R, int C, class P, class B> 
+		QR_Blocked(const Matrix<R,C,P,B>& m)
+		:my_qr(m), my_tau(square_size()), 
+		 my_T(std::min(BlockSize, square_size()), square_size()),
+		 my_R(square_size(), m.num_cols())
+		{
+			compute();
+		}
+
+		///Return R. This is \f$k\times n\f$.
+		const Matrix<square_Size, Cols, Precision>& get_R()
+		{
+			return my_R;
+		}
+
+		///Return Q. This is \f$m\times k\f$. Q is formed from the reflectors each time
+		///this is called, so if Q is only needed in order to multiply it by something,
+		///use apply_Q() or apply_QT() instead.
+		Matrix<Rows, square_Size, Precision, ColMajor> get_Q()
+		{
+			Matrix<Rows, square_Size, Precision, ColMajor> Q(my_qr.num_rows(), square_size());
+			Q = Zeros;
+			for(int i=0; i < square_size(); i++)
+				Q[i][i] = 1;
+			apply_Q(Q);
+			return Q;
+		}
+
+		///Compute \f$Q^Tx\f$ in place, where \f$Q\f$ is the full \f$m\times m\f$
+		///orthogonal matrix. The first \f$k\f$ rows of the result are those of the
+		///economy sized \f$Q^Tx\f$.
+		///@param x Matrix with \f$m\f$ rows to multiply
+		template<int R, int C, class P, class B> void apply_QT(Matrix<R, C, P, B>& x)
+		{
+			SizeMismatch<Rows, R>::test(my_qr.num_rows(), x.num_rows());
+			for(int j0=0; j0 < square_size(); j0 += BlockSize)
+			{
+				const int b = std::min(BlockSize, square_size() - j0);
+				apply_block(j0, b, x.slice(j0, 0, x.num_rows() - j0, x.num_cols()).ref(), true);
+			}
+		}
+
+		///Compute \f$Q^Tx\f$ in place. See apply_QT(Matrix&).
+		///@param x Vector of size \f$m\f$ to multiply
+		template<int S, class P, class B> void apply_QT(Vector<S, P, B>& x)
+		{
+			apply_QT(x.as_col().ref());
+		}
+
+		///Compute \f$Qx\f$ in place, where \f$Q\f$ is the full \f$m\times m\f$
+		///orthogonal matrix. To multiply by the economy sized Q, set the last
+		///\f$m-k\f$ rows of x to zero.
+		///@param x Matrix with \f$m\f$ rows to multiply
+		template<int R, int C, class P, class B> void apply_Q(Matrix<R, C, P, B>& x)
+		{
+			SizeMismatch<Rows, R>::test(my_qr.num_rows(), x.num_rows());
+			const int last = ((square_size() - 1) / BlockSize) * BlockSize;
+			for(int j0=last; j0 >= 0; j0 -= BlockSize)
+			{
+				const int b = std::min(BlockSize, square_size() - j0);
+				apply_block(j0, b, x.slice(j0, 0, x.num_rows() - j0, x.num_cols()).ref(), false);
+			}
+		}
+
+		///Compute \f$Qx\f$ in place. See apply_Q(Matrix&).
+		///@param x Vector of size \f$m\f$ to multiply
+		template<int S, class P, class B> void apply_Q(Vector<S, P, B>& x)
+		{
+			apply_Q(x.as_col().ref());
+		}
+
+		/// Compute the least squares solution of \f$Ax = b\f$. This computes 
+		/// \f$ x = R^{-1}Q^Tb \f$, where \f$ Q^Tb \f$ is computed by applying the 
+		/// Householder reflectors to \f$b\f$ without forming Q. If A is wide, then
+		/// the basic solution is returned, where the last \f$n-m\f$ variables are zero.
+		/// If a diagonal element of R is negligible (A is rank deficient), the
+		/// corresponding variable is set to zero instead of being divided by it.
+		///@param b Right hand side, with \f$m\f$ elements.
+		template<int Size, class P2, class B2> 
+		Vector<Cols, Precision> backsub(const Vector<Size, P2, B2>& b)
+		{
+			SizeMismatch<Rows, Size>::test(my_qr.num_rows(), b.size());
+			Matrix<Rows, 1, Precision, ColMajor> c(b.as_col());
+			return backsub(c).T()[0];
+		}
+
+		/// Compute the least squares solution of \f$AX = B\f$, one column at a time.
+		/// See backsub(const Vector&).
+		///@param b Right hand side, with \f$m\f$ rows.
+		template<int R2, int C2, class P2, class B2> 
+		Matrix<Cols, C2, Precision, ColMajor> backsub(const Matrix<R2, C2, P2, B2>& b)
+		{
+			SizeMismatch<Rows, R2>::test(my_qr.num_rows(), b.num_rows());
+			Matrix<R2, C2, Precision, ColMajor> c(b);
+			apply_QT(c);
+
+			Precision largest = 0;
+			for(int i=0; i < square_size(); i++)
+				largest = std::max(largest, std::abs(my_R[i][i]));
+			const Precision tol = std::numeric_limits<Precision>::epsilon() * std::max(my_qr.num_rows(), my_qr.num_cols()) * largest;
+
+			Matrix<Cols, C2, Precision, ColMajor> x(my_qr.num_cols(), c.num_cols());
+			x = Zeros;
+			for(int col=0; col < c.num_cols(); col++)
+				for(int i=square_size()-1; i >= 0; i--)
+					if(std::abs(my_R[i][i]) > tol)
+					{
+						const int n = square_size()-i-1;
+						x[i][col] = (c[i][col] - my_R[i].slice(i+1, n) * x.T()[col].slice(i+1, n)) / my_R[i][i];
+					}
+
+			return x;
+		}
+
+	private:
+
+		//Generate a Householder reflector H = I - tau v v^T, such that H x = beta e_1
+		//v[0] = 1 is implicit and the rest of v overwrites x, and beta overwrites x[0].
+		//This follows LAPACK's xLARFG.
+		template<int S, class B> Precision make_householder(Vector<S, Precision, B> x)
+		{
+			using std::sqrt;
+			using std::abs;
+
+			const int n = x.size();
+			if(n <= 1)
+				return 0;
+
+			const Precision alpha = x[0];
+			const Precision xnorm2 = norm_sq(x.slice(1, n-1));
+
+			if(xnorm2 == 0)
+				return 0;
+
+			const Precision beta = -(alpha >= 0 ? 1 : -1) * sqrt(alpha*alpha + xnorm2);
+			const Precision tau = (beta - alpha) / beta;
+			x.slice(1, n-1) *= 1 / (alpha - beta);
+			x[0] = beta;
+
+			return tau;
+		}
+
+		//Apply the block of b reflectors starting at column j0 to C, either as 
+		//Q_block^T = I - V T^T V^T, or Q_block = I - V T V^T.
+		//The first row of C corresponds to row j0 of the matrix.
+		//
+		//The top b rows of V are unit lower triangular and are dealt with
+		//separately. The remaining rows of V are dense, and are processed in
+		//tiles of rows so that the tile of V and C stay in cache while every 
+		//reflector in the block is applied to them.
+		template<int R, int C, class P, class B> void apply_block(int j0, int b, Matrix<R, C, P, B>& c, bool transpose)
+		{
+			const int m = c.num_rows();
+			const int nc = c.num_cols();
+			const Matrix<Dynamic, Dynamic, Precision, typename Matrix<Dynamic, square_Size, Precision>::SliceBase> T = my_T.slice(0, j0, b, b);
+			const Matrix<Dynamic, Dynamic, Precision, typename Matrix<Rows, Cols, Precision, ColMajor>::SliceBase> V = my_qr.slice(j0, j0, m, b);
+
+			//W = V^T C
+			Matrix<Dynamic, Dynamic, Precision> W(b, nc);
+			for(int col=0; col < nc; col++)
+				for(int i=0; i < b; i++)
+				{
+					Precision sum = c[i][col];
+					for(int r=i+1; r < b; r++)
+						sum += V[r][i] * c[r][col];
+					W[i][col] = sum;
+				}
+
+			for(int r0=b; r0 < m; r0 += row_tile)
+			{
+				const int h = std::min(row_tile, m - r0);
+				for(int col=0; col < nc; col++)
+					for(int i=0; i < b; i++)
+						W[i][col] += V.T()[i].slice(r0, h) * c.T()[col].slice(r0, h);
+			}
+
+			//W = T^T W or W = T W, in place, using the triangularity of T
+			for(int col=0; col < nc; col++)
+				if(transpose)
+					for(int i=b-1; i >= 0; i--)
+					{
+						Precision sum = 0;
+						for(int r=0; r <= i; r++)
+							sum += T[r][i] * W[r][col];
+						W[i][col] = sum;
+					}
+				else
+					for(int i=0; i < b; i++)
+					{
+						Precision sum = 0;
+						for(int r=i; r < b; r++)
+							sum += T[i][r] * W[r][col];
+						W[i][col] = sum;
+					}
+
+			//C = C - V W
+			for(int col=0; col < nc; col++)
+				for(int r=0; r < b; r++)
+				{
+					Precision sum = W[r][col];
+					for(int i=0; i < r; i++)
+						sum += V[r][i] * W[i][col];
+					c[r][col] -= sum;
+				}
+
+			for(int r0=b; r0 < m; r0 += row_tile)
+			{
+				const int h = std::min(row_tile, m - r0);
+				for(int col=0; col < nc; col++)
+					for(int i=0; i < b; i++)
+						c.T()[col].slice(r0, h) -= W[i][col] * V.T()[i].slice(r0, h);
+			}
+		}
+
+		//Factorize the b columns starting at j0, without touching the columns to 
+		//the right. Narrow panels are factorized one column at a time. Wider ones 
+		//are split in two, so that the left half can be applied to the right half
+		//as a block, since a tall panel does not fit in cache.
+		void factor_panel(int j0, int b)
+		{
+			const int m = my_qr.num_rows();
+
+			if(b <= 4)
+			{
+				for(int j=j0; j < j0+b; j++)
+				{
+					my_tau[j] = make_householder(my_qr.T()[j].slice(j, m-j));
+
+					if(my_tau[j] == 0)
+						continue;
+
+					for(int c=j+1; c < j0+b; c++)
+					{
+						Precision w = my_qr[j][c] + my_qr.T()[j].slice(j+1, m-j-1) * my_qr.T()[c].slice(j+1, m-j-1);
+						w *= my_tau[j];
+						my_qr[j][c] -= w;
+						my_qr.T()[c].slice(j+1, m-j-1) -= w * my_qr.T()[j].slice(j+1, m-j-1);
+					}
+				}
+			}
+			else
+			{
+				const int b1 = b/2;
+				factor_panel(j0, b1);
+				compute_T(j0, b1);
+				apply_block(j0, b1, my_qr.slice(j0, j0+b1, m-j0, b-b1).ref(), true);
+				factor_panel(j0+b1, b-b1);
+			}
+		}
+
+		//Build the triangular factor, T, such that 
+		//H_j0 H_j0+1 ... H_j0+b-1 = I - V T V^T
+		//This needs the strict upper triangle of the Gram matrix V^T V.
+		void compute_T(int j0, int b)
+		{
+			const int m = my_qr.num_rows() - j0;
+			const Matrix<Dynamic, Dynamic, Precision, typename Matrix<Rows, Cols, Precision, ColMajor>::SliceBase> V = my_qr.slice(j0, j0, m, b);
+			Matrix<Dynamic, Dynamic, Precision, typename Matrix<Dynamic, square_Size, Precision>::SliceBase> T = my_T.slice(0, j0, b, b);
+
+			Matrix<Dynamic, Dynamic, Precision> G(b, b);
+			for(int i=0; i < b; i++)
+				for(int r=0; r < i; r++)
+				{
+					Precision sum = V[i][r];
+					for(int k=i+1; k < b; k++)
+						sum += V[k][r] * V[k][i];
+					G[r][i] = sum;
+				}
+
+			for(int r0=b; r0 < m; r0 += row_tile)
+			{
+				const int h = std::min(row_tile, m - r0);
+				for(int i=0; i < b; i++)
+					for(int r=0; r < i; r++)
+						G[r][i] += V.T()[r].slice(r0, h) * V.T()[i].slice(r0, h);
+			}
+
+			T = Zeros;
+			for(int i=0; i < b; i++)
+			{
+				T[i][i] = my_tau[j0+i];
+
+				//T[0:i, i] = -tau_i T[0:i,0:i] V[:,0:i]^T v_i
+				for(int r=0; r < i; r++)
+				{
+					Precision sum = 0;
+					for(int c=r; c < i; c++)
+						sum += T[r][c] * G[c][i];
+					T[r][i] = -my_tau[j0+i] * sum;
+				}
+			}
+		}
+
+		void compute()
+		{
+			const int m = my_qr.num_rows();
+			const int n = my_qr.num_cols();
+
+			for(int j0=0; j0 < square_size(); j0 += BlockSize)
+			{
+				const int b = std::min(BlockSize, square_size() - j0);
+
+				factor_panel(j0, b);
+				compute_T(j0, b);
+
+				//Update the trailing matrix with matrix-matrix products
+				if(j0 + b < n)
+					apply_block(j0, b, my_qr.slice(j0, j0+b, m-j0, n-j0-b).ref(), true);
+			}
+
+			//Extract R
+			my_R = Zeros;
+			for(int r=0; r < square_size(); r++)
+				for(int c=r; c < n; c++)
+					my_R[r][c] = my_qr[r][c];
+		}
+
+		static const int row_tile = 256;
+
+		Matrix<Rows, Cols, Precision, ColMajor> my_qr;
+		Vector<square_Size, Precision> my_tau;
+		Matrix<Dynamic, square_Size, Precision> my_T;
+		Matrix<square_Size, Cols, Precision> my_R;
+
+		int square_size()
+		{
+			return std::min(my_qr.num_rows(), my_qr.num_cols());	
+		}
+};
+
+template<int Rows, int Cols, typename Precision, int BlockSize> 
+const int QR_Blocked<Rows, Cols, Precision, BlockSize>::row_tile;
+
+
+
 
 
 
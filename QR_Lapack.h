@@ -30,15 +30,16 @@
 #include <TooN/TooN.h>
 #include <TooN/lapack.h>
 #include <utility>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+#include <vector>
 
 namespace TooN{
 
 /**
 Performs %QR decomposition.
 
-@warning this will only work if the number of columns is greater than 
-the number of rows!
-
 The QR decomposition operates on a matrix A. It can be performed with
 or without column pivoting. In general:
 \f[
@@ -47,9 +48,21 @@ AP = QR
 Where \f$P\f$ is a permutation matrix constructed to permute the columns
 of A. In practise, \f$P\f$ is stored as a vector of integer elements.
 
+If A is \f$m\times n\f$ and \f$k = \min(m,n)\f$, then the economy sized
+decomposition is computed, so \f$Q\f$ is \f$m\times k\f$ and \f$R\f$ is
+\f$k\times n\f$. For wide and square matrices these are the same types as
+in earlier versions of TooN. For tall matrices with static sizes, get_Q() now
+returns a Rows\f$\times\f$Cols matrix (previously Cols\f$\times\f$Cols) and
+get_R() a Cols\f$\times\f$Cols matrix (previously Rows\f$\times\f$Cols). Tall
+matrices were not supported before, and the Q returned for them was wrong.
+
 With column pivoting, the elements of the leading diagonal of \f$R\f$ will
 be sorted from largest in magnitude to smallest in magnitude.
 
+\f$Q\f$ is only formed the first time get_Q() is called. The least squares
+solution of \f$Ax = b\f$ can be found with backsub() which applies the 
+Householder reflectors to \f$b\f$ directly, so Q is never formed.
+
 @ingroup gDecomps
 */
 template<int Rows=Dynamic, int Cols=Rows, class Precision=double>
@@ -65,27 +78,76 @@ class QR_Lapack{
 		/// @param p Whether or not to perform pivoting
 		template<int R, int C, class P, class B> 
 		QR_Lapack(const Matrix<R,C,P,B>& m, bool p=0)
-		:copy(m),tau(square_size()), 
-		 Q(square_size(), square_size()), 
+		:copy(m.num_rows(), m.num_cols()),tau(square_size()), 
+		 R(square_size(), m.num_cols()),
+		 have_Q(0),
 		 do_pivoting(p), 
 		 pivot(Zeros(m.num_cols()))
 		{
 			//pivot is set to all zeros, which means all columns are free columns
 			//and can take part in column pivoting.
 
-			compute();
+			compute(m);
+		}
+
+		/// Construct a %QR decomposition for Rows or Cols equal to Dynamic. Use
+		/// compute() or compute_in_place() to perform the decomposition.
+		/// @param rows Number of rows
+		/// @param cols Number of columns
+		/// @param p Whether or not to perform pivoting
+		QR_Lapack(int rows, int cols, bool p=0)
+		:copy(rows, cols),tau(square_size()), 
+		 R(square_size(), cols),
+		 have_Q(0),
+		 do_pivoting(p), 
+		 pivot(Zeros(cols))
+		{}
+
+		/// Perform the %QR decomposition of another matrix.
+		template<int R2, int C2, class P2, class B2> 
+		void compute(const Matrix<R2,C2,P2,B2>& m)
+		{
+			SizeMismatch<Rows, R2>::test(copy.num_rows(), m.num_rows());
+			SizeMismatch<Cols, C2>::test(copy.num_cols(), m.num_cols());
+			copy.own(m.num_rows(), m.num_cols()) = m;
+			do_compute();
+		}
+
+		/// Perform the %QR decomposition of a matrix in place, without copying it.
+		/// The matrix is overwritten by R and the Householder reflectors, and must
+		/// remain in existence for as long as this object (or any copy of it) is used.
+		/// If it is not densely packed in column major order, it is copied instead
+		/// and left unmodified.
+		template<int R2, int C2, class B2> 
+		void compute_in_place(Matrix<R2,C2,Precision,B2>& m)
+		{
+			SizeMismatch<Rows, R2>::test(copy.num_rows(), m.num_rows());
+			SizeMismatch<Cols, C2>::test(copy.num_cols(), m.num_cols());
+			copy.borrow(m);
+			do_compute();
+		}
+
+		///@overload
+		///This allows a temporary Reference matrix to be used directly.
+		template<int R2, int C2> 
+		void compute_in_place(Matrix<R2,C2,Precision,Reference::ColMajor> m)
+		{
+			compute_in_place<R2, C2, Reference::ColMajor>(m);
 		}
 		
 		///Return R
-		const Matrix<Rows, Cols, Precision, ColMajor>& get_R()
+		const Matrix<square_Size, Cols, Precision, ColMajor>& get_R()
 		{
-			return copy;
+			return R;
 		}
 		
-		///Return Q
-		const Matrix<square_Size, square_Size, Precision, ColMajor>& get_Q()
+		///Return Q. This is formed from the Householder reflectors the first
+		///time it is requested.
+		const Matrix<Rows, square_Size, Precision, ColMajor>& get_Q()
 		{
-			return Q;
+			if(!have_Q)
+				form_Q();
+			return Q[0];
 		}	
 
 		///Return the permutation vector. The definition is that column \f$i\f$ of A is
@@ -95,9 +157,74 @@ class QR_Lapack{
 			return pivot;
 		}
 
+		/// Compute the least squares solution of \f$Ax = b\f$. This computes 
+		/// \f$ x = PR^{-1}Q^Tb \f$, where \f$ Q^Tb \f$ is computed by applying the 
+		/// Householder reflectors to \f$b\f$ without forming Q. If A is wide, then
+		/// the basic solution is returned, where the variables corresponding to 
+		/// the last \f$n-m\f$ columns of \f$AP\f$ are zero.
+		///
+		/// If A is rank deficient, then R has negligible diagonal elements, and
+		/// the corresponding variables are set to zero instead of being divided
+		/// by them. An element is negligible if it is below
+		/// \f$\epsilon\max(m,n)\max_i|R_{ii}|\f$. This only gives a sensible
+		/// basic solution if the decomposition used column pivoting.
+		///@param b Right hand side, with \f$m\f$ elements.
+		template<int Size, class P2, class B2> 
+		Vector<Cols, Precision> backsub(const Vector<Size, P2, B2>& b)
+		{
+			SizeMismatch<Rows, Size>::test(copy.num_rows(), b.size());
+			Matrix<Rows, 1, Precision, ColMajor> c(b.as_col());
+			return backsub(c).T()[0];
+		}
+
+		/// Compute the least squares solution of \f$AX = B\f$, one column at a time.
+		/// See backsub(const Vector&).
+		///@param b Right hand side, with \f$m\f$ rows.
+		template<int R2, int C2, class P2, class B2> 
+		Matrix<Cols, C2, Precision, ColMajor> backsub(const Matrix<R2, C2, P2, B2>& b)
+		{
+			SizeMismatch<Rows, R2>::test(copy.num_rows(), b.num_rows());
+			Matrix<R2, C2, Precision, ColMajor> c(b);
+
+			//c = Q^T b
+			FortranInteger M = c.num_rows();
+			FortranInteger N = c.num_cols();
+			FortranInteger K = square_size();
+			FortranInteger lda = copy.num_rows();
+			FortranInteger ldc = c.num_rows();
+			FortranInteger LWORK=-1;
+			FortranInteger INFO;
+			Precision size;
+
+			ormqr_("L", "T", &M, &N, &K, copy.view().my_data, &lda, tau.get_data_ptr(), c.get_data_ptr(), &ldc, &size, &LWORK, &INFO);
+			LWORK = (FortranInteger) size;
+			Precision* work = new Precision[LWORK];
+			ormqr_("L", "T", &M, &N, &K, copy.view().my_data, &lda, tau.get_data_ptr(), c.get_data_ptr(), &ldc, work, &LWORK, &INFO);
+			delete [] work;
+
+			if(INFO < 0)
+				std::cerr << "error in QR, INFO was " << INFO << std::endl;
+
+			//Solve R y = c, then undo the pivoting, x = P y
+			const Precision tol = rank_tolerance();
+			Matrix<Cols, C2, Precision, ColMajor> x(copy.num_cols(), c.num_cols());
+			x = Zeros;
+			for(int col=0; col < c.num_cols(); col++)
+				for(int i=square_size()-1; i >= 0; i--)
+					if(std::abs(R[i][i]) > tol)
+					{
+						Precision sum = c[i][col];
+						for(int j=i+1; j < square_size(); j++)
+							sum -= R[i][j] * x[pivot[j]][col];
+						x[pivot[i]][col] = sum / R[i][i];
+					}
+
+			return x;
+		}
+
 	private:
 
-		void compute()
+		void do_compute()
 		{	
 			FortranInteger M = copy.num_rows();
 			FortranInteger N = copy.num_cols();
@@ -117,49 +244,70 @@ class QR_Lapack{
 
 			
 			//Compute the working space
-			geqp3_(&M, &N, copy.get_data_ptr(), &lda, pivot.get_data_ptr(), tau.get_data_ptr(), &size, &LWORK, &INFO);
+			geqp3_(&M, &N, copy.view().my_data, &lda, pivot.get_data_ptr(), tau.get_data_ptr(), &size, &LWORK, &INFO);
 
 			LWORK = (FortranInteger) size;
 
 			Precision* work = new Precision[LWORK];
 			
-			geqp3_(&M, &N, copy.get_data_ptr(), &lda, pivot.get_data_ptr(), tau.get_data_ptr(), work, &LWORK, &INFO);
-
+			geqp3_(&M, &N, copy.view().my_data, &lda, pivot.get_data_ptr(), tau.get_data_ptr(), work, &LWORK, &INFO);
 
 			if(INFO < 0)
 				std::cerr << "error in QR, INFO was " << INFO << std::endl;
 
+			delete [] work;
+
 			//The upper "triangle+" of copy is R
-			//The lower right and tau contain enough information to reconstruct Q
-			
-			//LAPACK provides a handy function to do the reconstruction
-			Q = copy.template slice<0,0,square_Size, square_Size>(0,0,square_size(), square_size());
+			//The lower part and tau contain enough information to reconstruct Q,
+			//so they are left in place.
+			const typename Internal::FactorStorage<Rows, Cols, Precision, ColMajor>::View qr = copy.view();
+			R = Zeros;
+			for(int r=0; r < square_size(); r++)
+				for(int c=r; c < qr.num_cols(); c++)
+					R[r][c] = qr[r][c];
+
+			//Now fix the pivot matrix.
+			//We need to go from FORTRAN to C numbering. 
+			for(int i=0; i < pivot.size(); i++)
+				pivot[i]--;
+
+			have_Q = 0;
+		}
+
+		void form_Q()
+		{
+			//LAPACK provides a handy function to do the reconstruction.
+			//The memory for Q is only allocated if it is needed.
+			if(Q.empty())
+				Q.assign(1, Matrix<Rows, square_Size, Precision, ColMajor>(copy.num_rows(), square_size()));
+			Matrix<Rows, square_Size, Precision, ColMajor>& q = Q[0];
+			q = copy.view().template slice<0,0,Rows, square_Size>(0,0,copy.num_rows(), square_size());
 			
+			FortranInteger M = q.num_rows();
+			FortranInteger N = square_size();
 			FortranInteger K = square_size();
-			M=K;
-			N=K;
-			lda = K;
-			orgqr_(&M, &N, &K, Q.get_data_ptr(), &lda, tau.get_data_ptr(), work, &LWORK, &INFO);
+			FortranInteger lda = M;
+			FortranInteger LWORK=-1;
+			FortranInteger INFO;
+			Precision size;
+
+			orgqr_(&M, &N, &K, &q[0][0], &lda, tau.get_data_ptr(), &size, &LWORK, &INFO);
+			LWORK = (FortranInteger) size;
+			Precision* work = new Precision[LWORK];
+			orgqr_(&M, &N, &K, &q[0][0], &lda, tau.get_data_ptr(), work, &LWORK, &INFO);
+			delete [] work;
 
 			if(INFO < 0)
 				std::cerr << "error in QR, INFO was " << INFO << std::endl;
 
-			delete [] work;
-			
-			//Now zero out the lower triangle
-			for(int r=1; r < square_size(); r++)
-				for(int c=0; c<r; c++)
-					copy[r][c] = 0;
-
-			//Now fix the pivot matrix.
-			//We need to go from FORTRAN to C numbering. 
-			for(int i=0; i < pivot.size(); i++)
-				pivot[i]--;
+			have_Q = 1;
 		}
 
-		Matrix<Rows, Cols, Precision, ColMajor> copy;
+		Internal::FactorStorage<Rows, Cols, Precision, ColMajor> copy;
 		Vector<square_Size, Precision> tau;
-		Matrix<square_Size, square_Size, Precision, ColMajor> Q;
+		Matrix<square_Size, Cols, Precision, ColMajor> R;
+		std::vector<Matrix<Rows, square_Size, Precision, ColMajor> > Q; //Empty until get_Q() is first called
+		bool have_Q;
 		bool do_pivoting;
 		Vector<Cols, FortranInteger> pivot;
 		
@@ -168,6 +316,15 @@ class QR_Lapack{
 		{
 			return std::min(copy.num_rows(), copy.num_cols());	
 		}
+
+		//Diagonal elements of R below this are treated as zero by backsub()
+		Precision rank_tolerance()
+		{
+			Precision largest = 0;
+			for(int i=0; i < square_size(); i++)
+				largest = std::max(largest, std::abs(R[i][i]));
+			return std::numeric_limits<Precision>::epsilon() * std::max(copy.num_rows(), copy.num_cols()) * largest;
+		}
 };
 
 }
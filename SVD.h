@@ -104,23 +104,45 @@ public:
 	/// performs the decomposition immediately.
 	template <int R2, int C2, typename P2, typename B2>
 	SVD(const Matrix<R2,C2,P2,B2>& m)
-		: my_copy(m),
+		: my_copy(m.num_rows(), m.num_cols()),
 		  my_diagonal(std::min(m.num_rows(),m.num_cols())),
 		  my_square(std::min(m.num_rows(),m.num_cols()),std::min(m.num_rows(),m.num_cols()))
 	{
-		do_compute();
+		compute(m);
 	}
 
 	/// Compute the %SVD decomposition of M, typically used after the default constructor
 	template <int R2, int C2, typename P2, typename B2>
 	void compute(const Matrix<R2,C2,P2,B2>& m){
-		my_copy=m;
+		SizeMismatch<Rows, R2>::test(my_copy.num_rows(), m.num_rows());
+		SizeMismatch<Cols, C2>::test(my_copy.num_cols(), m.num_cols());
+		my_copy.own(m.num_rows(), m.num_cols())=m;
+		do_compute();
+	}
+
+	/// Compute the %SVD decomposition of M in place, without copying it.
+	/// M is overwritten by U or VT (whichever is the same shape as M), and must
+	/// remain in existence for as long as this object (or any copy of it) is used.
+	/// If it is not densely packed in row major order (like a normal Matrix or the
+	/// result of wrapMatrix()), it is copied instead and left unmodified.
+	template <int R2, int C2, typename B2>
+	void compute_in_place(Matrix<R2,C2,Precision,B2>& m){
+		SizeMismatch<Rows, R2>::test(my_copy.num_rows(), m.num_rows());
+		SizeMismatch<Cols, C2>::test(my_copy.num_cols(), m.num_cols());
+		my_copy.borrow(m);
 		do_compute();
 	}
+
+	///@overload
+	///This allows the result of wrapMatrix() to be used directly.
+	template <int R2, int C2>
+	void compute_in_place(Matrix<R2,C2,Precision,Reference::RowMajor> m){
+		compute_in_place<R2, C2, Reference::RowMajor>(m);
+	}
 	
 	private:
 	void do_compute(){
-		Precision* const a = my_copy.my_data;
+		Precision* const a = my_copy.view().my_data;
 		int lda = my_copy.num_cols();
 		int m = my_copy.num_cols();
 		int n = my_copy.num_rows();
@@ -235,7 +257,7 @@ public:
 	Matrix<Rows,Min_Dim,Precision,Reference::RowMajor> get_U(){
 		if(is_vertical()){
 			return Matrix<Rows,Min_Dim,Precision,Reference::RowMajor>
-				(my_copy.my_data,my_copy.num_rows(),my_copy.num_cols());
+				(my_copy.view().my_data,my_copy.num_rows(),my_copy.num_cols());
 		} else {
 			return Matrix<Rows,Min_Dim,Precision,Reference::RowMajor>
 				(my_square.my_data, my_square.num_rows(), my_square.num_cols());
@@ -254,7 +276,7 @@ public:
 				(my_square.my_data, my_square.num_rows(), my_square.num_cols());
 		} else {
 			return Matrix<Min_Dim,Cols,Precision,Reference::RowMajor>
-				(my_copy.my_data,my_copy.num_rows(),my_copy.num_cols());
+				(my_copy.view().my_data,my_copy.num_rows(),my_copy.num_cols());
 		}
 	}
 
@@ -274,7 +296,7 @@ public:
 	}
 
 private:
-	Matrix<Rows,Cols,Precision,RowMajor> my_copy;
+	Internal::FactorStorage<Rows,Cols,Precision,RowMajor> my_copy;
 	Vector<Min_Dim,Precision> my_diagonal;
 	Matrix<Min_Dim,Min_Dim,Precision,RowMajor> my_square; // square matrix (U or V' depending on the shape of my_copy)
 };
@@ -0,0 +1,345 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_SCHUR_COMPLEMENT_H
+#define TOON_INCLUDE_SCHUR_COMPLEMENT_H
+
+#include <TooN/TooN.h>
+#include <TooN/Cholesky.h>
+#include <TooN/se3.h>
+#include <vector>
+
+namespace TooN {
+
+/// Performs Gauss-Newton weighted least squares computation for problems
+/// with the structure of bundle adjustment, using the Schur complement.
+///
+/// The parameters are divided in to blocks of two kinds, referred to as
+/// cameras and points. Each measurement depends on one camera and one point,
+/// so the inverse covariance matrix is block sparse and symmetric:
+/// \f[
+///	C^{-1} = \begin{bmatrix} U & W \\ W^{\mathsf T} & V \end{bmatrix},
+/// \f]
+/// where \f$U\f$ and \f$V\f$ are block diagonal, with one block per camera
+/// and point respectively, and \f$W\f$ has a block for each camera and
+/// point which share a measurement. Only these blocks are stored.
+///
+/// compute() eliminates the points, leaving the reduced camera system
+/// \f$S = U - WV^{-1}W^{\mathsf T}\f$, which is solved with a dense
+/// decomposition. The points are then found by back substitution.
+/// If OpenMP is enabled, the elimination and back substitution are
+/// divided between threads.
+///
+/// Like WLS, this class solves for the update \f$\mu = C\,J^{\mathsf T}W\underline{m}\f$.
+/// @code
+///	SchurComplement<> sc(cameras.size(), points.size());
+///	for(...)
+///		sc.add_mJ(camera, point, residual, J_camera, J_point);
+///	sc.add_camera_prior(0, Identity * 1e6);  //Fix the gauge freedom
+///	sc.compute();
+///	sc.update(cameras, points);
+/// @endcode
+/// Each \f$V\f$ block must be invertible, so every point must be
+/// constrained by its measurements or by a prior.
+///
+/// @param CamSize The number of parameters per camera
+/// @param PointSize The number of parameters per point
+/// @param Precision The numerical precision used (double, float etc)
+/// @param Decomposition The class used to decompose the reduced camera system
+/// @ingroup gEquations
+template <int CamSize=6, int PointSize=3, class Precision=DefaultPrecision,
+		  template<int DecompSize, class DecompPrecision> class Decomposition = Cholesky>
+class SchurComplement {
+public:
+
+	/// Construct with the number of cameras and points
+	SchurComplement(int cameras=0, int points=0)
+	:my_U(cameras), my_camera_vector(cameras), my_camera_blocks(cameras), my_camera_mu(cameras),
+	 my_V(points), my_V_inv(points), my_point_vector(points), my_point_blocks(points), my_point_mu(points),
+	 my_S(cameras*CamSize, cameras*CamSize),
+	 my_reduced_vector(cameras*CamSize),
+	 my_decomposition(cameras*CamSize)
+	{
+		clear();
+	}
+
+	/// Clear all the measurements. The pattern of which cameras and points
+	/// share measurements is kept, so repeated linearizations of the
+	/// same problem do not allocate any memory.
+	void clear(){
+		for(int i=0; i < num_cameras(); i++)
+		{
+			my_U[i] = Zeros;
+			my_camera_vector[i] = Zeros;
+		}
+		for(int j=0; j < num_points(); j++)
+		{
+			my_V[j] = Zeros;
+			my_point_vector[j] = Zeros;
+		}
+		for(size_t b=0; b < my_blocks.size(); b++)
+			my_blocks[b].W = Zeros;
+	}
+
+	int num_cameras() const { return my_U.size(); } ///< The number of cameras
+	int num_points() const { return my_V.size(); }  ///< The number of points
+
+	/// Applies a constant regularisation term to every parameter.
+	/// @param val The strength of the prior
+	void add_prior(Precision val){
+		for(int i=0; i < num_cameras(); i++)
+			for(int k=0; k < CamSize; k++)
+				my_U[i][k][k] += val;
+		for(int j=0; j < num_points(); j++)
+			for(int k=0; k < PointSize; k++)
+				my_V[j][k][k] += val;
+	}
+
+	/// Applies a regularisation term to one camera.
+	/// @param camera The camera
+	/// @param m The inverse covariance to add
+	template<class B2>
+	void add_camera_prior(int camera, const Matrix<CamSize,CamSize,Precision,B2>& m){
+		my_U[camera] += m;
+	}
+
+	/// Applies a regularisation term to one point.
+	/// @param point The point
+	/// @param m The inverse covariance to add
+	template<class B2>
+	void add_point_prior(int point, const Matrix<PointSize,PointSize,Precision,B2>& m){
+		my_V[point] += m;
+	}
+
+	/// Add a measurement which depends on one camera and one point
+	/// @param camera The camera
+	/// @param point The point
+	/// @param m The values of the measurement
+	/// @param Jc The Jacobian of the measurement with respect to the camera
+	/// @param Jp The Jacobian of the measurement with respect to the point
+	/// @param invcov The inverse covariance of the measurement values
+	template<int N, class B1, class B2, class B3, class B4>
+	void add_mJ(int camera, int point, const Vector<N,Precision,B1>& m,
+	            const Matrix<N,CamSize,Precision,B2>& Jc,
+	            const Matrix<N,PointSize,Precision,B3>& Jp,
+	            const Matrix<N,N,Precision,B4>& invcov){
+		const Matrix<CamSize,N,Precision> tc = Jc.T() * invcov;
+		const Matrix<PointSize,N,Precision> tp = Jp.T() * invcov;
+		my_U[camera] += tc * Jc;
+		my_V[point] += tp * Jp;
+		block(camera, point) += tc * Jp;
+		my_camera_vector[camera] += tc * m;
+		my_point_vector[point] += tp * m;
+	}
+
+	/// Add a measurement which depends on one camera and one point
+	/// @param camera The camera
+	/// @param point The point
+	/// @param m The values of the measurement
+	/// @param Jc The Jacobian of the measurement with respect to the camera
+	/// @param Jp The Jacobian of the measurement with respect to the point
+	/// @param weight The inverse variance of the measurement values
+	template<int N, class B1, class B2, class B3>
+	void add_mJ(int camera, int point, const Vector<N,Precision,B1>& m,
+	            const Matrix<N,CamSize,Precision,B2>& Jc,
+	            const Matrix<N,PointSize,Precision,B3>& Jp,
+	            Precision weight = 1){
+		const Matrix<CamSize,N,Precision> tc = Jc.T() * weight;
+		const Matrix<PointSize,N,Precision> tp = Jp.T() * weight;
+		my_U[camera] += tc * Jc;
+		my_V[point] += tp * Jp;
+		block(camera, point) += tc * Jp;
+		my_camera_vector[camera] += tc * m;
+		my_point_vector[point] += tp * m;
+	}
+
+	/// Process all the measurements and compute the update, which can
+	/// then be accessed with get_camera_mu() and get_point_mu(), or applied
+	/// with update().
+	void compute(){
+		const int cameras = num_cameras();
+		const int points = num_points();
+
+		//Invert the point blocks, and form W V^-1 for each measured pair
+		#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic, 16)
+		#endif
+		for(int j=0; j < points; j++)
+		{
+			Cholesky<PointSize,Precision> chol(my_V[j]);
+			my_V_inv[j] = chol.get_inverse();
+			for(size_t k=0; k < my_point_blocks[j].size(); k++)
+			{
+				Block& b = my_blocks[my_point_blocks[j][k]];
+				b.WV_inv = b.W * my_V_inv[j];
+			}
+		}
+
+		//Eliminate the points. Each block row of S only depends on the
+		//measurements of one camera, so the rows are independent. Only
+		//the upper right triangle is computed.
+		#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic, 4)
+		#endif
+		for(int i=0; i < cameras; i++)
+		{
+			for(int k=i; k < cameras; k++)
+				my_S.template slice<Dynamic,Dynamic,CamSize,CamSize>(i*CamSize, k*CamSize, CamSize, CamSize) = Zeros;
+			my_S.template slice<Dynamic,Dynamic,CamSize,CamSize>(i*CamSize, i*CamSize, CamSize, CamSize) = my_U[i];
+
+			Vector<CamSize,Precision> v = my_camera_vector[i];
+
+			for(size_t n=0; n < my_camera_blocks[i].size(); n++)
+			{
+				const Block& b = my_blocks[my_camera_blocks[i][n]];
+				v -= b.WV_inv * my_point_vector[b.point];
+
+				const std::vector<int>& shared = my_point_blocks[b.point];
+				for(size_t m=0; m < shared.size(); m++)
+				{
+					const Block& b2 = my_blocks[shared[m]];
+					if(b2.camera >= i)
+						my_S.template slice<Dynamic,Dynamic,CamSize,CamSize>(i*CamSize, b2.camera*CamSize, CamSize, CamSize) -= b.WV_inv * b2.W.T();
+				}
+			}
+
+			my_reduced_vector.template slice<Dynamic,CamSize>(i*CamSize, CamSize) = v;
+		}
+
+		//Copy the upper right triangle to the empty lower-left.
+		for(int r=1; r < my_S.num_rows(); r++)
+			for(int c=0; c < r; c++)
+				my_S[r][c] = my_S[c][r];
+
+		my_decomposition.compute(my_S);
+		const Vector<Dynamic,Precision> camera_mu = my_decomposition.backsub(my_reduced_vector);
+		for(int i=0; i < cameras; i++)
+			my_camera_mu[i] = camera_mu.template slice<Dynamic,CamSize>(i*CamSize, CamSize);
+
+		//Back substitute for the points
+		#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic, 16)
+		#endif
+		for(int j=0; j < points; j++)
+		{
+			Vector<PointSize,Precision> v = my_point_vector[j];
+			for(size_t k=0; k < my_point_blocks[j].size(); k++)
+			{
+				const Block& b = my_blocks[my_point_blocks[j][k]];
+				v -= b.W.T() * my_camera_mu[b.camera];
+			}
+			my_point_mu[j] = my_V_inv[j] * v;
+		}
+	}
+
+	/// Apply the update to a set of SE3 camera poses and 3D points.
+	/// The cameras are updated as <code>SE3<>::exp(mu) * camera</code>,
+	/// which requires CamSize to be 6, and the points by addition.
+	/// @param cameras The camera poses
+	/// @param points The points
+	template<class P2>
+	void update(std::vector<SE3<P2> >& cameras, std::vector<Vector<PointSize,P2> >& points) const {
+		SizeMismatch<Dynamic,Dynamic>::test(cameras.size(), num_cameras());
+		SizeMismatch<Dynamic,Dynamic>::test(points.size(), num_points());
+		for(int i=0; i < num_cameras(); i++)
+			cameras[i] = SE3<P2>::exp(my_camera_mu[i]) * cameras[i];
+		for(int j=0; j < num_points(); j++)
+			points[j] += my_point_mu[j];
+	}
+
+	/// Returns the update for a camera
+	const Vector<CamSize,Precision>& get_camera_mu(int camera) const { return my_camera_mu[camera]; }
+	/// Returns the update for a point
+	const Vector<PointSize,Precision>& get_point_mu(int point) const { return my_point_mu[point]; }
+
+	/// Returns the inverse covariance block for a camera, \f$U_i\f$
+	Matrix<CamSize,CamSize,Precision>& get_camera_C_inv(int camera) { return my_U[camera]; }
+	/// Returns the inverse covariance block for a camera, \f$U_i\f$
+	const Matrix<CamSize,CamSize,Precision>& get_camera_C_inv(int camera) const { return my_U[camera]; }
+	/// Returns the inverse covariance block for a point, \f$V_j\f$
+	Matrix<PointSize,PointSize,Precision>& get_point_C_inv(int point) { return my_V[point]; }
+	/// Returns the inverse covariance block for a point, \f$V_j\f$
+	const Matrix<PointSize,PointSize,Precision>& get_point_C_inv(int point) const { return my_V[point]; }
+	/// Returns the vector \f$J^{\mathsf T} W\underline{m}\f$ for a camera
+	Vector<CamSize,Precision>& get_camera_vector(int camera) { return my_camera_vector[camera]; }
+	/// Returns the vector \f$J^{\mathsf T} W\underline{m}\f$ for a point
+	Vector<PointSize,Precision>& get_point_vector(int point) { return my_point_vector[point]; }
+
+	/// Returns the reduced camera system computed by compute()
+	const Matrix<Dynamic,Dynamic,Precision>& get_reduced_C_inv() const { return my_S; }
+	/// Return the decomposition object used to solve the reduced camera system
+	Decomposition<Dynamic,Precision>& get_decomposition(){ return my_decomposition; }
+
+private:
+
+	///An off-diagonal block of the inverse covariance matrix, \f$W_{ij}\f$
+	struct Block
+	{
+		int camera, point;
+		Matrix<CamSize,PointSize,Precision> W;
+		Matrix<CamSize,PointSize,Precision> WV_inv;
+	};
+
+	///Find or create the block for a camera and point.
+	Matrix<CamSize,PointSize,Precision>& block(int camera, int point)
+	{
+		const std::vector<int>& blocks = my_point_blocks[point];
+		for(size_t k=0; k < blocks.size(); k++)
+			if(my_blocks[blocks[k]].camera == camera)
+				return my_blocks[blocks[k]].W;
+
+		Block b;
+		b.camera = camera;
+		b.point = point;
+		b.W = Zeros;
+		my_blocks.push_back(b);
+		my_point_blocks[point].push_back(my_blocks.size()-1);
+		my_camera_blocks[camera].push_back(my_blocks.size()-1);
+		return my_blocks.back().W;
+	}
+
+	std::vector<Matrix<CamSize,CamSize,Precision> > my_U;
+	std::vector<Vector<CamSize,Precision> > my_camera_vector;
+	std::vector<std::vector<int> > my_camera_blocks;
+	std::vector<Vector<CamSize,Precision> > my_camera_mu;
+
+	std::vector<Matrix<PointSize,PointSize,Precision> > my_V;
+	std::vector<Matrix<PointSize,PointSize,Precision> > my_V_inv;
+	std::vector<Vector<PointSize,Precision> > my_point_vector;
+	std::vector<std::vector<int> > my_point_blocks;
+	std::vector<Vector<PointSize,Precision> > my_point_mu;
+
+	std::vector<Block> my_blocks;
+
+	Matrix<Dynamic,Dynamic,Precision> my_S;
+	Vector<Dynamic,Precision> my_reduced_vector;
+	Decomposition<Dynamic,Precision> my_decomposition;
+};
+
+}
+
+#endif
@@ -0,0 +1,289 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_SPARSE_CHOLESKY_H
+#define TOON_INCLUDE_SPARSE_CHOLESKY_H
+
+#include <TooN/TooN.h>
+#include <TooN/SparseMatrix.h>
+#include <vector>
+
+namespace TooN {
+
+/**
+Decomposes a sparse positive-semidefinite symmetric matrix A into
+\f$P^{\mathsf T} L D L^{\mathsf T} P\f$, where L is sparse lower triangular with
+ones on the diagonal, D is diagonal and P is a fill reducing permutation
+computed by minimum_degree_ordering().
+
+The decomposition is in two stages. The symbolic stage finds the
+ordering, the elimination tree and the structure of L, and only depends
+on the positions of the nonzero elements. The numeric stage computes the
+values, one row of L at a time (an up-looking decomposition). compute()
+repeats only the numeric stage if the structure has not changed, which is
+the usual case when a nonlinear problem is linearized repeatedly.
+
+The matrix must be square and symmetric, with both triangles stored. Either
+layout (CSR or CSC) can be used.
+@code
+	SparseMatrix<> A = ...;
+	SparseCholesky<> chol(A);
+	Vector<> x = chol.backsub(b);
+@endcode
+
+@param Precision The precision of the entries in the matrix and its decomposition
+@ingroup gDecomps
+**/
+template<class Precision=DefaultPrecision>
+class SparseCholesky
+{
+public:
+	SparseCholesky()
+	:my_rank(0)
+	{}
+
+	/// Construct the decomposition of a matrix. This initialises the class, and
+	/// performs the decomposition immediately.
+	template<class P2, class Layout>
+	SparseCholesky(const SparseMatrix<P2, Layout>& m)
+	:my_rank(0)
+	{
+		compute(m);
+	}
+
+	/// Compute the decomposition of a matrix. The symbolic stage is repeated
+	/// only if the structure of the matrix differs from the last one.
+	template<class P2, class Layout>
+	void compute(const SparseMatrix<P2, Layout>& m)
+	{
+		SizeMismatch<Dynamic, Dynamic>::test(m.num_rows(), m.num_cols());
+		if(m.get_offsets() != my_offsets || m.get_indices() != my_indices)
+			analyse(m);
+		factorize(m.get_values());
+	}
+
+	/// Perform the symbolic stage of the decomposition for a matrix with the
+	/// same structure as \e m. This is done automatically by compute().
+	template<class P2, class Layout>
+	void analyse(const SparseMatrix<P2, Layout>& m)
+	{
+		my_offsets = m.get_offsets();
+		my_indices = m.get_indices();
+
+		const int n = m.num_rows();
+		my_permutation = minimum_degree_ordering(m);
+		my_inverse_permutation.resize(n);
+		for(int k=0; k < n; k++)
+			my_inverse_permutation[my_permutation[k]] = k;
+
+		//Find the elimination tree and the number of elements in each
+		//column of L, by following the tree up from each element of row k.
+		my_parent.assign(n, -1);
+		std::vector<int> count(n, 0);
+		std::vector<int> flag(n);
+		for(int k=0; k < n; k++)
+		{
+			flag[k] = k;
+			const int kk = my_permutation[k];
+			for(int p=my_offsets[kk]; p < my_offsets[kk+1]; p++)
+			{
+				for(int i=my_inverse_permutation[my_indices[p]]; i < k && flag[i] != k; i=my_parent[i])
+				{
+					if(my_parent[i] == -1)
+						my_parent[i] = k;
+					count[i]++;
+					flag[i] = k;
+				}
+			}
+		}
+
+		my_L_offsets.resize(n+1);
+		my_L_offsets[0] = 0;
+		for(int k=0; k < n; k++)
+			my_L_offsets[k+1] = my_L_offsets[k] + count[k];
+
+		my_L_indices.resize(my_L_offsets[n]);
+		my_L_values.resize(my_L_offsets[n]);
+		my_D.resize(n);
+	}
+
+	/// Compute A^-1*v
+	template<int Size2, class P2, class B2>
+	Vector<Dynamic, Precision> backsub(const Vector<Size2, P2, B2>& v) const
+	{
+		const int n = my_D.size();
+		SizeMismatch<Dynamic, Size2>::test(n, v.size());
+
+		Vector<Dynamic, Precision> y(n);
+		for(int k=0; k < n; k++)
+			y[k] = v[my_permutation[k]];
+
+		// backsub through L
+		for(int j=0; j < n; j++)
+			for(int p=my_L_offsets[j]; p < my_L_offsets[j+1]; p++)
+				y[my_L_indices[p]] -= my_L_values[p] * y[j];
+
+		// backsub through diagonal
+		for(int j=0; j < n; j++)
+			y[j] /= my_D[j];
+
+		// backsub through L.T()
+		for(int j=n-1; j >= 0; j--)
+			for(int p=my_L_offsets[j]; p < my_L_offsets[j+1]; p++)
+				y[j] -= my_L_values[p] * y[my_L_indices[p]];
+
+		Vector<Dynamic, Precision> result(n);
+		for(int k=0; k < n; k++)
+			result[my_permutation[k]] = y[k];
+		return result;
+	}
+
+	/// Compute the determinant.
+	Precision determinant() const
+	{
+		Precision answer = 1;
+		for(size_t i=0; i < my_D.size(); i++)
+			answer *= my_D[i];
+		return answer;
+	}
+
+	/// Returns the rank. If the matrix is singular, then this is the number
+	/// of rows of L which were computed before a zero pivot was found, and
+	/// the decomposition cannot be used.
+	int rank() const { return my_rank; }
+
+	/// Returns the number of nonzero elements below the diagonal of L.
+	int num_nonzeros() const { return my_L_indices.size(); }
+
+	/// Returns the fill reducing ordering: row \e k of L corresponds to
+	/// row <code>get_permutation()[k]</code> of A.
+	const std::vector<int>& get_permutation() const { return my_permutation; }
+
+	/// Returns the diagonal matrix D, in the permuted order.
+	Vector<Dynamic, Precision> get_D() const
+	{
+		Vector<Dynamic, Precision> d(my_D.size());
+		for(size_t i=0; i < my_D.size(); i++)
+			d[i] = my_D[i];
+		return d;
+	}
+
+	/// Returns L, with the unit diagonal, in the permuted order.
+	SparseMatrix<Precision, ColMajor> get_unscaled_L() const
+	{
+		const int n = my_D.size();
+		SparseMatrix<Precision, ColMajor> L(n, n);
+		for(int j=0; j < n; j++)
+		{
+			L.add(j, j, 1);
+			for(int p=my_L_offsets[j]; p < my_L_offsets[j+1]; p++)
+				L.add(my_L_indices[p], j, my_L_values[p]);
+		}
+		L.compress();
+		return L;
+	}
+
+private:
+	template<class P2>
+	void factorize(const std::vector<P2>& values)
+	{
+		const int n = my_D.size();
+		std::vector<Precision> y(n, 0);
+		std::vector<int> pattern(n);
+		std::vector<int> flag(n);
+		std::vector<int> count(n, 0);
+
+		for(int k=0; k < n; k++)
+		{
+			//Scatter row k of the permuted A in to y, and find the pattern of
+			//row k of L from the elimination tree, in topological order.
+			int top = n;
+			flag[k] = k;
+			const int kk = my_permutation[k];
+			for(int p=my_offsets[kk]; p < my_offsets[kk+1]; p++)
+			{
+				int i = my_inverse_permutation[my_indices[p]];
+				if(i > k)
+					continue;
+				y[i] += values[p];
+				int len = 0;
+				for(; flag[i] != k; i=my_parent[i])
+				{
+					pattern[len++] = i;
+					flag[i] = k;
+				}
+				while(len > 0)
+					pattern[--top] = pattern[--len];
+			}
+
+			//Solve for row k of L
+			my_D[k] = y[k];
+			y[k] = 0;
+			for(; top < n; top++)
+			{
+				const int i = pattern[top];
+				const Precision yi = y[i];
+				y[i] = 0;
+				const int end = my_L_offsets[i] + count[i];
+				for(int p=my_L_offsets[i]; p < end; p++)
+					y[my_L_indices[p]] -= my_L_values[p] * yi;
+				const Precision l_ki = yi / my_D[i];
+				my_D[k] -= l_ki * yi;
+				my_L_indices[end] = k;
+				my_L_values[end] = l_ki;
+				count[i]++;
+			}
+
+			if(my_D[k] == 0)
+			{
+				my_rank = k;
+				return;
+			}
+		}
+		my_rank = n;
+	}
+
+	//Structure of the last matrix analysed
+	std::vector<int> my_offsets;
+	std::vector<int> my_indices;
+
+	std::vector<int> my_permutation;
+	std::vector<int> my_inverse_permutation;
+	std::vector<int> my_parent;
+
+	//L, stored by columns without the diagonal
+	std::vector<int> my_L_offsets;
+	std::vector<int> my_L_indices;
+	std::vector<Precision> my_L_values;
+	std::vector<Precision> my_D;
+
+	int my_rank;
+};
+
+}
+
+#endif
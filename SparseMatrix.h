@@ -0,0 +1,367 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_SPARSE_MATRIX_H
+#define TOON_INCLUDE_SPARSE_MATRIX_H
+
+#include <TooN/TooN.h>
+#include <vector>
+#include <set>
+#include <iterator>
+#include <utility>
+#include <algorithm>
+
+namespace TooN {
+
+namespace Internal
+{
+	///@internal
+	///@brief The other layout.
+	///@ingroup gInternal
+	template<class Layout> struct TransposedLayout;
+	template<> struct TransposedLayout<RowMajor>{ typedef ColMajor type; };
+	template<> struct TransposedLayout<ColMajor>{ typedef RowMajor type; };
+
+	///@internal
+	///@brief Convert between (row, column) and (major, minor) indices.
+	///@ingroup gInternal
+	template<class Layout> struct SparseIndex;
+	template<> struct SparseIndex<RowMajor>
+	{
+		static int major(int r, int){ return r; }
+		static int minor(int, int c){ return c; }
+	};
+	template<> struct SparseIndex<ColMajor>
+	{
+		static int major(int, int c){ return c; }
+		static int minor(int r, int){ return r; }
+	};
+}
+
+/**
+A sparse matrix in compressed form. With the RowMajor layout (the default)
+this is compressed sparse row (CSR) storage, and with ColMajor it is
+compressed sparse column (CSC) storage.
+
+The nonzero elements of major index \e i (the row for RowMajor, the column
+for ColMajor) are at positions <code>get_offsets()[i]</code> up to
+<code>get_offsets()[i+1]</code> of get_indices() and get_values(), with
+the minor indices in increasing order.
+
+Elements are added with add(), which accumulates duplicates, and become
+part of the matrix when compress() is called:
+@code
+	SparseMatrix<> A(3, 3);
+	A.add(0, 0, 4);
+	A.add(1, 0, 1);
+	A.add(0, 1, 1);
+	A.add(2, 2, 2);
+	A.compress();
+	Vector<> y = A * x;
+@endcode
+
+Multiplication by a vector works with any Vector, including the result
+of wrapVector(). For CSR storage it is divided between threads if OpenMP
+is enabled.
+
+@param Precision The precision of the elements
+@param Layout RowMajor for CSR storage or ColMajor for CSC storage
+@ingroup gLinAlg
+**/
+template<class Precision=DefaultPrecision, class Layout=RowMajor>
+class SparseMatrix
+{
+	typedef Internal::SparseIndex<Layout> Index;
+
+public:
+	///Construct an empty matrix of the given size.
+	SparseMatrix(int rows=0, int cols=0)
+	:my_rows(rows), my_cols(cols), my_offsets(major_size()+1, 0)
+	{}
+
+	///Construct from the nonzero elements of a dense matrix.
+	template<int R, int C, class P2, class B2>
+	explicit SparseMatrix(const Matrix<R, C, P2, B2>& m)
+	:my_rows(m.num_rows()), my_cols(m.num_cols()), my_offsets(major_size()+1, 0)
+	{
+		for(int r=0; r < m.num_rows(); r++)
+			for(int c=0; c < m.num_cols(); c++)
+				if(m[r][c] != 0)
+					add(r, c, m[r][c]);
+		compress();
+	}
+
+	///Construct from a matrix with the other layout.
+	template<class P2>
+	explicit SparseMatrix(const SparseMatrix<P2, typename Internal::TransposedLayout<Layout>::type>& m)
+	:my_rows(m.num_rows()), my_cols(m.num_cols()), my_offsets(major_size()+1, 0)
+	{
+		//Elements are visited in order of their major index in m, which is
+		//the minor index here, so this creates sorted minor indices.
+		const std::vector<int>& offsets = m.get_offsets();
+		const std::vector<int>& indices = m.get_indices();
+
+		for(size_t p=0; p < indices.size(); p++)
+			my_offsets[indices[p]+1]++;
+		for(int i=0; i < major_size(); i++)
+			my_offsets[i+1] += my_offsets[i];
+
+		my_indices.resize(indices.size());
+		my_values.resize(indices.size());
+		std::vector<int> next(my_offsets.begin(), my_offsets.end()-1);
+		for(int j=0; j+1 < static_cast<int>(offsets.size()); j++)
+			for(int p=offsets[j]; p < offsets[j+1]; p++)
+			{
+				const int q = next[indices[p]]++;
+				my_indices[q] = j;
+				my_values[q] = m.get_values()[p];
+			}
+	}
+
+	int num_rows() const { return my_rows; } ///< The number of rows
+	int num_cols() const { return my_cols; } ///< The number of columns
+	int num_nonzeros() const { return my_indices.size(); } ///< The number of stored elements
+
+	///Add a value to an element. Values for the same element are summed. The
+	///matrix is not changed until compress() is called.
+	void add(int r, int c, Precision v)
+	{
+		Internal::check_index(my_rows, r);
+		Internal::check_index(my_cols, c);
+		my_pending.push_back(Entry(Index::major(r, c), Index::minor(r, c), v));
+	}
+
+	///Merge the values added by add() in to the compressed storage.
+	void compress()
+	{
+		if(my_pending.empty())
+			return;
+
+		//Existing elements are merged as if they were newly added
+		for(int i=0; i < major_size(); i++)
+			for(int p=my_offsets[i]; p < my_offsets[i+1]; p++)
+				my_pending.push_back(Entry(i, my_indices[p], my_values[p]));
+
+		std::sort(my_pending.begin(), my_pending.end());
+
+		my_indices.clear();
+		my_values.clear();
+		std::fill(my_offsets.begin(), my_offsets.end(), 0);
+
+		for(size_t e=0; e < my_pending.size(); e++)
+		{
+			const Entry& entry = my_pending[e];
+			if(e > 0 && entry.major == my_pending[e-1].major && entry.minor == my_pending[e-1].minor)
+				my_values.back() += entry.value;
+			else
+			{
+				my_offsets[entry.major+1]++;
+				my_indices.push_back(entry.minor);
+				my_values.push_back(entry.value);
+			}
+		}
+		for(int i=0; i < major_size(); i++)
+			my_offsets[i+1] += my_offsets[i];
+
+		std::vector<Entry>().swap(my_pending);
+	}
+
+	///Compute \f$\underline{y} = A\underline{x}\f$ without allocating memory.
+	///@param x The vector to multiply
+	///@param y The result, which must be the right size
+	template<int S1, class P1, class B1, int S2, class B2>
+	void multiply(const Vector<S1, P1, B1>& x, Vector<S2, Precision, B2>& y) const
+	{
+		SizeMismatch<Dynamic, S1>::test(my_cols, x.size());
+		SizeMismatch<Dynamic, S2>::test(my_rows, y.size());
+		multiply(x, y, Layout());
+	}
+
+	///Return the transpose. This has the same arrays, with the other layout.
+	SparseMatrix<Precision, typename Internal::TransposedLayout<Layout>::type> T() const
+	{
+		SparseMatrix<Precision, typename Internal::TransposedLayout<Layout>::type> t(my_cols, my_rows);
+		t.my_offsets = my_offsets;
+		t.my_indices = my_indices;
+		t.my_values = my_values;
+		return t;
+	}
+
+	///Return the equivalent dense matrix.
+	Matrix<Dynamic, Dynamic, Precision> get_matrix() const
+	{
+		Matrix<Dynamic, Dynamic, Precision, Layout> m(my_rows, my_cols);
+		m = Zeros;
+		for(int i=0; i < major_size(); i++)
+			for(int p=my_offsets[i]; p < my_offsets[i+1]; p++)
+				m(Index::major(i, my_indices[p]), Index::minor(i, my_indices[p])) = my_values[p];
+		return m;
+	}
+
+	const std::vector<int>& get_offsets() const { return my_offsets; } ///< Start of each row (CSR) or column (CSC), with the number of elements at the end
+	const std::vector<int>& get_indices() const { return my_indices; } ///< Column (CSR) or row (CSC) index of each element
+	const std::vector<Precision>& get_values() const { return my_values; } ///< Value of each element
+	std::vector<Precision>& get_values() { return my_values; } ///< Value of each element. These can be changed without changing the structure.
+
+private:
+	template<class P2, class L2> friend class SparseMatrix;
+
+	int major_size() const { return Index::major(my_rows, my_cols); }
+
+	template<int S1, class P1, class B1, int S2, class B2>
+	void multiply(const Vector<S1, P1, B1>& x, Vector<S2, Precision, B2>& y, RowMajor) const
+	{
+		//Rows are independent
+		#ifdef _OPENMP
+		#pragma omp parallel for schedule(dynamic, 256) if(my_rows >= 4096)
+		#endif
+		for(int r=0; r < my_rows; r++)
+		{
+			Precision sum = 0;
+			for(int p=my_offsets[r]; p < my_offsets[r+1]; p++)
+				sum += my_values[p] * x[my_indices[p]];
+			y[r] = sum;
+		}
+	}
+
+	template<int S1, class P1, class B1, int S2, class B2>
+	void multiply(const Vector<S1, P1, B1>& x, Vector<S2, Precision, B2>& y, ColMajor) const
+	{
+		//Columns scatter in to y, so this is sequential
+		y = Zeros;
+		for(int c=0; c < my_cols; c++)
+		{
+			const Precision xc = x[c];
+			for(int p=my_offsets[c]; p < my_offsets[c+1]; p++)
+				y[my_indices[p]] += my_values[p] * xc;
+		}
+	}
+
+	struct Entry
+	{
+		Entry(int ma, int mi, Precision v):major(ma), minor(mi), value(v){}
+		bool operator<(const Entry& e) const
+		{
+			return major < e.major || (major == e.major && minor < e.minor);
+		}
+		int major, minor;
+		Precision value;
+	};
+
+	int my_rows, my_cols;
+	std::vector<int> my_offsets;
+	std::vector<int> my_indices;
+	std::vector<Precision> my_values;
+	std::vector<Entry> my_pending;
+};
+
+///Sparse matrix-vector multiplication.
+///@ingroup gLinAlg
+template<class P1, class Layout, int S2, class P2, class B2>
+Vector<Dynamic, P1> operator*(const SparseMatrix<P1, Layout>& m, const Vector<S2, P2, B2>& v)
+{
+	Vector<Dynamic, P1> result(m.num_rows());
+	m.multiply(v, result);
+	return result;
+}
+
+/**
+Compute a fill reducing ordering for the Cholesky decomposition of a sparse
+symmetric matrix, using the minimum degree heuristic. The structure of
+\f$A + A^{\mathsf T}\f$ is used, so only one triangle of the matrix needs
+to be stored.
+
+The elimination graph is updated exactly after each elimination, rather
+than using the approximate degrees of AMD. Ties are broken by the lowest
+index, so the result is repeatable.
+
+@param m The matrix
+@return The ordering: element \e k is the index of the row and column to eliminate \e k th
+@ingroup gLinAlg
+**/
+template<class Precision, class Layout>
+std::vector<int> minimum_degree_ordering(const SparseMatrix<Precision, Layout>& m)
+{
+	SizeMismatch<Dynamic, Dynamic>::test(m.num_rows(), m.num_cols());
+	const int n = m.num_rows();
+	const std::vector<int>& offsets = m.get_offsets();
+	const std::vector<int>& indices = m.get_indices();
+
+	//Symmetric adjacency lists, sorted and without the diagonal
+	std::vector<std::vector<int> > adjacent(n);
+	for(int i=0; i < n; i++)
+		for(int p=offsets[i]; p < offsets[i+1]; p++)
+			if(indices[p] != i)
+			{
+				adjacent[i].push_back(indices[p]);
+				adjacent[indices[p]].push_back(i);
+			}
+
+	std::set<std::pair<int, int> > queue;
+	for(int i=0; i < n; i++)
+	{
+		std::sort(adjacent[i].begin(), adjacent[i].end());
+		adjacent[i].erase(std::unique(adjacent[i].begin(), adjacent[i].end()), adjacent[i].end());
+		queue.insert(std::make_pair(static_cast<int>(adjacent[i].size()), i));
+	}
+
+	std::vector<int> order;
+	order.reserve(n);
+	std::vector<int> merged;
+
+	while(!queue.empty())
+	{
+		const int p = queue.begin()->second;
+		queue.erase(queue.begin());
+		order.push_back(p);
+
+		//Eliminating p makes its neighbours a clique
+		const std::vector<int>& clique = adjacent[p];
+		for(size_t k=0; k < clique.size(); k++)
+		{
+			const int u = clique[k];
+			std::vector<int>& adj = adjacent[u];
+			queue.erase(std::make_pair(static_cast<int>(adj.size()), u));
+
+			merged.clear();
+			std::set_union(adj.begin(), adj.end(), clique.begin(), clique.end(), std::back_inserter(merged));
+			adj.clear();
+			for(size_t j=0; j < merged.size(); j++)
+				if(merged[j] != u && merged[j] != p)
+					adj.push_back(merged[j]);
+
+			queue.insert(std::make_pair(static_cast<int>(adj.size()), u));
+		}
+		std::vector<int>().swap(adjacent[p]);
+	}
+
+	return order;
+}
+
+}
+
+#endif
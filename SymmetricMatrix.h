@@ -0,0 +1,231 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_SYMMETRIC_MATRIX_H
+#define TOON_INCLUDE_SYMMETRIC_MATRIX_H
+
+#include <TooN/TooN.h>
+#include <algorithm>
+
+namespace TooN {
+
+/**
+A symmetric matrix, stored in packed form so that it uses half the memory
+of a full Matrix. Information matrices, such as the inverse covariance
+accumulated by WLS, are a typical use.
+
+Only the upper right triangle is stored, row by row, so element \f$(r,c)\f$,
+\f$r \le c\f$, is at position \f$r(2n - r - 1)/2 + c\f$ of get_packed(). This
+is the same as LAPACK's lower packed format (\c UPLO="L"). Elements can be
+accessed with either index order.
+@code
+  SymmetricMatrix<> S(100);
+  S.get_packed() = Zeros;
+  S.add_rank_1(J, w);            // S += w J J^T
+  Vector<> y = S * x;
+  Cholesky<> chol(S);
+@endcode
+
+@param Size The number of rows and columns
+@param Precision The precision of the elements
+@ingroup gLinAlg
+**/
+template<int Size=Dynamic, class Precision=DefaultPrecision>
+class SymmetricMatrix
+{
+public:
+	///The size of the packed storage
+	static const int PackedSize = Size==Dynamic ? Dynamic : Size*(Size+1)/2;
+
+	///Construct an uninitialized matrix. The size is only required if
+	///Size is Dynamic.
+	explicit SymmetricMatrix(int size=Size)
+	:my_size(size), my_packed(size*(size+1)/2)
+	{}
+
+	///Construct from the upper right triangle of a square matrix.
+	template<int R, int C, class P2, class B2>
+	explicit SymmetricMatrix(const Matrix<R, C, P2, B2>& m)
+	:my_size(m.num_rows()), my_packed(m.num_rows()*(m.num_rows()+1)/2)
+	{
+		SizeMismatch<R, C>::test(m.num_rows(), m.num_cols());
+		SizeMismatch<Size, R>::test(my_size, m.num_rows());
+		for(int r=0; r < my_size; r++)
+		{
+			Precision* row = &my_packed[offset(r)];
+			for(int c=r; c < my_size; c++)
+				row[c] = m[r][c];
+		}
+	}
+
+	int num_rows() const { return my_size; } ///< The number of rows
+	int num_cols() const { return my_size; } ///< The number of columns
+
+	///Access an element. Elements \f$(r,c)\f$ and \f$(c,r)\f$ are the same.
+	Precision& operator()(int r, int c)
+	{
+		return r <= c ? my_packed[offset(r) + c] : my_packed[offset(c) + r];
+	}
+
+	///Access an element. Elements \f$(r,c)\f$ and \f$(c,r)\f$ are the same.
+	const Precision& operator()(int r, int c) const
+	{
+		return r <= c ? my_packed[offset(r) + c] : my_packed[offset(c) + r];
+	}
+
+	///The packed upper right triangle. This can be used to operate on all
+	///elements at once, for instance <code>S.get_packed() = Zeros</code>.
+	Vector<PackedSize, Precision>& get_packed() { return my_packed; }
+	///The packed upper right triangle.
+	const Vector<PackedSize, Precision>& get_packed() const { return my_packed; }
+
+	///Return the equivalent full matrix.
+	Matrix<Size, Size, Precision> get_matrix() const
+	{
+		Matrix<Size, Size, Precision> m(my_size, my_size);
+		for(int r=0; r < my_size; r++)
+		{
+			const Precision* row = &my_packed[offset(r)];
+			for(int c=r; c < my_size; c++)
+				m[r][c] = m[c][r] = row[c];
+		}
+		return m;
+	}
+
+	///Add another symmetric matrix.
+	SymmetricMatrix& operator+=(const SymmetricMatrix& s)
+	{
+		my_packed += s.my_packed;
+		return *this;
+	}
+
+	///Add a constant to the diagonal.
+	void add_diagonal(Precision d)
+	{
+		for(int r=0; r < my_size; r++)
+			my_packed[offset(r) + r] += d;
+	}
+
+	///Rank 1 update, \f$S \leftarrow S + w\underline{v}\underline{v}^{\mathsf T}\f$.
+	///@param v The vector
+	///@param w The weight
+	template<int S2, class P2, class B2>
+	void add_rank_1(const Vector<S2, P2, B2>& v, Precision w=1)
+	{
+		SizeMismatch<Size, S2>::test(my_size, v.size());
+		for(int r=0; r < my_size; r++)
+		{
+			Precision* row = &my_packed[offset(r)];
+			const Precision a = w * v[r];
+			for(int c=r; c < my_size; c++)
+				row[c] += a * v[c];
+		}
+	}
+
+	///Rank k update, \f$S \leftarrow S + J^{\mathsf T}\text{diag}(\underline{w})J\f$.
+	///This is the same as calling add_rank_1() for each row of \e J, but the rows
+	///are processed in blocks to make better use of the cache.
+	///@param J The matrix, with one row per update
+	///@param w The weight for each row
+	template<int N, int C, class P2, class B2, class P3, class B3>
+	void add_rank_k(const Matrix<N, C, P2, B2>& J, const Vector<N, P3, B3>& w)
+	{
+		SizeMismatch<Size, C>::test(my_size, J.num_cols());
+		SizeMismatch<N, N>::test(J.num_rows(), w.size());
+
+		//Packed copies of a block of rows of J, and the weighted rows
+		const int block = 64;
+		Matrix<Dynamic, Size, Precision> Jb(std::min(block, J.num_rows()), my_size);
+		Matrix<Dynamic, Size, Precision> WJb(std::min(block, J.num_rows()), my_size);
+
+		for(int k0=0; k0 < J.num_rows(); k0 += block)
+		{
+			const int kb = std::min(block, J.num_rows() - k0);
+			for(int k=0; k < kb; k++)
+			{
+				Jb[k] = J[k0+k];
+				WJb[k] = Jb[k] * w[k0+k];
+			}
+
+			//Each row of S stays in cache while the whole block is applied
+			for(int r=0; r < my_size; r++)
+			{
+				Precision* row = &my_packed[offset(r)];
+				for(int k=0; k < kb; k++)
+				{
+					const Precision a = WJb[k][r];
+					const Precision* Jk = &Jb[k][0];
+					for(int c=r; c < my_size; c++)
+						row[c] += a * Jk[c];
+				}
+			}
+		}
+	}
+
+private:
+	//Position of element (r,0) in the packed storage, were it stored.
+	//Only elements (r,c) with c >= r may be accessed from here.
+	int offset(int r) const
+	{
+		return r*(2*my_size - r - 1)/2;
+	}
+
+	int my_size;
+	Vector<PackedSize, Precision> my_packed;
+};
+
+///Symmetric matrix-vector multiplication.
+///@ingroup gLinAlg
+template<int Size, class P1, int S2, class P2, class B2>
+Vector<Size, typename Internal::MultiplyType<P1, P2>::type> operator*(const SymmetricMatrix<Size, P1>& s, const Vector<S2, P2, B2>& v)
+{
+	typedef typename Internal::MultiplyType<P1, P2>::type P;
+	SizeMismatch<Size, S2>::test(s.num_rows(), v.size());
+
+	const int n = s.num_rows();
+	const P1* packed = &s.get_packed()[0];
+	Vector<Size, P> result(n);
+	result = Zeros;
+
+	//Each stored element (r,c) contributes to rows r and c
+	for(int r=0; r < n; r++, packed += n - r + 1)
+	{
+		P sum = packed[0] * v[r];
+		const P2 vr = v[r];
+		for(int c=r+1; c < n; c++)
+		{
+			sum += packed[c-r] * v[c];
+			result[c] += packed[c-r] * vr;
+		}
+		result[r] += sum;
+	}
+	return result;
+}
+
+}
+
+#endif
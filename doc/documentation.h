@@ -616,13 +616,24 @@ This section is arranged as a FAQ. Most answers include code fragments. Assume
 	\subsection sDecompos  Which decomposisions are there?
 
 	For general size matrices (not necessarily square) there are:
-	@link TooN::LU LU @endlink, @link TooN::SVD SVD @endlink, @link TooN::QR QR@endlink, @link TooN::QR_Lapack LAPACK's QR@endlink and gauss_jordan()
+	@link TooN::LU LU @endlink, @link TooN::SVD SVD @endlink, @link TooN::QR QR@endlink, @link TooN::QR_Blocked blocked QR@endlink, @link TooN::QR_Lapack LAPACK's QR@endlink and gauss_jordan()
+
+	For small matrices of static size there are also @link TooN::GR_SVD GR_SVD@endlink and
+	@link TooN::Jacobi_SVD Jacobi_SVD@endlink which do not require LAPACK.
 
 	For square symmetric matrices there are:
 	@link TooN::SymEigen SymEigen @endlink and @link TooN::Cholesky Cholesky @endlink
 
 	If all you want to do is solve a single Ax=b then you may want gaussian_elimination()
 
+	For large systems, @link TooN::MixedPrecision MixedPrecision@endlink factors the matrix in
+	single precision and uses iterative refinement to get a double precision solution.
+
+	For large sparse symmetric matrices, stored in a @link TooN::SparseMatrix SparseMatrix@endlink,
+	there is @link TooN::SparseCholesky SparseCholesky@endlink. Large symmetric positive definite
+	systems can also be solved iteratively with @link TooN::PCG PCG@endlink, which only
+	needs matrix-vector products.
+
 	\subsection sOtherStuff What other stuff is there:
 	
 	Look at the @link modules modules @endlink.
@@ -970,6 +981,19 @@ The individual functions are:
 Note that these macros do not affect classes that are currently only wrappers
 around LAPACK.
 
+\subsection sConfigOpenMP Multithreading
+
+TooN does not start any threads itself. A few functions are able to split
+their work between threads using OpenMP, if it is enabled when compiling
+(e.g. with <code>-fopenmp</code>); otherwise they run sequentially. These are:
+- TooN::WLS::add_mJ_parallel()
+- TooN::IRLS::add_mJ_rows()
+- TooN::SchurComplement::compute()
+- TooN::SparseMatrix::multiply() (for CSR storage)
+- TooN::numerical_gradient_parallel() and TooN::numerical_hessian_parallel()
+- TooN::DownhillSimplex (if TooN::DownhillSimplex::parallel is set)
+- TooN::MultiStart (if TooN::MultiStart::parallel is set)
+
 **/
 
 ///////////////////////////////////////////////////////
@@ -1004,16 +1028,28 @@ The following functions find the minimum of a 1-D function:
  - golden_section_search()
  - brent_line_search()
 
+golden_section_search_batch() and brent_line_search_batch() solve many independent
+1-D problems at once, advancing them together.
+
 @section gMultiDim Multidimensional dimensional function optimization
 
 The following classes perform multidimensional function minimization:
  - TooN::DownhillSimplex
  - TooN::ConjugateGradient
+ - TooN::LBFGS
+ - TooN::LevenbergMarquardt (for least squares problems)
 
 The mode of operation is to set up a mutable class, then repeatedly call an
 iterate function. This allows different sub algorithms (such as termination
 conditions) to be substituted in if need be.
 
+The number of evaluations, step sizes and timings of an optimization can be
+monitored with an observer, such as TooN::OptimizationTrace, which records them
+for output as CSV or JSON. See TooN::NullObserver.
+
+TooN::MultiStart runs many of these optimizers together, for instance from
+different starting points, and terminates runs which are clearly losing.
+
 @internal
 @defgroup gInternal TooN internals
 
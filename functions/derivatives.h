@@ -27,8 +27,13 @@
 #define TOON_INCLUDE_DERIVATIVES_NUMERICAL_H
 
 #include <TooN/TooN.h>
+#include <TooN/SparseMatrix.h>
 #include <vector>
+#include <map>
 #include <cmath>
+#include <complex>
+#include <limits>
+#include <algorithm>
 
 using namespace std;
 using namespace TooN;
@@ -154,42 +159,109 @@ namespace TooN{
 				//and some good points have been seen, then break.
 				if(ever_ok && !better && i > 0 && (abs(P_i[i] - P_i_1[i-1]) > t * best_err|| isnan(P_i[i])))
 					break;
+
+				//An exact answer can not be improved on, so there is no point
+				//in evaluating any more points.
+				if(best_err == 0)
+					break;
 			}
 
 			return std::make_pair(best_point, best_err);
 		}
 
 		///@internal
-		///@brief Functor wrapper for computing finite differences along an axis.
+		///@brief Evaluations of a function about a point, which are remembered so
+		///that they can be shared between the gradient and the Hessian. The points
+		///along each axis are indexed by the step passed to extrapolate_to_zero(),
+		///which takes the same sequence of values every time.
 		///@ingroup gInternal
-		template<class Functor, class  Precision, int Size, class Base> struct CentralDifferenceGradient
+		template<class Functor, class  Precision, int Size, class Base> struct EvaluationCache
 		{
 			const Vector<Size, Precision, Base>& v; ///< Point about which to compute differences
-			Vector<Size, Precision> x;      ///< Local copy of v
+			Vector<Size, Precision> x;              ///< Local copy of v
 			const Functor&  f;                      ///< Functor to evaluate
-			int i;                                  ///< Index to difference along
+			int evaluations;                        ///< Number of times f has been evaluated
 
-			CentralDifferenceGradient(const Vector<Size, Precision, Base>& v_, const Functor& f_)
-			:v(v_),x(v),f(f_),i(0)
+			EvaluationCache(const Vector<Size, Precision, Base>& v_, const Functor& f_)
+			:v(v_),x(v),f(f_),evaluations(0),have_central(0),axes(v.size())
 			{}
-			
-			///Compute central difference.
-			Precision operator()(Precision hh) 
+
+			///Make the step size be on the scale of the value.
+			Precision step(int i, Precision hh) const
 			{
 				using std::max;
 				using std::abs;
+				return hh * max(abs(v[i]) * 1e-3, 1e-3);
+			}
 
-				//Make the step size be on the scale of the value.
-				double h = hh * max(abs(v[i]) * 1e-3, 1e-3);
+			///Evaluate the function at v.
+			Precision central()
+			{
+				if(!have_central)
+				{
+					central_value = f(x);
+					evaluations++;
+					have_central = 1;
+				}
+				return central_value;
+			}
 
-				x[i] = v[i] - h;
-				double f1 = f(x);
-				x[i] = v[i] + h;
-				double f2 = f(x);
+			///Evaluate the function at \f$v - he_i\f$ and \f$v + he_i\f$.
+			const std::pair<Precision, Precision>& axis(int i, Precision hh)
+			{
+				typename std::map<Precision, std::pair<Precision, Precision> >::iterator e = axes[i].find(hh);
+				if(e == axes[i].end())
+				{
+					const Precision h = step(i, hh);
+					std::pair<Precision, Precision> p;
+					x[i] = v[i] - h;
+					p.first = f(x);
+					x[i] = v[i] + h;
+					p.second = f(x);
+					x[i] = v[i];
+					evaluations += 2;
+
+					e = axes[i].insert(std::make_pair(hh, p)).first;
+				}
+				return e->second;
+			}
+
+			///Evaluate the function at \f$v + h_ie_i + h_je_j\f$. These points
+			///are never shared, so they are not remembered.
+			Precision diagonal(int i, Precision hi, int j, Precision hj)
+			{
+				x[i] = v[i] + hi;
+				x[j] = v[j] + hj;
+				Precision r = f(x);
 				x[i] = v[i];
+				x[j] = v[j];
+				evaluations++;
+				return r;
+			}
+
+			private:
+				bool have_central;
+				Precision central_value;
+				std::vector<std::map<Precision, std::pair<Precision, Precision> > > axes;
+		};
 
-				double d =  (f2 - f1) / (2*h);
-				return d;
+		///@internal
+		///@brief Functor wrapper for computing finite differences along an axis.
+		///@ingroup gInternal
+		template<class Functor, class  Precision, int Size, class Base> struct CentralDifferenceGradient
+		{
+			EvaluationCache<Functor, Precision, Size, Base>& cache; ///< Function evaluations
+			int i;                                  ///< Index to difference along
+
+			CentralDifferenceGradient(EvaluationCache<Functor, Precision, Size, Base>& c)
+			:cache(c),i(0)
+			{}
+			
+			///Compute central difference.
+			Precision operator()(Precision hh) 
+			{
+				const std::pair<Precision, Precision>& f = cache.axis(i, hh);
+				return (f.second - f.first) / (2*cache.step(i, hh));
 			}
 		};
 
@@ -198,81 +270,180 @@ namespace TooN{
 		///@ingroup gInternal
 		template<class Functor, class  Precision, int Size, class Base> struct CentralDifferenceSecond
 		{
-			const Vector<Size, Precision, Base>& v; ///< Point about which to compute differences
-			Vector<Size, Precision> x;              ///< Local copy of v
-			const Functor&  f;                      ///< Functor to evaluate
+			EvaluationCache<Functor, Precision, Size, Base>& cache; ///< Function evaluations
 			int i;                                  ///< Index to difference along
-			const Precision central;                ///<Central point.
 
-			CentralDifferenceSecond(const Vector<Size, Precision, Base>& v_, const Functor& f_)
-			:v(v_),x(v),f(f_),i(0),central(f(x))
+			CentralDifferenceSecond(EvaluationCache<Functor, Precision, Size, Base>& c)
+			:cache(c),i(0)
 			{}
 			
 			///Compute central difference.
 			Precision operator()(Precision hh) 
 			{
-				using std::max;
-				using std::abs;
-
-				//Make the step size be on the scale of the value.
-				double h = hh * max(abs(v[i]) * 1e-3, 1e-3);
-
-				x[i] = v[i] - h;
-				double f1 = f(x);
-
-				x[i] = v[i] + h;
-				double f2 = f(x);
-				x[i] = v[i];
-
-				double d =  (f2 - 2*central + f1) / (h*h);
-				return d;
+				const std::pair<Precision, Precision>& f = cache.axis(i, hh);
+				const Precision h = cache.step(i, hh);
+				return (f.second - 2*cache.central() + f.first) / (h*h);
 			}
 		};
 
 		///@internal
 		///@brief Functor wrapper for computing finite difference cross derivatives along a pair of axes.
+		///Apart from the two points on the diagonal, the points are shared with
+		///the gradient and the second derivatives along the axes.
 		///@ingroup gInternal
 		template<class Functor, class  Precision, int Size, class Base> struct CentralCrossDifferenceSecond
 		{
-			const Vector<Size, Precision, Base>& v; ///< Point about which to compute differences
-			Vector<Size, Precision> x;              ///< Local copy of v
-			const Functor&  f;                      ///< Functor to evaluate
+			EvaluationCache<Functor, Precision, Size, Base>& cache; ///< Function evaluations
 			int i;                                  ///< Index to difference along
 			int j;                                  ///< Index to difference along
 
-			CentralCrossDifferenceSecond(const Vector<Size, Precision, Base>& v_, const Functor& f_)
-			:v(v_),x(v),f(f_),i(0),j(0)
+			CentralCrossDifferenceSecond(EvaluationCache<Functor, Precision, Size, Base>& c)
+			:cache(c),i(0),j(0)
 			{}
 			
 			///Compute central difference.
 			Precision operator()(Precision hh) 
 			{
-				using std::max;
-				using std::abs;
+				const Precision hi = cache.step(i, hh);
+				const Precision hj = cache.step(j, hh);
+
+				const Precision a = cache.diagonal(i, hi, j, hj);
+				const Precision d = cache.diagonal(i, -hi, j, -hj);
+				const std::pair<Precision, Precision>& fi = cache.axis(i, hh);
+				const std::pair<Precision, Precision>& fj = cache.axis(j, hh);
+
+				return (a - fi.second - fj.second + 2*cache.central() - fi.first - fj.first + d) / (2*hi*hj);
+			}
+		};
 
-				//Make the step size be on the scale of the value.
-				double h = hh * max(abs(v[i]) * 1e-3, 1e-3);
+		///@internal
+		///@brief Compute numerical gradients and errors using the evaluations in \e cache.
+		///@ingroup gInternal
+		template<class F, int S, class P, class B> void numerical_gradient(EvaluationCache<F, P, S, B>& cache, Matrix<S, 2, P>& g)
+		{
+			CentralDifferenceGradient<F, P, S, B> d(cache);
 
-				x[i] = v[i] + h;
-				x[j] = v[j] + h;
-				double a = f(x);
+			for(int i=0; i < g.num_rows(); i++)
+			{
+				d.i = i;
+				pair<P, P> r = extrapolate_to_zero<CentralDifferenceGradient<F, P, S, B>, P>(d);
+				g[i][0] = r.first;
+				g[i][1] = r.second;
+			}
+		}
 
-				x[i] = v[i] - h;
-				x[j] = v[j] + h;
-				double b = f(x);
+		///@internal
+		///@brief Compute an element of the numerical Hessian and its error using
+		///the evaluations in \e cache.
+		///@ingroup gInternal
+		template<class F, int S, class P, class B> pair<P, P> numerical_hessian_element(EvaluationCache<F, P, S, B>& cache, int r, int c)
+		{
+			if(r == c)
+			{
+				CentralDifferenceSecond<F, P, S, B> curv(cache);
+				curv.i = r;
+				return extrapolate_to_zero<CentralDifferenceSecond<F, P, S, B>, P>(curv);
+			}
+			else
+			{
+				CentralCrossDifferenceSecond<F, P, S, B> cross(cache);
+				cross.i = r;
+				cross.j = c;
+				return extrapolate_to_zero<CentralCrossDifferenceSecond<F, P, S, B>, P>(cross);
+			}
+		}
 
-				x[i] = v[i] + h;
-				x[j] = v[j] - h;
-				double c = f(x);
+		///@internal
+		///@brief Compute the numerical Hessian and errors using the evaluations in \e cache.
+		///The diagonal comes first, since its evaluations are shared by all the
+		///cross terms.
+		///@ingroup gInternal
+		template<class F, int S, class P, class B> void numerical_hessian(EvaluationCache<F, P, S, B>& cache, Matrix<S, S, P>& hess, Matrix<S, S, P>& errors)
+		{
+			for(int i=0; i < hess.num_rows(); i++)
+			{
+				pair<P, P> e = numerical_hessian_element(cache, i, i);
+				hess[i][i] = e.first;
+				errors[i][i] = e.second;
+			}
 
+			for(int r=0; r < hess.num_rows(); r++)
+				for(int c=r+1; c < hess.num_rows(); c++)
+				{
+					pair<P, P> e = numerical_hessian_element(cache, r, c);
+					hess[r][c] = hess[c][r] = e.first;
+					errors[r][c] = errors[c][r] = e.second;
+				}
+		}
 
-				x[i] = v[i] - h;
-				x[j] = v[j] - h;
-				double d = f(x);
+		///@internal
+		///@brief Compute numerical gradients and errors, using a separate copy of
+		///the functor in each thread if OpenMP is enabled.
+		///@ingroup gInternal
+		template<class F, int S, class P, class B> void numerical_gradient_parallel(const F& f, const Vector<S, P, B>& x, Matrix<S, 2, P>& g)
+		{
+			const int n = x.size();
 
-				return (a-b-c+d) / (4*h*h);
+			#ifdef _OPENMP
+			#pragma omp parallel
+			#endif
+			{
+				const F local_f(f);
+				EvaluationCache<F, P, S, B> cache(x, local_f);
+				CentralDifferenceGradient<F, P, S, B> d(cache);
+
+				#ifdef _OPENMP
+				#pragma omp for schedule(dynamic)
+				#endif
+				for(int i=0; i < n; i++)
+				{
+					d.i = i;
+					pair<P, P> r = extrapolate_to_zero<CentralDifferenceGradient<F, P, S, B>, P>(d);
+					g[i][0] = r.first;
+					g[i][1] = r.second;
+				}
 			}
-		};
+		}
+
+		///@internal
+		///@brief Compute the numerical Hessian and errors, using a separate copy of
+		///the functor in each thread if OpenMP is enabled.
+		///@ingroup gInternal
+		template<class F, int S, class P, class B> void numerical_hessian_parallel(const F& f, const Vector<S, P, B>& x, Matrix<S, S, P>& hess, Matrix<S, S, P>& errors)
+		{
+			const int n = x.size();
+
+			//The diagonal comes first, then the cross terms. Each thread
+			//shares evaluations between the elements which it computes.
+			std::vector<std::pair<int, int> > elements;
+			for(int i=0; i < n; i++)
+				elements.push_back(std::make_pair(i, i));
+			for(int r=0; r < n; r++)
+				for(int c=r+1; c < n; c++)
+					elements.push_back(std::make_pair(r, c));
+
+			const int num = elements.size();
+
+			#ifdef _OPENMP
+			#pragma omp parallel
+			#endif
+			{
+				const F local_f(f);
+				EvaluationCache<F, P, S, B> cache(x, local_f);
+
+				#ifdef _OPENMP
+				#pragma omp for schedule(dynamic)
+				#endif
+				for(int k=0; k < num; k++)
+				{
+					const int r = elements[k].first;
+					const int c = elements[k].second;
+					pair<P, P> e = numerical_hessian_element(cache, r, c);
+					hess[r][c] = hess[c][r] = e.first;
+					errors[r][c] = errors[c][r] = e.second;
+				}
+			}
+		}
 
 	}
 
@@ -350,18 +521,10 @@ namespace TooN{
 	*/
 	template<class F, int S, class P, class B> Vector<S, P> numerical_gradient(const F& f, const Vector<S, P, B>& x)
 	{
-		using namespace Internal;
-		Vector<S> grad(x.size());
-
-		CentralDifferenceGradient<F, P, S, B> d(x, f);
-
-		for(int i=0; i < x.size(); i++)
-		{
-			d.i = i;
-			grad[i] = extrapolate_to_zero<CentralDifferenceGradient<F, P, S, B>, P>(d).first;
-		}
-
-		return grad;
+		Internal::EvaluationCache<F, P, S, B> cache(x, f);
+		Matrix<S, 2, P> g(x.size(), 2);
+		Internal::numerical_gradient(cache, g);
+		return g.T()[0];
 	}
 	
 	///Compute numerical gradients with errors.
@@ -374,63 +537,297 @@ namespace TooN{
 	///@ingroup gFunctions 
 	template<class F, int S, class P, class B> Matrix<S,2,P> numerical_gradient_with_errors(const F& f, const Vector<S, P, B>& x)
 	{
-		using namespace Internal;
-		Matrix<S,2> g(x.size(), 2);
+		Internal::EvaluationCache<F, P, S, B> cache(x, f);
+		Matrix<S, 2, P> g(x.size(), 2);
+		Internal::numerical_gradient(cache, g);
+		return g;
+	}
+
+	///Compute numerical gradients using central differences with a fixed step:
+	///\f[
+	/// \frac{\partial f}{\partial x_i} \approx \frac{f(x + he_i) - f(x - he_i)}{2h}
+	///\f]
+	///This needs only two evaluations per dimension, so it is much faster than
+	///numerical_gradient(), but the accuracy depends on the choice of step and
+	///no error estimate is available. The step is scaled by the magnitude of
+	///each element of \e x (if it is larger than 1). The default of
+	///\f$\epsilon^{1/3}\f$ balances the truncation and rounding errors for a
+	///well scaled function.
+	///@param f Functor to differentiate
+	///@param x Point about which to differentiate.
+	///@param h Step size.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> Vector<S, P> numerical_gradient_central(const F& f, const Vector<S, P, B>& x, P h=std::pow(std::numeric_limits<P>::epsilon(), P(1)/3))
+	{
+		using std::max;
+		using std::abs;
 
-		CentralDifferenceGradient<F, P, S, B> d(x, f);
+		Vector<S, P> grad(x.size());
+		Vector<S, P> v = x;
 
 		for(int i=0; i < x.size(); i++)
 		{
-			d.i = i;
-			pair<double, double> r= extrapolate_to_zero<CentralDifferenceGradient<F, P, S, B>, P>(d);
-			g[i][0] = r.first;
-			g[i][1] = r.second;
+			//Use the step which is actually represented after adding it to x.
+			const P hi = (x[i] + h * max(abs(x[i]), P(1))) - x[i];
+
+			v[i] = x[i] + hi;
+			const P f2 = f(v);
+			v[i] = x[i] - hi;
+			const P f1 = f(v);
+			v[i] = x[i];
+
+			grad[i] = (f2 - f1) / (2*hi);
 		}
 
-		return g;
+		return grad;
 	}
 
-	
-	///Compute the numerical Hessian using central differences and Ridder's method:
-	///\f[
-	/// \frac{\partial^2 f}{\partial x^2} \approx \frac{f(x-h) - 2f(x) + f(x+h)}{h^2}
-	///\f]
+	///Compute numerical gradients using the complex step method:
 	///\f[
-	/// \frac{\partial^2 f}{\partial x\partial y} \approx \frac{f(x+h, y+h) - f(x-h,y+h) - f(x+h, y-h) + f(x-h, y-h)}{4h^2}
+	/// \frac{\partial f}{\partial x_i} \approx \frac{\mathrm{Im}(f(x + ihe_i))}{h}
 	///\f]
-	///See numerical_gradient().
-	///@param f Functor to double-differentiate
-    ///@param x Point about which to double-differentiate.
-	///@ingroup gFunctions 
-	template<class F, int S, class P, class B> pair<Matrix<S, S, P>, Matrix<S, S, P> > numerical_hessian_with_errors(const F& f, const Vector<S, P, B>& x)
+	///There is no subtraction, so there is no cancellation error and the step can
+	///be tiny. The result is accurate to machine precision with a single
+	///evaluation per dimension. The function must be real analytic, and
+	///written so that it can be called with a
+	///<code>Vector<S, std::complex<P> ></code>, for example by templating it on
+	///the precision:
+	///@code
+	///	struct Function
+	///	{
+	///		template<class P> P operator()(const Vector<Dynamic, P>& x) const
+	///		{
+	///			return sin(x[0]) * exp(x[1]);
+	///		}
+	///	};
+	///@endcode
+	///Functions which are not analytic, such as abs() and comparisons, will not
+	///give the correct answer.
+	///@param f Functor to differentiate
+	///@param x Point about which to differentiate.
+	///@param h Step size.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> Vector<S, P> numerical_gradient_complex_step(const F& f, const Vector<S, P, B>& x, P h=1e-20)
 	{
-		using namespace Internal;
-		Matrix<S> hess(x.size(), x.size());
-		Matrix<S> errors(x.size(), x.size());
+		Vector<S, P> grad(x.size());
+		Vector<S, std::complex<P> > v(x.size());
 
-		CentralDifferenceSecond<F, P, S, B> curv(x, f);
-		CentralCrossDifferenceSecond<F, P, S, B> cross(x, f);
+		for(int i=0; i < x.size(); i++)
+			v[i] = x[i];
 
-		//Perform the cross differencing.
+		for(int i=0; i < x.size(); i++)
+		{
+			v[i] = std::complex<P>(x[i], h);
+			grad[i] = std::imag(f(v)) / h;
+			v[i] = x[i];
+		}
+
+		return grad;
+	}
 
-		for(int r=0; r < x.size(); r++)
-			for(int c=r+1; c < x.size(); c++)
+	///Colour the columns of a Jacobian, so that no two columns of the same
+	///colour have an element in the same row. Such columns are structurally
+	///orthogonal, so they can be differenced together by numerical_jacobian().
+	///The columns are coloured greedily, in order of decreasing number of
+	///elements, and each is given the smallest colour which is not used by a
+	///column that it shares a row with.
+	///@param pattern A matrix with the same structure as the Jacobian. The values are ignored.
+	///@return The colour of each column. The colours are numbered from 0.
+	///@ingroup gFunctions
+	template<class P, class Layout> std::vector<int> column_colouring(const SparseMatrix<P, Layout>& pattern)
+	{
+		typedef Internal::SparseIndex<Layout> Index;
+		const int rows = pattern.num_rows();
+		const int cols = pattern.num_cols();
+		const std::vector<int>& offsets = pattern.get_offsets();
+		const std::vector<int>& indices = pattern.get_indices();
+
+		std::vector<std::vector<int> > row_columns(rows), column_rows(cols);
+		for(int i=0; i+1 < static_cast<int>(offsets.size()); i++)
+			for(int p=offsets[i]; p < offsets[i+1]; p++)
 			{
-				cross.i = r;
-				cross.j = c;
-				pair<double, double> e =  extrapolate_to_zero<CentralCrossDifferenceSecond<F, P, S, B>, P >(cross);
-				hess[r][c] = hess[c][r] = e.first;
-				errors[r][c] = errors[c][r] = e.second;
+				const int r = Index::major(i, indices[p]);
+				const int c = Index::minor(i, indices[p]);
+				row_columns[r].push_back(c);
+				column_rows[c].push_back(r);
 			}
 
-		for(int i=0; i < x.size(); i++)
+		std::vector<std::pair<int, int> > order(cols);
+		for(int c=0; c < cols; c++)
+			order[c] = std::make_pair(-static_cast<int>(column_rows[c].size()), c);
+		std::sort(order.begin(), order.end());
+
+		std::vector<int> colours(cols, -1);
+		std::vector<int> used(cols, -1);
+		for(int k=0; k < cols; k++)
+		{
+			const int c = order[k].second;
+
+			//Mark the colours of the neighbouring columns as used by c
+			for(size_t i=0; i < column_rows[c].size(); i++)
+			{
+				const std::vector<int>& neighbours = row_columns[column_rows[c][i]];
+				for(size_t j=0; j < neighbours.size(); j++)
+					if(colours[neighbours[j]] != -1)
+						used[colours[neighbours[j]]] = c;
+			}
+
+			int colour = 0;
+			while(used[colour] == c)
+				colour++;
+			colours[c] = colour;
+		}
+
+		return colours;
+	}
+
+	///Compute a sparse numerical Jacobian using central differences with a
+	///fixed step. All the columns of the same colour are perturbed at once, so
+	///this needs two evaluations of \e f per colour, instead of two per
+	///column. The Jacobian has the same structure and layout as the pattern,
+	///and its dense form can be found with SparseMatrix::get_matrix().
+	///See numerical_gradient_central() for the choice of step.
+	///@param f Functor returning a Vector of residuals.
+	///@param x Point about which to differentiate.
+	///@param pattern A matrix with the same structure as the Jacobian. The values are ignored.
+	///@param colours The colour of each column, from column_colouring().
+	///@param h Step size.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B, class P2, class Layout> SparseMatrix<P, Layout> numerical_jacobian(const F& f, const Vector<S, P, B>& x, const SparseMatrix<P2, Layout>& pattern, const std::vector<int>& colours, P h=std::pow(std::numeric_limits<P>::epsilon(), P(1)/3))
+	{
+		using std::max;
+		using std::abs;
+		typedef Internal::SparseIndex<Layout> Index;
+
+		SizeMismatch<Dynamic, S>::test(pattern.num_cols(), x.size());
+		const int cols = x.size();
+
+		//The elements of J in each column, as (row, position in the values)
+		const std::vector<int>& offsets = pattern.get_offsets();
+		const std::vector<int>& indices = pattern.get_indices();
+		std::vector<std::vector<std::pair<int, int> > > column_elements(cols);
+		for(int i=0; i+1 < static_cast<int>(offsets.size()); i++)
+			for(int p=offsets[i]; p < offsets[i+1]; p++)
+				column_elements[Index::minor(i, indices[p])].push_back(std::make_pair(Index::major(i, indices[p]), p));
+
+		int num_colours = 0;
+		for(int c=0; c < cols; c++)
+			num_colours = max(num_colours, colours[c] + 1);
+
+		std::vector<std::vector<int> > colour_columns(num_colours);
+		for(int c=0; c < cols; c++)
+			colour_columns[colours[c]].push_back(c);
+
+		//The Jacobian has the same elements as the pattern, in the same order.
+		SparseMatrix<P, Layout> J(pattern.num_rows(), cols);
+		for(int c=0; c < cols; c++)
+			for(size_t e=0; e < column_elements[c].size(); e++)
+				J.add(column_elements[c][e].first, c, 0);
+		J.compress();
+		std::vector<P>& values = J.get_values();
+
+		Vector<S, P> v = x;
+		Vector<S, P> steps(cols);
+		for(int c=0; c < cols; c++)
+			steps[c] = (x[c] + h * max(abs(x[c]), P(1))) - x[c];
+
+		for(int k=0; k < num_colours; k++)
+		{
+			const std::vector<int>& group = colour_columns[k];
+
+			for(size_t i=0; i < group.size(); i++)
+				v[group[i]] = x[group[i]] + steps[group[i]];
+			const Vector<Dynamic, P> f2 = f(v);
+
+			for(size_t i=0; i < group.size(); i++)
+				v[group[i]] = x[group[i]] - steps[group[i]];
+			const Vector<Dynamic, P> f1 = f(v);
+
+			for(size_t i=0; i < group.size(); i++)
+			{
+				const int c = group[i];
+				v[c] = x[c];
+				for(size_t e=0; e < column_elements[c].size(); e++)
+				{
+					const int r = column_elements[c][e].first;
+					values[column_elements[c][e].second] = (f2[r] - f1[r]) / (2*steps[c]);
+				}
+			}
+		}
+
+		return J;
+	}
+
+	///Compute a sparse numerical Jacobian, colouring the columns with
+	///column_colouring(). If the Jacobian is computed repeatedly, it is
+	///cheaper to compute the colours once.
+	///@param f Functor returning a Vector of residuals.
+	///@param x Point about which to differentiate.
+	///@param pattern A matrix with the same structure as the Jacobian. The values are ignored.
+	///@param h Step size.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B, class P2, class Layout> SparseMatrix<P, Layout> numerical_jacobian(const F& f, const Vector<S, P, B>& x, const SparseMatrix<P2, Layout>& pattern, P h=std::pow(std::numeric_limits<P>::epsilon(), P(1)/3))
+	{
+		return numerical_jacobian(f, x, pattern, column_colouring(pattern), h);
+	}
+
+	///Compute a dense numerical Jacobian using central differences with a
+	///fixed step. This needs two evaluations of \e f per column.
+	///See numerical_gradient_central() for the choice of step.
+	///@param f Functor returning a Vector of residuals.
+	///@param x Point about which to differentiate.
+	///@param h Step size.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> Matrix<Dynamic, S, P> numerical_jacobian(const F& f, const Vector<S, P, B>& x, P h=std::pow(std::numeric_limits<P>::epsilon(), P(1)/3))
+	{
+		using std::max;
+		using std::abs;
+
+		Vector<S, P> v = x;
+		Vector<S, P> steps(x.size());
+		for(int c=0; c < x.size(); c++)
+			steps[c] = (x[c] + h * max(abs(x[c]), P(1))) - x[c];
+
+		//The first column determines the number of residuals.
+		std::vector<Vector<Dynamic, P> > columns;
+		for(int c=0; c < x.size(); c++)
 		{
-			curv.i = i;
-			pair<double, double> e = extrapolate_to_zero<CentralDifferenceSecond<F, P, S, B>, P>(curv);
-			hess[i][i] = e.first;
-			errors[i][i] = e.second;
+			v[c] = x[c] + steps[c];
+			const Vector<Dynamic, P> f2 = f(v);
+			v[c] = x[c] - steps[c];
+			const Vector<Dynamic, P> f1 = f(v);
+			v[c] = x[c];
+
+			columns.push_back((f2 - f1) / (2*steps[c]));
 		}
 
+		Matrix<Dynamic, S, P> J(x.size() ? columns[0].size() : 0, x.size());
+		for(int c=0; c < x.size(); c++)
+			J.T()[c] = columns[c];
+
+		return J;
+	}
+
+	
+	///Compute the numerical Hessian using central differences and Ridder's method:
+	///\f[
+	/// \frac{\partial^2 f}{\partial x^2} \approx \frac{f(x-h) - 2f(x) + f(x+h)}{h^2}
+	///\f]
+	///\f[
+	/// \frac{\partial^2 f}{\partial x\partial y} \approx \frac{f(x+h, y+k) - f(x+h, y) - f(x, y+k) + 2f(x, y) - f(x-h, y) - f(x, y-k) + f(x-h, y-k)}{2hk}
+	///\f]
+	///The function evaluations along each axis are remembered, so they are shared
+	///between the diagonal and all of the cross terms. Each cross term needs only two
+	///new evaluations per step size. See numerical_gradient().
+	///@param f Functor to double-differentiate
+    ///@param x Point about which to double-differentiate.
+	///@ingroup gFunctions 
+	template<class F, int S, class P, class B> pair<Matrix<S, S, P>, Matrix<S, S, P> > numerical_hessian_with_errors(const F& f, const Vector<S, P, B>& x)
+	{
+		Internal::EvaluationCache<F, P, S, B> cache(x, f);
+		Matrix<S, S, P> hess(x.size(), x.size());
+		Matrix<S, S, P> errors(x.size(), x.size());
+		Internal::numerical_hessian(cache, hess, errors);
 		return make_pair(hess, errors);
 	}
 	
@@ -442,31 +839,106 @@ namespace TooN{
 	///@ingroup gFunctions 
 	template<class F, int S, class P, class B> Matrix<S, S, P> numerical_hessian(const F& f, const Vector<S, P, B>& x)
 	{
-		using namespace Internal;
-		Matrix<S> hess(x.size(), x.size());
+		Internal::EvaluationCache<F, P, S, B> cache(x, f);
+		Matrix<S, S, P> hess(x.size(), x.size());
+		Matrix<S, S, P> errors(x.size(), x.size());
+		Internal::numerical_hessian(cache, hess, errors);
+		return hess;
+	}
 
-		CentralDifferenceSecond<F, P, S, B> curv(x, f);
-		CentralCrossDifferenceSecond<F, P, S, B> cross(x, f);
+	///Compute the numerical gradient and Hessian together. This is cheaper than
+	///calling numerical_gradient() and numerical_hessian() separately, since the
+	///evaluations used for the gradient are shared with the Hessian. The results
+	///are identical. The gradient is returned as the first element, and the
+	///Hessian as the second.
+	///@param f Functor to differentiate
+	///@param x Point about which to differentiate.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> pair<Vector<S, P>, Matrix<S, S, P> > numerical_gradient_and_hessian(const F& f, const Vector<S, P, B>& x)
+	{
+		Internal::EvaluationCache<F, P, S, B> cache(x, f);
+		Matrix<S, 2, P> g(x.size(), 2);
+		Matrix<S, S, P> hess(x.size(), x.size());
+		Matrix<S, S, P> errors(x.size(), x.size());
+		Internal::numerical_gradient(cache, g);
+		Internal::numerical_hessian(cache, hess, errors);
+		return make_pair(g.T()[0], hess);
+	}
 
-		//Perform the cross differencing.
-		for(int r=0; r < x.size(); r++)
-			for(int c=r+1; c < x.size(); c++)
-			{
-				cross.i = r;
-				cross.j = c;
-				pair<double, double> e =  extrapolate_to_zero<CentralCrossDifferenceSecond<F, P, S, B>, P >(cross);
-				hess[r][c] = hess[c][r] = e.first;
-			}
+	///Compute the numerical gradient and Hessian together, with errors. The
+	///first element holds the gradient and its errors, as returned by
+	///numerical_gradient_with_errors(). The second holds the Hessian and its
+	///errors, as returned by numerical_hessian_with_errors().
+	///See numerical_gradient_and_hessian().
+	///@param f Functor to differentiate
+	///@param x Point about which to differentiate.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> pair<Matrix<S, 2, P>, pair<Matrix<S, S, P>, Matrix<S, S, P> > > numerical_gradient_and_hessian_with_errors(const F& f, const Vector<S, P, B>& x)
+	{
+		Internal::EvaluationCache<F, P, S, B> cache(x, f);
+		Matrix<S, 2, P> g(x.size(), 2);
+		Matrix<S, S, P> hess(x.size(), x.size());
+		Matrix<S, S, P> errors(x.size(), x.size());
+		Internal::numerical_gradient(cache, g);
+		Internal::numerical_hessian(cache, hess, errors);
+		return make_pair(g, make_pair(hess, errors));
+	}
 
-		for(int i=0; i < x.size(); i++)
-		{
-			curv.i = i;
-			pair<double, double> e = extrapolate_to_zero<CentralDifferenceSecond<F, P, S, B>, P>(curv);
-			hess[i][i] = e.first;
-		}
+	///Compute numerical gradients in parallel, if OpenMP is enabled. The
+	///dimensions are shared out between threads, and each thread differentiates
+	///using its own copy of \e f, so \e f must be copy constructible and the
+	///copies must be safe to call concurrently. The result is identical to
+	///numerical_gradient(), regardless of the number of threads.
+	///@param f Functor to differentiate
+	///@param x Point about which to differentiate.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> Vector<S, P> numerical_gradient_parallel(const F& f, const Vector<S, P, B>& x)
+	{
+		Matrix<S, 2, P> g(x.size(), 2);
+		Internal::numerical_gradient_parallel(f, x, g);
+		return g.T()[0];
+	}
 
+	///Compute numerical gradients with errors in parallel, if OpenMP is enabled.
+	///See numerical_gradient_parallel() and numerical_gradient_with_errors().
+	///@param f Functor to differentiate
+	///@param x Point about which to differentiate.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> Matrix<S, 2, P> numerical_gradient_with_errors_parallel(const F& f, const Vector<S, P, B>& x)
+	{
+		Matrix<S, 2, P> g(x.size(), 2);
+		Internal::numerical_gradient_parallel(f, x, g);
+		return g;
+	}
+
+	///Compute the numerical Hessian in parallel, if OpenMP is enabled. The
+	///elements of the upper triangle are shared out between threads, and each
+	///thread differentiates using its own copy of \e f, so \e f must be copy
+	///constructible and the copies must be safe to call concurrently. The result
+	///is identical to numerical_hessian(), regardless of the number of threads.
+	///@param f Functor to double-differentiate
+	///@param x Point about which to double-differentiate.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> Matrix<S, S, P> numerical_hessian_parallel(const F& f, const Vector<S, P, B>& x)
+	{
+		Matrix<S, S, P> hess(x.size(), x.size());
+		Matrix<S, S, P> errors(x.size(), x.size());
+		Internal::numerical_hessian_parallel(f, x, hess, errors);
 		return hess;
 	}
+
+	///Compute the numerical Hessian and errors in parallel, if OpenMP is enabled.
+	///See numerical_hessian_parallel() and numerical_hessian_with_errors().
+	///@param f Functor to double-differentiate
+	///@param x Point about which to double-differentiate.
+	///@ingroup gFunctions
+	template<class F, int S, class P, class B> pair<Matrix<S, S, P>, Matrix<S, S, P> > numerical_hessian_with_errors_parallel(const F& f, const Vector<S, P, B>& x)
+	{
+		Matrix<S, S, P> hess(x.size(), x.size());
+		Matrix<S, S, P> errors(x.size(), x.size());
+		Internal::numerical_hessian_parallel(f, x, hess, errors);
+		return make_pair(hess, errors);
+	}
 }
 
 #endif
@@ -0,0 +1,433 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_DUAL_H
+#define TOON_INCLUDE_DUAL_H
+
+#include <TooN/TooN.h>
+#include <TooN/so3.h>
+#include <TooN/se3.h>
+#include <iostream>
+#include <cmath>
+
+namespace TooN {
+
+//Dual and its functions are in their own namespace, so that they are found by
+//argument dependent lookup, but do not hide std::sin etc. from the rest of TooN.
+namespace Duals {
+
+/**
+A number with derivatives with respect to \e N variables, for forward mode
+automatic differentiation. This is a built in alternative to the FADBAD++
+integration in functions/fadbad.h. The derivatives are stored contiguously
+in a fixed size array, and every operation updates them in a simple loop of
+length \e N, which the compiler can vectorize.
+
+Dual is registered with IsField, so Vector, Matrix, SO3, SE3 and so on can
+be instantiated on it, and mixed with builtin types. To find the Jacobian of
+a function, evaluate it on a Vector made with make_dual_vector(), and extract
+the result with get_jacobian():
+@code
+	template<class P> Vector<2, P> f(const Vector<3, P>& x);
+
+	Vector<3> x = makeVector(1, 2, 3);
+	Vector<2, Dual<double, 3> > y = f(make_dual_vector<3>(x));
+	Matrix<2, 3> J = get_jacobian(y);
+@endcode
+
+As with builtin types, a default constructed Dual is not initialized.
+
+@param Precision The type of the value and the derivatives
+@param N The number of variables
+@ingroup gFunctions
+**/
+template<class Precision, int N> struct Dual
+{
+	typedef Precision Scalar; ///< The type of the value and the derivatives
+
+	Precision value;          ///< The value
+	Precision derivatives[N]; ///< The derivatives with respect to each variable
+
+	Dual()
+	{}
+
+	/// Construct a constant, which has zero derivatives.
+	Dual(const Precision& v)
+	:value(v)
+	{
+		for(int i=0; i < N; i++)
+			derivatives[i] = 0;
+	}
+
+	/// Construct variable \e i, which has a derivative of 1 with respect to
+	/// itself and 0 with respect to all the others.
+	Dual(const Precision& v, int i)
+	:value(v)
+	{
+		for(int j=0; j < N; j++)
+			derivatives[j] = 0;
+		derivatives[i] = 1;
+	}
+
+	Dual& operator+=(const Dual& d)
+	{
+		value += d.value;
+		for(int i=0; i < N; i++)
+			derivatives[i] += d.derivatives[i];
+		return *this;
+	}
+
+	Dual& operator-=(const Dual& d)
+	{
+		value -= d.value;
+		for(int i=0; i < N; i++)
+			derivatives[i] -= d.derivatives[i];
+		return *this;
+	}
+
+	Dual& operator*=(const Dual& d)
+	{
+		for(int i=0; i < N; i++)
+			derivatives[i] = derivatives[i] * d.value + value * d.derivatives[i];
+		value *= d.value;
+		return *this;
+	}
+
+	Dual& operator/=(const Dual& d)
+	{
+		const Precision inv = 1 / d.value;
+		value *= inv;
+		for(int i=0; i < N; i++)
+			derivatives[i] = (derivatives[i] - value * d.derivatives[i]) * inv;
+		return *this;
+	}
+
+	Dual& operator+=(const Precision& p)
+	{
+		value += p;
+		return *this;
+	}
+
+	Dual& operator-=(const Precision& p)
+	{
+		value -= p;
+		return *this;
+	}
+
+	Dual& operator*=(const Precision& p)
+	{
+		value *= p;
+		for(int i=0; i < N; i++)
+			derivatives[i] *= p;
+		return *this;
+	}
+
+	Dual& operator/=(const Precision& p)
+	{
+		return *this *= 1 / p;
+	}
+};
+
+///@internal
+///Apply the chain rule to a function of one variable, given its value
+///and its derivative at \e a.
+///@ingroup gInternal
+template<class P, int N> inline Dual<P, N> dual_chain(const Dual<P, N>& a, const P& value, const P& slope)
+{
+	Dual<P, N> r;
+	r.value = value;
+	for(int i=0; i < N; i++)
+		r.derivatives[i] = slope * a.derivatives[i];
+	return r;
+}
+
+//Arithmetic. The scalar arguments are not deduced, so that for instance an
+//int can be combined with a Dual<double>.
+template<class P, int N> inline Dual<P, N> operator-(const Dual<P, N>& a)
+{
+	return dual_chain(a, -a.value, P(-1));
+}
+
+template<class P, int N> inline Dual<P, N> operator+(const Dual<P, N>& a, const Dual<P, N>& b) { Dual<P, N> r(a); return r += b; }
+template<class P, int N> inline Dual<P, N> operator-(const Dual<P, N>& a, const Dual<P, N>& b) { Dual<P, N> r(a); return r -= b; }
+template<class P, int N> inline Dual<P, N> operator*(const Dual<P, N>& a, const Dual<P, N>& b) { Dual<P, N> r(a); return r *= b; }
+template<class P, int N> inline Dual<P, N> operator/(const Dual<P, N>& a, const Dual<P, N>& b) { Dual<P, N> r(a); return r /= b; }
+
+template<class P, int N> inline Dual<P, N> operator+(const Dual<P, N>& a, const typename Dual<P, N>::Scalar& b) { Dual<P, N> r(a); return r += b; }
+template<class P, int N> inline Dual<P, N> operator-(const Dual<P, N>& a, const typename Dual<P, N>::Scalar& b) { Dual<P, N> r(a); return r -= b; }
+template<class P, int N> inline Dual<P, N> operator*(const Dual<P, N>& a, const typename Dual<P, N>::Scalar& b) { Dual<P, N> r(a); return r *= b; }
+template<class P, int N> inline Dual<P, N> operator/(const Dual<P, N>& a, const typename Dual<P, N>::Scalar& b) { Dual<P, N> r(a); return r /= b; }
+
+template<class P, int N> inline Dual<P, N> operator+(const typename Dual<P, N>::Scalar& a, const Dual<P, N>& b) { Dual<P, N> r(b); return r += a; }
+template<class P, int N> inline Dual<P, N> operator-(const typename Dual<P, N>::Scalar& a, const Dual<P, N>& b) { Dual<P, N> r(-b); return r += a; }
+template<class P, int N> inline Dual<P, N> operator*(const typename Dual<P, N>::Scalar& a, const Dual<P, N>& b) { Dual<P, N> r(b); return r *= a; }
+template<class P, int N> inline Dual<P, N> operator/(const typename Dual<P, N>::Scalar& a, const Dual<P, N>& b)
+{
+	const P inv = 1 / b.value;
+	return dual_chain(b, a * inv, -a * inv * inv);
+}
+
+//Comparisons only consider the value.
+#define TOON_DUAL_COMPARISON(OP) \
+template<class P, int N> inline bool operator OP(const Dual<P, N>& a, const Dual<P, N>& b) { return a.value OP b.value; } \
+template<class P, int N> inline bool operator OP(const Dual<P, N>& a, const typename Dual<P, N>::Scalar& b) { return a.value OP b; } \
+template<class P, int N> inline bool operator OP(const typename Dual<P, N>::Scalar& a, const Dual<P, N>& b) { return a OP b.value; }
+
+TOON_DUAL_COMPARISON(<)
+TOON_DUAL_COMPARISON(>)
+TOON_DUAL_COMPARISON(<=)
+TOON_DUAL_COMPARISON(>=)
+TOON_DUAL_COMPARISON(==)
+TOON_DUAL_COMPARISON(!=)
+
+#undef TOON_DUAL_COMPARISON
+
+//Elementary functions. These are found by argument dependent lookup, so
+//code with "using std::sin;" works unchanged.
+template<class P, int N> inline Dual<P, N> sqrt(const Dual<P, N>& a)
+{
+	using std::sqrt;
+	const P s = sqrt(a.value);
+	return dual_chain(a, s, 1 / (2 * s));
+}
+
+template<class P, int N> inline Dual<P, N> exp(const Dual<P, N>& a)
+{
+	using std::exp;
+	const P e = exp(a.value);
+	return dual_chain(a, e, e);
+}
+
+template<class P, int N> inline Dual<P, N> log(const Dual<P, N>& a)
+{
+	using std::log;
+	return dual_chain(a, log(a.value), 1 / a.value);
+}
+
+template<class P, int N> inline Dual<P, N> sin(const Dual<P, N>& a)
+{
+	using std::sin;
+	using std::cos;
+	return dual_chain(a, sin(a.value), cos(a.value));
+}
+
+template<class P, int N> inline Dual<P, N> cos(const Dual<P, N>& a)
+{
+	using std::sin;
+	using std::cos;
+	return dual_chain(a, cos(a.value), -sin(a.value));
+}
+
+template<class P, int N> inline Dual<P, N> tan(const Dual<P, N>& a)
+{
+	using std::tan;
+	const P t = tan(a.value);
+	return dual_chain(a, t, 1 + t * t);
+}
+
+template<class P, int N> inline Dual<P, N> asin(const Dual<P, N>& a)
+{
+	using std::asin;
+	using std::sqrt;
+	return dual_chain(a, asin(a.value), 1 / sqrt(1 - a.value * a.value));
+}
+
+template<class P, int N> inline Dual<P, N> acos(const Dual<P, N>& a)
+{
+	using std::acos;
+	using std::sqrt;
+	return dual_chain(a, acos(a.value), -1 / sqrt(1 - a.value * a.value));
+}
+
+template<class P, int N> inline Dual<P, N> atan(const Dual<P, N>& a)
+{
+	using std::atan;
+	return dual_chain(a, atan(a.value), 1 / (1 + a.value * a.value));
+}
+
+template<class P, int N> inline Dual<P, N> atan2(const Dual<P, N>& y, const Dual<P, N>& x)
+{
+	using std::atan2;
+	const P inv = 1 / (x.value * x.value + y.value * y.value);
+	const P dy = x.value * inv;
+	const P dx = -y.value * inv;
+
+	Dual<P, N> r;
+	r.value = atan2(y.value, x.value);
+	for(int i=0; i < N; i++)
+		r.derivatives[i] = dy * y.derivatives[i] + dx * x.derivatives[i];
+	return r;
+}
+
+template<class P, int N> inline Dual<P, N> pow(const Dual<P, N>& a, const typename Dual<P, N>::Scalar& b)
+{
+	using std::pow;
+	const P p = pow(a.value, b - 1);
+	return dual_chain(a, p * a.value, b * p);
+}
+
+template<class P, int N> inline Dual<P, N> abs(const Dual<P, N>& a)
+{
+	return a.value < 0 ? -a : a;
+}
+
+template<class P, int N> inline Dual<P, N> fabs(const Dual<P, N>& a)
+{
+	return abs(a);
+}
+
+template<class P, int N> inline std::ostream& operator<<(std::ostream& out, const Dual<P, N>& d)
+{
+	return out << d.value;
+}
+
+}
+
+using Duals::Dual;
+
+template<class C, int N> struct IsField<Dual<C, N> >
+{
+	static const int value = numeric_limits<C>::is_specialized; ///<Is C a field?
+};
+
+///Make a Vector of Dual numbers, where element \e i is variable
+///<code>start + i</code>. Elements beyond the last variable are constants.
+///@param v The values
+///@param start The variable corresponding to the first element
+///@ingroup gFunctions
+template<int N, int S, class P, class B> inline Vector<S, Dual<P, N> > make_dual_vector(const Vector<S, P, B>& v, int start=0)
+{
+	Vector<S, Dual<P, N> > r(v.size());
+	for(int i=0; i < v.size(); i++)
+		if(start + i < N)
+			r[i] = Dual<P, N>(v[i], start + i);
+		else
+			r[i] = Dual<P, N>(v[i]);
+	return r;
+}
+
+///Extract the values from a Vector of Dual numbers.
+///@ingroup gFunctions
+template<int S, class P, int N, class B> inline Vector<S, P> get_value(const Vector<S, Dual<P, N>, B>& v)
+{
+	Vector<S, P> r(v.size());
+	for(int i=0; i < v.size(); i++)
+		r[i] = v[i].value;
+	return r;
+}
+
+///Extract the values from a Matrix of Dual numbers.
+///@ingroup gFunctions
+template<int R, int C, class P, int N, class B> inline Matrix<R, C, P> get_value(const Matrix<R, C, Dual<P, N>, B>& m)
+{
+	Matrix<R, C, P> r(m.num_rows(), m.num_cols());
+	for(int i=0; i < m.num_rows(); i++)
+		for(int j=0; j < m.num_cols(); j++)
+			r[i][j] = m[i][j].value;
+	return r;
+}
+
+///Extract the gradient of a Dual number.
+///@ingroup gFunctions
+template<class P, int N> inline Vector<N, P> get_gradient(const Dual<P, N>& d)
+{
+	Vector<N, P> r;
+	for(int i=0; i < N; i++)
+		r[i] = d.derivatives[i];
+	return r;
+}
+
+///Extract the derivative of a Vector of Dual numbers with respect to variable \e i.
+///@ingroup gFunctions
+template<int S, class P, int N, class B> inline Vector<S, P> get_derivative(const Vector<S, Dual<P, N>, B>& v, int i)
+{
+	Vector<S, P> r(v.size());
+	for(int j=0; j < v.size(); j++)
+		r[j] = v[j].derivatives[i];
+	return r;
+}
+
+///Extract the derivative of a Matrix of Dual numbers with respect to variable \e i.
+///@ingroup gFunctions
+template<int R, int C, class P, int N, class B> inline Matrix<R, C, P> get_derivative(const Matrix<R, C, Dual<P, N>, B>& m, int i)
+{
+	Matrix<R, C, P> r(m.num_rows(), m.num_cols());
+	for(int j=0; j < m.num_rows(); j++)
+		for(int k=0; k < m.num_cols(); k++)
+			r[j][k] = m[j][k].derivatives[i];
+	return r;
+}
+
+///Extract the Jacobian of a Vector of Dual numbers. Row \e i holds the
+///gradient of element \e i.
+///@ingroup gFunctions
+template<int S, class P, int N, class B> inline Matrix<S, N, P> get_jacobian(const Vector<S, Dual<P, N>, B>& v)
+{
+	Matrix<S, N, P> r(v.size(), N);
+	for(int i=0; i < v.size(); i++)
+		for(int j=0; j < N; j++)
+			r[i][j] = v[i].derivatives[j];
+	return r;
+}
+
+///Make an SO3 which is the identity, with derivatives with respect to
+///the rotation vector, which is variables <code>start</code> to
+///<code>start+2</code>.
+///@ingroup gFunctions
+template<int N, class P> inline SO3<Dual<P, N> > make_dual_so3(int start=0)
+{
+	return SO3<Dual<P, N> >::exp(make_dual_vector<N>(Vector<3, P>(Zeros), start));
+}
+
+///Make an SE3 which is the identity, with derivatives with respect to the
+///translation and rotation (in the same order as SE3::exp()), which are
+///variables <code>start</code> to <code>start+5</code>.
+///@ingroup gFunctions
+template<int N, class P> inline SE3<Dual<P, N> > make_dual_se3(int start=0)
+{
+	return SE3<Dual<P, N> >::exp(make_dual_vector<N>(Vector<6, P>(Zeros), start));
+}
+
+///Left multiply \e r by make_dual_so3(), so that the derivatives are with
+///respect to a small rotation applied to \e r.
+///@ingroup gFunctions
+template<int N, class P> inline SO3<Dual<P, N> > make_left_dual_so3(const SO3<P>& r, int start=0)
+{
+	return make_dual_so3<N, P>(start) * r;
+}
+
+///Left multiply \e t by make_dual_se3(), so that the derivatives are with
+///respect to a small motion applied to \e t.
+///@ingroup gFunctions
+template<int N, class P> inline SE3<Dual<P, N> > make_left_dual_se3(const SE3<P>& t, int start=0)
+{
+	return make_dual_se3<N, P>(start) * t;
+}
+
+}
+
+#endif
@@ -0,0 +1,415 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_REVERSE_H
+#define TOON_INCLUDE_REVERSE_H
+
+#include <TooN/TooN.h>
+#include <vector>
+#include <iostream>
+#include <cmath>
+
+namespace TooN {
+
+//Reverse and its functions are in their own namespace, so that they are found
+//by argument dependent lookup, but do not hide std::sin etc. from the rest of TooN.
+namespace ReverseMode {
+
+template<class Precision> class Tape;
+
+/**
+A number which records the operations performed on it in a Tape, for
+reverse mode automatic differentiation. Unlike forward mode (see Dual), the
+gradient of a scalar function with respect to any number of variables costs
+a small constant multiple of the cost of evaluating the function.
+
+Reverse is registered with IsField, so Vector and Matrix can be instantiated
+on it. Numbers which do not depend on any variables are constants, and are
+not recorded.
+@code
+	template<class P> P f(const Vector<Dynamic, P>& x);
+
+	Tape<> tape;
+	Vector<Dynamic, Reverse<> > xr = tape.variables(x);
+	Reverse<> y = f(xr);
+	Vector<> g = tape.gradient(y);
+@endcode
+
+As with builtin types, a default constructed Reverse is not initialized.
+
+@param Precision The type of the value and the derivatives
+@ingroup gFunctions
+**/
+template<class Precision=DefaultPrecision> struct Reverse
+{
+	typedef Precision Scalar;    ///< The type of the value and the derivatives
+
+	Precision value;             ///< The value
+	int index;                   ///< Position of the node in the tape, or -1 for a constant
+	Tape<Precision>* tape;       ///< The tape recording the operations
+
+	Reverse()
+	{}
+
+	/// Construct a constant.
+	Reverse(const Precision& v)
+	:value(v),index(-1),tape(0)
+	{}
+
+	Reverse& operator+=(const Reverse& r) { return *this = *this + r; }
+	Reverse& operator-=(const Reverse& r) { return *this = *this - r; }
+	Reverse& operator*=(const Reverse& r) { return *this = *this * r; }
+	Reverse& operator/=(const Reverse& r) { return *this = *this / r; }
+};
+
+/**
+Storage for the operations recorded by Reverse numbers. Each operation is
+stored as a node with up to two parents and the partial derivatives with
+respect to them. The storage is kept when the tape is cleared, so reusing a
+tape, for instance once per iteration of an optimizer, does not allocate
+memory once it has grown to the size of the function.
+
+A tape must not be used by more than one thread at once, but separate tapes
+can be used concurrently.
+@param Precision The type of the value and the derivatives
+@ingroup gFunctions
+**/
+template<class Precision=DefaultPrecision> class Tape
+{
+public:
+	Tape()
+	{}
+
+	/// Remove all the variables and operations, keeping the storage.
+	void clear()
+	{
+		my_nodes.clear();
+		my_variables.clear();
+	}
+
+	/// Create a new variable.
+	Reverse<Precision> variable(const Precision& v)
+	{
+		my_variables.push_back(my_nodes.size());
+		return record(v, -1, 0, -1, 0);
+	}
+
+	/// Create a Vector of new variables. The gradient is returned in the
+	/// order in which the variables were created.
+	template<int S, class P, class B> Vector<S, Reverse<Precision> > variables(const Vector<S, P, B>& v)
+	{
+		Vector<S, Reverse<Precision> > r(v.size());
+		for(int i=0; i < v.size(); i++)
+			r[i] = variable(v[i]);
+		return r;
+	}
+
+	/// Returns the number of variables.
+	int num_variables() const { return my_variables.size(); }
+
+	/// Returns the number of operations recorded, including the variables.
+	int size() const { return my_nodes.size(); }
+
+	///@internal
+	///Record an operation with up to two parents. Parents which are
+	///constants (index -1) are ignored.
+	Reverse<Precision> record(const Precision& value, int p0, const Precision& d0, int p1, const Precision& d1)
+	{
+		Node n;
+		n.parent[0] = p0;
+		n.parent[1] = p1;
+		n.partial[0] = d0;
+		n.partial[1] = d1;
+		my_nodes.push_back(n);
+
+		Reverse<Precision> r;
+		r.value = value;
+		r.index = my_nodes.size() - 1;
+		r.tape = this;
+		return r;
+	}
+
+	/// Compute the gradient of \e y with respect to the variables, and store
+	/// it in \e g.
+	template<int S, class B> void gradient(const Reverse<Precision>& y, Vector<S, Precision, B>& g)
+	{
+		SizeMismatch<Dynamic, S>::test(num_variables(), g.size());
+
+		my_adjoints.assign(my_nodes.size(), 0);
+		if(y.index != -1)
+		{
+			my_adjoints[y.index] = 1;
+			for(int i=y.index; i >= 0; i--)
+			{
+				const Precision a = my_adjoints[i];
+				if(a == 0)
+					continue;
+
+				const Node& n = my_nodes[i];
+				if(n.parent[0] != -1)
+					my_adjoints[n.parent[0]] += n.partial[0] * a;
+				if(n.parent[1] != -1)
+					my_adjoints[n.parent[1]] += n.partial[1] * a;
+			}
+		}
+
+		for(int i=0; i < g.size(); i++)
+			g[i] = my_adjoints[my_variables[i]];
+	}
+
+	/// Compute the gradient of \e y with respect to the variables.
+	Vector<Dynamic, Precision> gradient(const Reverse<Precision>& y)
+	{
+		Vector<Dynamic, Precision> g(num_variables());
+		gradient(y, g);
+		return g;
+	}
+
+private:
+	struct Node
+	{
+		int parent[2];
+		Precision partial[2];
+	};
+
+	std::vector<Node> my_nodes;
+	std::vector<int> my_variables;
+	std::vector<Precision> my_adjoints;
+
+	Tape(const Tape&);
+	void operator=(const Tape&);
+};
+
+///@internal
+///Apply the chain rule to a function of one variable, given its value
+///and its derivative at \e a.
+///@ingroup gInternal
+template<class P> inline Reverse<P> reverse_chain(const Reverse<P>& a, const P& value, const P& slope)
+{
+	if(a.index == -1)
+		return Reverse<P>(value);
+	return a.tape->record(value, a.index, slope, -1, 0);
+}
+
+///@internal
+///Apply the chain rule to a function of two variables, given its value
+///and its partial derivatives at \e a and \e b.
+///@ingroup gInternal
+template<class P> inline Reverse<P> reverse_chain(const Reverse<P>& a, const Reverse<P>& b, const P& value, const P& da, const P& db)
+{
+	if(a.index == -1)
+		return reverse_chain(b, value, db);
+	return a.tape->record(value, a.index, da, b.index, db);
+}
+
+//Arithmetic. The scalar arguments are not deduced, so that for instance an
+//int can be combined with a Reverse<double>.
+template<class P> inline Reverse<P> operator-(const Reverse<P>& a) { return reverse_chain(a, -a.value, P(-1)); }
+
+template<class P> inline Reverse<P> operator+(const Reverse<P>& a, const Reverse<P>& b) { return reverse_chain(a, b, a.value + b.value, P(1), P(1)); }
+template<class P> inline Reverse<P> operator-(const Reverse<P>& a, const Reverse<P>& b) { return reverse_chain(a, b, a.value - b.value, P(1), P(-1)); }
+template<class P> inline Reverse<P> operator*(const Reverse<P>& a, const Reverse<P>& b) { return reverse_chain(a, b, a.value * b.value, b.value, a.value); }
+template<class P> inline Reverse<P> operator/(const Reverse<P>& a, const Reverse<P>& b)
+{
+	const P inv = 1 / b.value;
+	const P v = a.value * inv;
+	return reverse_chain(a, b, v, inv, -v * inv);
+}
+
+template<class P> inline Reverse<P> operator+(const Reverse<P>& a, const typename Reverse<P>::Scalar& b) { return reverse_chain(a, a.value + b, P(1)); }
+template<class P> inline Reverse<P> operator-(const Reverse<P>& a, const typename Reverse<P>::Scalar& b) { return reverse_chain(a, a.value - b, P(1)); }
+template<class P> inline Reverse<P> operator*(const Reverse<P>& a, const typename Reverse<P>::Scalar& b) { return reverse_chain(a, a.value * b, P(b)); }
+template<class P> inline Reverse<P> operator/(const Reverse<P>& a, const typename Reverse<P>::Scalar& b) { return reverse_chain(a, a.value / b, 1 / P(b)); }
+
+template<class P> inline Reverse<P> operator+(const typename Reverse<P>::Scalar& a, const Reverse<P>& b) { return reverse_chain(b, a + b.value, P(1)); }
+template<class P> inline Reverse<P> operator-(const typename Reverse<P>::Scalar& a, const Reverse<P>& b) { return reverse_chain(b, a - b.value, P(-1)); }
+template<class P> inline Reverse<P> operator*(const typename Reverse<P>::Scalar& a, const Reverse<P>& b) { return reverse_chain(b, a * b.value, P(a)); }
+template<class P> inline Reverse<P> operator/(const typename Reverse<P>::Scalar& a, const Reverse<P>& b)
+{
+	const P inv = 1 / b.value;
+	return reverse_chain(b, a * inv, -a * inv * inv);
+}
+
+//Comparisons only consider the value.
+#define TOON_REVERSE_COMPARISON(OP) \
+template<class P> inline bool operator OP(const Reverse<P>& a, const Reverse<P>& b) { return a.value OP b.value; } \
+template<class P> inline bool operator OP(const Reverse<P>& a, const typename Reverse<P>::Scalar& b) { return a.value OP b; } \
+template<class P> inline bool operator OP(const typename Reverse<P>::Scalar& a, const Reverse<P>& b) { return a OP b.value; }
+
+TOON_REVERSE_COMPARISON(<)
+TOON_REVERSE_COMPARISON(>)
+TOON_REVERSE_COMPARISON(<=)
+TOON_REVERSE_COMPARISON(>=)
+TOON_REVERSE_COMPARISON(==)
+TOON_REVERSE_COMPARISON(!=)
+
+#undef TOON_REVERSE_COMPARISON
+
+//Elementary functions. These are found by argument dependent lookup, so
+//code with "using std::sin;" works unchanged.
+template<class P> inline Reverse<P> sqrt(const Reverse<P>& a)
+{
+	using std::sqrt;
+	const P s = sqrt(a.value);
+	return reverse_chain(a, s, 1 / (2 * s));
+}
+
+template<class P> inline Reverse<P> exp(const Reverse<P>& a)
+{
+	using std::exp;
+	const P e = exp(a.value);
+	return reverse_chain(a, e, e);
+}
+
+template<class P> inline Reverse<P> log(const Reverse<P>& a)
+{
+	using std::log;
+	return reverse_chain(a, log(a.value), 1 / a.value);
+}
+
+template<class P> inline Reverse<P> sin(const Reverse<P>& a)
+{
+	using std::sin;
+	using std::cos;
+	return reverse_chain(a, sin(a.value), cos(a.value));
+}
+
+template<class P> inline Reverse<P> cos(const Reverse<P>& a)
+{
+	using std::sin;
+	using std::cos;
+	return reverse_chain(a, cos(a.value), -sin(a.value));
+}
+
+template<class P> inline Reverse<P> tan(const Reverse<P>& a)
+{
+	using std::tan;
+	const P t = tan(a.value);
+	return reverse_chain(a, t, 1 + t * t);
+}
+
+template<class P> inline Reverse<P> asin(const Reverse<P>& a)
+{
+	using std::asin;
+	using std::sqrt;
+	return reverse_chain(a, asin(a.value), 1 / sqrt(1 - a.value * a.value));
+}
+
+template<class P> inline Reverse<P> acos(const Reverse<P>& a)
+{
+	using std::acos;
+	using std::sqrt;
+	return reverse_chain(a, acos(a.value), -1 / sqrt(1 - a.value * a.value));
+}
+
+template<class P> inline Reverse<P> atan(const Reverse<P>& a)
+{
+	using std::atan;
+	return reverse_chain(a, atan(a.value), 1 / (1 + a.value * a.value));
+}
+
+template<class P> inline Reverse<P> atan2(const Reverse<P>& y, const Reverse<P>& x)
+{
+	using std::atan2;
+	const P inv = 1 / (x.value * x.value + y.value * y.value);
+	return reverse_chain(y, x, atan2(y.value, x.value), x.value * inv, -y.value * inv);
+}
+
+template<class P> inline Reverse<P> pow(const Reverse<P>& a, const typename Reverse<P>::Scalar& b)
+{
+	using std::pow;
+	const P p = pow(a.value, b - 1);
+	return reverse_chain(a, p * a.value, b * p);
+}
+
+template<class P> inline Reverse<P> abs(const Reverse<P>& a)
+{
+	return a.value < 0 ? -a : a;
+}
+
+template<class P> inline Reverse<P> fabs(const Reverse<P>& a)
+{
+	return abs(a);
+}
+
+template<class P> inline std::ostream& operator<<(std::ostream& out, const Reverse<P>& r)
+{
+	return out << r.value;
+}
+
+}
+
+using ReverseMode::Reverse;
+using ReverseMode::Tape;
+
+template<class C> struct IsField<Reverse<C> >
+{
+	static const int value = numeric_limits<C>::is_specialized; ///<Is C a field?
+};
+
+///Compute the gradient of a function using reverse mode automatic
+///differentiation. The function is called with a
+///<code>Vector<S, Reverse<P> ></code>, so it should be templated on the
+///precision. The tape is cleared first, and can be reused for subsequent
+///calls to avoid allocating memory. For example, as a derivative functor
+///for ConjugateGradient:
+///@code
+///	struct Gradient
+///	{
+///		mutable Tape<> tape;
+///		Vector<> operator()(const Vector<>& x) const
+///		{
+///			return reverse_gradient(Function(), x, tape);
+///		}
+///	};
+///@endcode
+///@param f Functor to differentiate
+///@param x Point about which to differentiate.
+///@param tape Tape used to record the function
+///@ingroup gFunctions
+template<class F, int S, class P, class B> Vector<S, P> reverse_gradient(const F& f, const Vector<S, P, B>& x, Tape<P>& tape)
+{
+	tape.clear();
+	Vector<S, P> g(x.size());
+	tape.gradient(f(tape.variables(x)), g);
+	return g;
+}
+
+///Compute the gradient of a function using reverse mode automatic
+///differentiation, with a temporary Tape. See reverse_gradient().
+///@param f Functor to differentiate
+///@param x Point about which to differentiate.
+///@ingroup gFunctions
+template<class F, int S, class P, class B> Vector<S, P> reverse_gradient(const F& f, const Vector<S, P, B>& x)
+{
+	Tape<P> tape;
+	return reverse_gradient(f, x, tape);
+}
+
+}
+
+#endif
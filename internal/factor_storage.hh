@@ -0,0 +1,171 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+namespace TooN {
+
+namespace Internal
+{
+	///@internal
+	///@brief The Reference layout corresponding to an ordinary layout.
+	///@ingroup gInternal
+	template<class Layout> struct ReferenceLayout;
+	template<> struct ReferenceLayout<RowMajor>{ typedef Reference::RowMajor type; };
+	template<> struct ReferenceLayout<ColMajor>{ typedef Reference::ColMajor type; };
+
+	///@internal
+	///@brief Check that a matrix is densely packed with the given layout.
+	///@ingroup gInternal
+	template<class Layout> struct IsPacked;
+	template<> struct IsPacked<RowMajor>
+	{
+		template<class M> static bool test(const M& m)
+		{
+			return m.colstride() == 1 && (m.num_rows() <= 1 || m.rowstride() == m.num_cols());
+		}
+	};
+	template<> struct IsPacked<ColMajor>
+	{
+		template<class M> static bool test(const M& m)
+		{
+			return m.rowstride() == 1 && (m.num_cols() <= 1 || m.colstride() == m.num_rows());
+		}
+	};
+
+	///@internal
+	///@brief Memory owned by a FactorStorage.
+	///Statically sized matrices use a member matrix.
+	///@ingroup gInternal
+	template<int Rows, int Cols, class Precision, class Layout, bool IsStatic=(Rows > 0 && Cols > 0)>
+	struct FactorBuffer
+	{
+		Precision* allocate(int){ return my_matrix.my_data; }
+		Precision* data() const { return const_cast<Precision*>(my_matrix.my_data); }
+		void release(){}
+
+		Matrix<Rows, Cols, Precision, Layout> my_matrix;
+	};
+
+	///@internal
+	///@brief Memory owned by a FactorStorage.
+	///Dynamically sized matrices allocate memory only when it is needed,
+	///and free it when the storage is borrowed instead.
+	///@ingroup gInternal
+	template<int Rows, int Cols, class Precision, class Layout>
+	struct FactorBuffer<Rows, Cols, Precision, Layout, false>
+	{
+		Precision* allocate(int n)
+		{
+			if(static_cast<int>(my_numbers.size()) != n)
+			{
+				std::vector<Precision>(n).swap(my_numbers);
+				if(n > 0)
+					debug_initialize(&my_numbers[0], n);
+			}
+			return data();
+		}
+
+		Precision* data() const
+		{
+			return my_numbers.empty() ? 0 : const_cast<Precision*>(&my_numbers[0]);
+		}
+
+		void release()
+		{
+			std::vector<Precision>().swap(my_numbers);
+		}
+
+		std::vector<Precision> my_numbers;
+	};
+
+	///@internal
+	///@brief Storage for the factors of a decomposition.
+	///The factors live either in memory owned by this object, or in the
+	///memory of a matrix supplied by the caller, which is then overwritten
+	///(see the compute_in_place() members of the decompositions). Borrowing
+	///avoids making a copy of large matrices; matrices which are not densely
+	///packed are copied anyway. A borrowed matrix must outlive
+	///any use of the decomposition, including any copies of it.
+	///
+	///view() gives a Reference matrix onto whichever memory is in use.
+	///@ingroup gInternal
+	template<int Rows, int Cols, class Precision, class Layout>
+	class FactorStorage
+	{
+		public:
+			typedef Matrix<Rows, Cols, Precision, typename ReferenceLayout<Layout>::type> View;
+
+			FactorStorage(int rows=Rows, int cols=Cols)
+			:my_borrowed(0), my_rows(rows), my_cols(cols)
+			{}
+
+			///Use owned memory of the given size, and return a view of it.
+			View own(int rows, int cols)
+			{
+				my_borrowed = 0;
+				my_rows = rows;
+				my_cols = cols;
+				return View(my_buffer.allocate(rows*cols), rows, cols);
+			}
+
+			///Use the memory of m, and return a view of it. Any owned memory is freed.
+			///If m is not densely packed in the required layout, its contents are
+			///copied into owned memory instead, and m is left unmodified.
+			template<int R, int C, class B>
+			View borrow(Matrix<R, C, Precision, B>& m)
+			{
+				if(!IsPacked<Layout>::test(m))
+				{
+					View v = own(m.num_rows(), m.num_cols());
+					v = m;
+					return v;
+				}
+				my_buffer.release();
+				my_borrowed = m.my_data;
+				my_rows = m.num_rows();
+				my_cols = m.num_cols();
+				return view();
+			}
+
+			///Is the memory borrowed from the caller?
+			bool is_borrowed() const { return my_borrowed != 0; }
+
+			View view() const
+			{
+				return View(my_borrowed ? my_borrowed : my_buffer.data(), my_rows, my_cols);
+			}
+
+			int num_rows() const { return my_rows; }
+			int num_cols() const { return my_cols; }
+
+		private:
+			FactorBuffer<Rows, Cols, Precision, Layout> my_buffer;
+			Precision* my_borrowed;
+			int my_rows, my_cols;
+	};
+}
+
+}
@@ -57,7 +57,7 @@ namespace TooN {
 		void set_sd(Precision x){ sd_inlier = x*x;} ///<Set the noise standard deviation.
 		Precision sd_inlier; ///< The inlier standard deviation squared, \f$\sigma\f$.
 		inline Precision reweight(Precision d){return 1/(sd_inlier+d*d);} ///< Returns \f$w(x)\f$.
-		inline Precision true_scale(Precision d){return d - 2*d*reweight(d);} ///< Returns \f$w(x) + xw'(x)\f$.
+		inline Precision true_scale(Precision d){return reweight(d) - 2*d*d*reweight(d)*reweight(d);} ///< Returns \f$w(x) + xw'(x)\f$.
 		inline Precision objective(Precision d){return 0.5 * ::log(1 + d*d/sd_inlier);} ///< Returns \f$\int xw(x)dx\f$.
 	};
 
@@ -68,8 +68,8 @@ namespace TooN {
 	template<typename Precision>
 	struct ILinear {
 		void set_sd(Precision){} ///<Set the noise standard deviation (does nothing).
-		inline Precision reweight(Precision d){return 1;} ///< Returns \f$w(x)\f$.
-		inline Precision true_scale(Precision d){return 1;} ///< Returns \f$w(x) + xw'(x)\f$.
+		inline Precision reweight(Precision){return 1;} ///< Returns \f$w(x)\f$.
+		inline Precision true_scale(Precision){return 1;} ///< Returns \f$w(x) + xw'(x)\f$.
 		inline Precision objective(Precision d){return d*d;} ///< Returns \f$\int xw(x)dx\f$.
 	};
 	
@@ -89,6 +89,12 @@ namespace TooN {
 			double d = (1 + x*x/sd_inlier);
 			return 1/(d*d);
 		}	
+		/// Returns \f$w(x) + xw'(x)\f$.
+		Precision true_scale(Precision x) const
+		{
+			double d = (1 + x*x/sd_inlier);
+			return (1 - 4*x*x/(sd_inlier*d))/(d*d);
+		}
 		///< Returns \f$\int xw(x)dx\f$.
 		Precision objective(Precision x) const 
 		{
@@ -101,7 +107,7 @@ namespace TooN {
 	/// @param Reweight The reweighting functor. This structure must provide reweight(), 
 	/// true-scale() and objective() methods. Existing examples are  Robust I, Robust II and ILinear.
 	/// @ingroup gEquations
-	template <int Size, typename Precision, template <typename Precision> class Reweight>
+	template <int Size, typename Precision, template <typename ReweightPrecision> class Reweight>
 	class IRLS
 		: public Reweight<Precision>,
 		  public WLS<Size,Precision>
@@ -122,21 +128,112 @@ namespace TooN {
 			Precision ts = Reweight<Precision>::true_scale(m);
 			my_residual += Reweight<Precision>::objective(m);
 
-			WLS<Size>::add_mJ(m,J,scale);
+			WLS<Size,Precision>::add_mJ(m,J,scale);
+
+			//Upper right triangle only, as in WLS. compute() fills in the rest.
+			for(int r=0; r < my_true_C_inv.num_rows(); r++)
+			{
+				const Precision Jts = ts * J[r];
+				for(int c=r; c < my_true_C_inv.num_rows(); c++)
+					my_true_C_inv[r][c] += Jts * J[c];
+			}
+		}
+
+		/// Add a block of measurements at once. This is equivalent to calling
+		/// add_mJ(m[i], J[i]) for each row, but is much more efficient for large
+		/// blocks. The weights are computed for the whole block first in simple
+		/// loops which the compiler can vectorize, then both the inverse 
+		/// covariance and the true inverse covariance are updated together
+		/// in a single pass over \e J, one cache sized tile of measurements at
+		/// a time. If OpenMP is enabled, the rows of the update are divided
+		/// between threads.
+		/// @param m The measurements (residuals) to add
+		/// @param J The Jacobian matrix, with one row per measurement
+		template<int N, class B1, class B2>
+		void add_mJ_rows(const Vector<N,Precision,B1>& m, const Matrix<N,Size,Precision,B2>& J) {
+			SizeMismatch<N,N>::test(m.size(), J.num_rows());
+			SizeMismatch<Size,Size>::test(my_true_C_inv.num_rows(), J.num_cols());
+
+			const int size = my_true_C_inv.num_rows();
+			const int rows = J.num_rows();
+
+			//Weights for the whole block. The objective uses log() for some 
+			//reweighting functions, so it is kept out of the other loops.
+			Vector<N,Precision> w(rows), ts(rows);
+			for(int k=0; k < rows; k++)
+				w[k] = Reweight<Precision>::reweight(m[k]);
+			for(int k=0; k < rows; k++)
+				ts[k] = Reweight<Precision>::true_scale(m[k]);
+			for(int k=0; k < rows; k++)
+				my_residual += Reweight<Precision>::objective(m[k]);
 
-			Vector<Size,Precision> scaledm(m*ts);
+			Matrix<Size,Size,Precision>& C_inv = WLS<Size,Precision>::get_C_inv();
+			Vector<Size,Precision>& wls_vector = WLS<Size,Precision>::get_vector();
 
-			my_true_C_inv += scaledm.as_col() * scaledm.as_row();
+			//Packed copies of a tile of rows of J, and the rows scaled by each weight
+			Matrix<Dynamic,Size,Precision> Jt(std::min(rows, row_tile), size);
+			Matrix<Dynamic,Size,Precision> WJ(std::min(rows, row_tile), size);
+			Matrix<Dynamic,Size,Precision> TJ(std::min(rows, row_tile), size);
 
+			for(int k0=0; k0 < rows; k0 += row_tile)
+			{
+				const int kb = std::min(row_tile, rows - k0);
+				for(int k=0; k < kb; k++)
+				{
+					Jt[k] = J[k0+k];
+					WJ[k] = Jt[k] * w[k0+k];
+					TJ[k] = Jt[k] * ts[k0+k];
+					wls_vector += WJ[k] * m[k0+k];
+				}
+
+				//Rows of the update are independent. Later rows are shorter,
+				//so they are handed out dynamically.
+				#ifdef _OPENMP
+				#pragma omp parallel for schedule(dynamic, 4) if(size >= parallel_size)
+				#endif
+				for(int i=0; i < size; i++)
+				{
+					Precision* const C = &C_inv[i][0];
+					Precision* const T = &my_true_C_inv[i][0];
+					for(int k=0; k < kb; k++)
+					{
+						const Precision a = WJ[k][i];
+						const Precision b = TJ[k][i];
+						const Precision* const Jk = &Jt[k][0];
+						for(int j=i; j < size; j++)
+						{
+							const Precision x = Jk[j];
+							C[j] += a * x;
+							T[j] += b * x;
+						}
+					}
+				}
+			}
+		}
+
+		/// Process all the measurements and compute the weighted least squares
+		/// set of parameter values. This also fills in the lower left triangle
+		/// of the true inverse covariance.
+		void compute(){
+			for(int r=1; r < my_true_C_inv.num_rows(); r++)
+				for(int c=0; c < r; c++)
+					my_true_C_inv[r][c] = my_true_C_inv[c][r];
+
+			WLS<Size,Precision>::compute();
 		}
 
 		void operator += (const IRLS& meas){
-			WLS<Size>::operator+=(meas);
+			WLS<Size,Precision>::operator+=(meas);
 			my_true_C_inv += meas.my_true_C_inv;
+			my_residual += meas.my_residual;
 		}
 
 
+		/// Returns the true inverse covariance. Measurements only update the
+		/// upper right triangle, so the whole matrix is valid after compute().
 		Matrix<Size,Size,Precision>& get_true_C_inv() {return my_true_C_inv;}
+		/// Returns the true inverse covariance. Measurements only update the
+		/// upper right triangle, so the whole matrix is valid after compute().
 		const Matrix<Size,Size,Precision>& get_true_C_inv()const {return my_true_C_inv;}
 
 		Precision get_residual() {return my_residual;}
@@ -148,16 +245,20 @@ namespace TooN {
 		}
 
 	private:
+		static const int row_tile = 64;       ///< Number of measurements processed together by add_mJ_rows()
+		static const int parallel_size = 64;  ///< Smallest system for which add_mJ_rows() uses several threads
 
 		Precision my_residual;
 
 		Matrix<Size,Size,Precision> my_true_C_inv;
-
-		// comment out to allow bitwise copying
-		IRLS( IRLS& copyof );
-		int operator = ( IRLS& copyof );
 	};
 
+	template <int Size, typename Precision, template <typename ReweightPrecision> class Reweight>
+	const int IRLS<Size, Precision, Reweight>::row_tile;
+
+	template <int Size, typename Precision, template <typename ReweightPrecision> class Reweight>
+	const int IRLS<Size, Precision, Reweight>::parallel_size;
+
 }
 
 #endif
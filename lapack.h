@@ -75,6 +75,14 @@ namespace TooN {
 		// Cholesky inverse given decomposition
 		void dpotri_(const char* UPLO, const FortranInteger* N, double* A, const FortranInteger* LDA, FortranInteger* INFO);
 		void spotri_(const char* UPLO, const FortranInteger* N, float* A, const FortranInteger* LDA, FortranInteger* INFO);
+
+		// Cholesky decomposition, solve and inverse of a matrix in packed storage
+		void dpptrf_(const char* UPLO, const FortranInteger* N, double* AP, FortranInteger* INFO);
+		void spptrf_(const char* UPLO, const FortranInteger* N, float* AP, FortranInteger* INFO);
+		void dpptrs_(const char* UPLO, const FortranInteger* N, const FortranInteger* NRHS, const double* AP, double* B, const FortranInteger* LDB, FortranInteger* INFO);
+		void spptrs_(const char* UPLO, const FortranInteger* N, const FortranInteger* NRHS, const float* AP, float* B, const FortranInteger* LDB, FortranInteger* INFO);
+		void dpptri_(const char* UPLO, const FortranInteger* N, double* AP, FortranInteger* INFO);
+		void spptri_(const char* UPLO, const FortranInteger* N, float* AP, FortranInteger* INFO);
 		
 		// Computes a QR decomposition of a general rectangular matrix with column pivoting
 		void sgeqp3_(FortranInteger* M, FortranInteger* N, float* A, FortranInteger* LDA, FortranInteger* JPVT, float* TAU, float* WORK, FortranInteger* LWORK, FortranInteger* INFO );
@@ -83,6 +91,10 @@ namespace TooN {
 		//Reconstruct Q from a QR decomposition
 		void sorgqr_(FortranInteger* M,FortranInteger* N,FortranInteger* K, float* A, FortranInteger* LDA, float* TAU, float* WORK, FortranInteger* LWORK, FortranInteger* INFO );
 		void dorgqr_(FortranInteger* M,FortranInteger* N,FortranInteger* K, double* A, FortranInteger* LDA, double* TAU, double* WORK, FortranInteger* LWORK, FortranInteger* INFO );
+
+		//Multiply by Q from a QR decomposition, without forming Q
+		void sormqr_(const char* SIDE, const char* TRANS, FortranInteger* M, FortranInteger* N, FortranInteger* K, float* A, FortranInteger* LDA, float* TAU, float* C, FortranInteger* LDC, float* WORK, FortranInteger* LWORK, FortranInteger* INFO );
+		void dormqr_(const char* SIDE, const char* TRANS, FortranInteger* M, FortranInteger* N, FortranInteger* K, double* A, FortranInteger* LDA, double* TAU, double* C, FortranInteger* LDC, double* WORK, FortranInteger* LWORK, FortranInteger* INFO );
 	}
 
 
@@ -153,6 +165,31 @@ namespace TooN {
 		spotri_(UPLO, N, A, LDA, INFO);
 	}
 
+	// Cholesky decomposition, solve and inverse in packed storage
+	inline void pptrf_(const char* UPLO, const FortranInteger* N, double* AP, FortranInteger* INFO){
+		dpptrf_(UPLO, N, AP, INFO);
+	}
+
+	inline void pptrf_(const char* UPLO, const FortranInteger* N, float* AP, FortranInteger* INFO){
+		spptrf_(UPLO, N, AP, INFO);
+	}
+
+	inline void pptrs_(const char* UPLO, const FortranInteger* N, const FortranInteger* NRHS, const double* AP, double* B, const FortranInteger* LDB, FortranInteger* INFO){
+		dpptrs_(UPLO, N, NRHS, AP, B, LDB, INFO);
+	}
+
+	inline void pptrs_(const char* UPLO, const FortranInteger* N, const FortranInteger* NRHS, const float* AP, float* B, const FortranInteger* LDB, FortranInteger* INFO){
+		spptrs_(UPLO, N, NRHS, AP, B, LDB, INFO);
+	}
+
+	inline void pptri_(const char* UPLO, const FortranInteger* N, double* AP, FortranInteger* INFO){
+		dpptri_(UPLO, N, AP, INFO);
+	}
+
+	inline void pptri_(const char* UPLO, const FortranInteger* N, float* AP, FortranInteger* INFO){
+		spptri_(UPLO, N, AP, INFO);
+	}
+
 	inline void syev_(const char* JOBZ, const char* UPLO, FortranInteger* N, double* A, FortranInteger* lda, double* W, double* WORK, FortranInteger* LWORK, FortranInteger* INFO){
 		dsyev_(JOBZ, UPLO, N, A, lda, W, WORK, LWORK, INFO);
 	}
@@ -181,6 +218,16 @@ namespace TooN {
 		dorgqr_(M, N, K, A, LDA, TAU, WORK, LWORK, INFO);
 	}
 
+	inline void ormqr_(const char* SIDE, const char* TRANS, FortranInteger* M, FortranInteger* N, FortranInteger* K, float* A, FortranInteger* LDA, float* TAU, float* C, FortranInteger* LDC, float* WORK, FortranInteger* LWORK, FortranInteger* INFO )
+	{
+		sormqr_(SIDE, TRANS, M, N, K, A, LDA, TAU, C, LDC, WORK, LWORK, INFO);
+	}
+
+	inline void ormqr_(const char* SIDE, const char* TRANS, FortranInteger* M, FortranInteger* N, FortranInteger* K, double* A, FortranInteger* LDA, double* TAU, double* C, FortranInteger* LDC, double* WORK, FortranInteger* LWORK, FortranInteger* INFO )
+	{
+		dormqr_(SIDE, TRANS, M, N, K, A, LDA, TAU, C, LDC, WORK, LWORK, INFO);
+	}
+
 	//Non symmetric (general) eigen decomposition
 	inline void geev_(const char* JOBVL, const char* JOBVR, FortranInteger* N, double* A, FortranInteger* lda, double* WR, double* WI, double* VL, FortranInteger* LDVL, double* VR, FortranInteger* LDVR , double* WORK, FortranInteger* LWORK, FortranInteger* INFO){
 		dgeev_(JOBVL, JOBVR, N,  A,  lda,  WR,  WI,  VL,  LDVL,  VR,  LDVR ,  WORK,  LWORK,  INFO);
@@ -27,10 +27,12 @@
 #define TOON_BRENT_H
 #include <TooN/TooN.h>
 #include <TooN/helpers.h>
+#include <TooN/optimization/observer.h>
 #include <limits>
 #include <cmath>
 #include <cstdlib>
 #include <iomanip>
+#include <vector>
 
 
 namespace TooN
@@ -46,13 +48,16 @@ namespace TooN
 	/// @param b The most positive point along the line.
 	/// @param func The functor to minimize
 	/// @param maxiterations  Maximum number of iterations
-	/// @param tolerance Tolerance at which the search should be stopped (defults to sqrt machine precision)
-	/// @param epsilon Minimum bracket width (defaults to machine precision)
+	/// @param tolerance Tolerance at which the search should be stopped
+	/// @param epsilon Minimum bracket width
+	/// @param observer Observer to receive the evaluation and iteration events. See NullObserver.
 	/// @return The minima position is returned as the first element of the vector,
 	///         and the minimal value as the second element.
 	/// @ingroup gOptimize
-	template<class Functor, class Precision> Vector<2, Precision> brent_line_search(Precision a, Precision x, Precision b, Precision fx, const Functor& func, int maxiterations, Precision tolerance = sqrt(numeric_limits<Precision>::epsilon()), Precision epsilon = numeric_limits<Precision>::epsilon())
+	template<class Functor, class Precision, class Observer> Vector<2, Precision> brent_line_search(Precision a, Precision x, Precision b, Precision fx, const Functor& func, int maxiterations, Precision tolerance, Precision epsilon, Observer& observer)
 	{
+		const Internal::ObservedFunction<Functor, Precision, Observer> observed_func(func, observer);
+
 		using std::min;
 		using std::max;
 
@@ -155,7 +160,7 @@ namespace TooN
 
 			const Precision u = x+d;
 			//Our one function evaluation per iteration
-			const Precision fu = func(u);
+			const Precision fu = observed_func(u);
 
 			if(fu < fx)
 			{
@@ -193,9 +198,216 @@ namespace TooN
 					v = u; fv = fu;
 				}
 			}
+
+			observer.iteration(fx, abs(d));
 		}
 
 		return makeVector(x, fx);
 	}
+
+	/// brent_line_search performs Brent's golden section/quadratic interpolation search
+	/// on the functor provided. The inputs a, x, b must bracket the minimum, and
+	/// must be in order, so  that \f$ a < x < b \f$ and \f$ f(a) > f(x) < f(b) \f$.
+	/// @param a The most negative point along the line.
+	/// @param x The central point.
+	/// @param fx The value of the function at the central point (\f$b\f$).
+	/// @param b The most positive point along the line.
+	/// @param func The functor to minimize
+	/// @param maxiterations  Maximum number of iterations
+	/// @param tolerance Tolerance at which the search should be stopped (defults to sqrt machine precision)
+	/// @param epsilon Minimum bracket width (defaults to machine precision)
+	/// @return The minima position is returned as the first element of the vector,
+	///         and the minimal value as the second element.
+	/// @ingroup gOptimize
+	template<class Functor, class Precision> Vector<2, Precision> brent_line_search(Precision a, Precision x, Precision b, Precision fx, const Functor& func, int maxiterations, Precision tolerance = std::sqrt(numeric_limits<Precision>::epsilon()), Precision epsilon = numeric_limits<Precision>::epsilon())
+	{
+		NullObserver observer;
+		return brent_line_search(a, x, b, fx, func, maxiterations, tolerance, epsilon, observer);
+	}
+
+	namespace Internal{
+		///@internal
+		///@brief State of each lane in brent_line_search_batch(). The first
+		///\e lanes entries are active; retired lanes are replaced by the last
+		///active lane so that the active lanes stay contiguous.
+		///@ingroup gInternal
+		template<class Precision> struct BrentLanes
+		{
+			BrentLanes(int n)
+			:lanes(n), problem(n), a(n), b(n), x(n), fx(n), w(n), fw(n), v(n), fv(n), d(n), e(n), u(n), fu(n)
+			{}
+
+			int lanes;
+			std::vector<int> problem;
+			Vector<Dynamic, Precision> a, b, x, fx, w, fw, v, fv, d, e, u, fu;
+
+			void retire(int l, Matrix<Dynamic, 2, Precision>& result)
+			{
+				result[problem[l]] = makeVector(x[l], fx[l]);
+
+				lanes--;
+				problem[l] = problem[lanes];
+				a[l] = a[lanes];
+				b[l] = b[lanes];
+				x[l] = x[lanes];
+				fx[l] = fx[lanes];
+				w[l] = w[lanes];
+				fw[l] = fw[lanes];
+				v[l] = v[lanes];
+				fv[l] = fv[lanes];
+				d[l] = d[lanes];
+				e[l] = e[lanes];
+			}
+		};
+	}
+
+	/// brent_line_search_batch performs brent_line_search() on many independent
+	/// problems at once. All problems are advanced together, one iteration at a
+	/// time, and problems are retired as soon as they converge. Each step is
+	/// computed for every active problem with simple loops over contiguous
+	/// arrays and without data dependent control flow, so that the compiler is
+	/// able to vectorize them (GCC also needs <code>-fno-trapping-math</code> to do
+	/// so). The result for each problem is the same as
+	/// calling brent_line_search() on it, apart from rounding differences if the
+	/// compiler contracts the arithmetic differently (e.g. into FMA instructions).
+	///
+	/// The functor is called as <code>func(i, u)</code> and must return the value
+	/// of the <i>i</i>th function at <i>u</i>. Within an iteration, it is called
+	/// once for each active problem in turn.
+	///
+	/// @param a The most negative point along the line, for each problem.
+	/// @param x The central point, for each problem.
+	/// @param b The most positive point along the line, for each problem.
+	/// @param fx The value of the function at each central point.
+	/// @param func The functor to minimize
+	/// @param maxiterations  Maximum number of iterations
+	/// @param tolerance Tolerance at which the search should be stopped (defults to sqrt machine precision)
+	/// @param epsilon Minimum bracket width (defaults to machine precision)
+	/// @return Row <i>i</i> holds the minimum position and value for problem <i>i</i>,
+	///         as returned by brent_line_search().
+	/// @ingroup gOptimize
+	template<class Functor, int S, class Precision, class B1, class B2, class B3, class B4> Matrix<Dynamic, 2, Precision> brent_line_search_batch(const Vector<S, Precision, B1>& a, const Vector<S, Precision, B2>& x, const Vector<S, Precision, B3>& b, const Vector<S, Precision, B4>& fx, const Functor& func, int maxiterations, Precision tolerance = std::sqrt(numeric_limits<Precision>::epsilon()), Precision epsilon = numeric_limits<Precision>::epsilon())
+	{
+		using std::abs;
+		using std::sqrt;
+
+		const int n = a.size();
+		SizeMismatch<S, S>::test(n, x.size());
+		SizeMismatch<S, S>::test(n, b.size());
+		SizeMismatch<S, S>::test(n, fx.size());
+
+		//The golden ratio:
+		const Precision g = (3.0 - sqrt(5))/2;
+
+		Matrix<Dynamic, 2, Precision> result(n, 2);
+		Internal::BrentLanes<Precision> s(n);
+
+		for(int l=0; l < n; l++)
+		{
+			s.problem[l] = l;
+			s.a[l] = a[l];
+			s.b[l] = b[l];
+			s.x[l] = s.w[l] = s.v[l] = x[l];
+			s.fx[l] = s.fw[l] = s.fv[l] = fx[l];
+			s.d[l] = s.e[l] = 0;
+		}
+
+		for(int i=0; ; i++)
+		{
+			//Retire the lanes which have finished. All lanes have done
+			//the same number of iterations.
+			for(int l=0; l < s.lanes; )
+				if(abs(s.b[l]-s.a[l]) > (abs(s.a[l]) + abs(s.b[l])) * tolerance + epsilon && i < maxiterations)
+					l++;
+				else
+					s.retire(l, result);
+
+			if(s.lanes == 0)
+				break;
+
+			//Compute the next point in each lane. See brent_line_search()
+			//for a description of the algorithm.
+			//The masks are combined with bitwise operators and all values are
+			//loaded up front so that the loop has no branches.
+			for(int l=0; l < s.lanes; l++)
+			{
+				const Precision a = s.a[l], b = s.b[l], x = s.x[l], fx = s.fx[l];
+				const Precision w = s.w[l], fw = s.fw[l], v = s.v[l], fv = s.fv[l];
+				const Precision d = s.d[l], e = s.e[l];
+
+				const Precision xm = (a+b)/2;
+				const Precision tol1 = abs(x)*tolerance + epsilon;
+
+				const Precision fxw = fw - fx;
+				const Precision fxv = fv - fx;
+				const Precision xw = w-x;
+				const Precision xv = v-x;
+				const Precision p = fxv*xw*xw - fxw*xv*xv;
+				const Precision q = 2*(fxv*xw - fxw*xv);
+				const Precision step = p / (q == 0 ? 1 : q);
+
+				//Mask for lanes which take the parabolic step
+				const bool parabolic = (abs(e) > tol1) & (w != v) & (q != 0) &
+				                       !((x + step < a) | (x + step > b) | (abs(step) > abs(e/2)));
+
+				const Precision golden_e = x > xm ? a - x : b - x;
+
+				s.e[l] = parabolic ? d : golden_e;
+				s.d[l] = parabolic ? step : g * golden_e;
+				s.u[l] = x + (parabolic ? step : g * golden_e);
+			}
+
+			for(int l=0; l < s.lanes; l++)
+				s.fu[l] = func(s.problem[l], s.u[l]);
+
+			//Update the bracket and the best three points in each lane.
+			for(int l=0; l < s.lanes; l++)
+			{
+				const Precision u = s.u[l], fu = s.fu[l];
+				const Precision x = s.x[l], fx = s.fx[l];
+				const Precision w = s.w[l], fw = s.fw[l];
+				const Precision v = s.v[l], fv = s.fv[l];
+				const Precision a = s.a[l], b = s.b[l];
+
+				//Masks for u being the best, second best and third best point
+				const bool best = fu < fx;
+				const bool second = (!best) & ((fu <= fw) | (w == x));
+				const bool third = (!best) & (!second) & ((fu <= fv) | (v == x) | (v == w));
+
+				s.a[l] = best ? (u > x ? x : a) : (u < x ? u : a);
+				s.b[l] = best ? (u > x ? b : x) : (u < x ? b : u);
+
+				s.v[l]  = (best | second) ? w  : third ? u  : v;
+				s.fv[l] = (best | second) ? fw : third ? fu : fv;
+				s.w[l]  = best ? x  : second ? u  : w;
+				s.fw[l] = best ? fx : second ? fu : fw;
+				s.x[l]  = best ? u  : x;
+				s.fx[l] = best ? fu : fx;
+			}
+		}
+
+		return result;
+	}
+
+	/// brent_line_search_batch performs brent_line_search() on many independent
+	/// problems at once. See the function above for details. This version
+	/// first evaluates <code>func(i, x[i])</code> for each problem.
+	/// @param a The most negative point along the line, for each problem.
+	/// @param x The central point, for each problem.
+	/// @param b The most positive point along the line, for each problem.
+	/// @param func The functor to minimize
+	/// @param maxiterations  Maximum number of iterations
+	/// @param tolerance Tolerance at which the search should be stopped (defults to sqrt machine precision)
+	/// @param epsilon Minimum bracket width (defaults to machine precision)
+	/// @return Row <i>i</i> holds the minimum position and value for problem <i>i</i>.
+	/// @ingroup gOptimize
+	template<class Functor, int S, class Precision, class B1, class B2, class B3> Matrix<Dynamic, 2, Precision> brent_line_search_batch(const Vector<S, Precision, B1>& a, const Vector<S, Precision, B2>& x, const Vector<S, Precision, B3>& b, const Functor& func, int maxiterations, Precision tolerance = std::sqrt(numeric_limits<Precision>::epsilon()), Precision epsilon = numeric_limits<Precision>::epsilon())
+	{
+		Vector<S, Precision> fx(x.size());
+		for(int i=0; i < x.size(); i++)
+			fx[i] = func(i, x[i]);
+
+		return brent_line_search_batch(a, x, b, fx, func, maxiterations, tolerance, epsilon);
+	}
 }
 #endif
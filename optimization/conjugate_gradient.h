@@ -23,6 +23,9 @@
 //ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
 //POSSIBILITY OF SUCH DAMAGE.
 
+#ifndef TOON_CONJUGATE_GRADIENT_H
+#define TOON_CONJUGATE_GRADIENT_H
+
 #include <TooN/optimization/brent.h>
 #include <utility>
 #include <cmath>
@@ -69,12 +72,15 @@ namespace TooN{
 	///@param func Function to bracket
 	///@param initial_lambda Initial stepsize
 	///@param zeps Minimum bracket size.
+	///@param observer Observer to receive the evaluation and bracket expansion events. See NullObserver.
 	///@return <code>m[i][0]</code> contains the values of \f$x\f$ for the bracket, in increasing order,
 	///        and <code>m[i][1]</code> contains the corresponding values of \f$f(x)\f$. If the bracket 
 	///        drops below the minimum bracket size, all zeros are returned.
 	///@ingroup gOptimize
-	template<typename Precision, typename Func> Matrix<3,2,Precision> bracket_minimum_forward(Precision a_val, const Func& func, Precision initial_lambda, Precision zeps)
+	template<typename Precision, typename Func, typename Observer> Matrix<3,2,Precision> bracket_minimum_forward(Precision a_val, const Func& func, Precision initial_lambda, Precision zeps, Observer& observer)
 	{
+		const ObservedFunction<Func, Precision, Observer> observed_func(func, observer);
+
 		//Get a, b, c to  bracket a minimum along a line
 		Precision a, b, c, b_val, c_val;
 
@@ -83,7 +89,7 @@ namespace TooN{
 		//Search forward in steps of lambda
 		Precision lambda=initial_lambda;
 		b = lambda;
-		b_val = func(b);
+		b_val = observed_func(b);
 
 		while(std::isnan(b_val))
 		{
@@ -92,7 +98,7 @@ namespace TooN{
 			//try backing off lambda
 			lambda*=.5;
 			b = lambda;
-			b_val = func(b);
+			b_val = observed_func(b);
 
 		}
 
@@ -104,8 +110,9 @@ namespace TooN{
 			for(;;)
 			{
 				lambda *= 2;
+				observer.bracket_expansions(1);
 				c = lambda;
-				c_val = func(c);
+				c_val = observed_func(c);
 
 				if(std::isnan(c_val))
 					break;
@@ -133,7 +140,7 @@ namespace TooN{
 				{
 					l*=.5;
 					c = last_good_lambda + (bad_lambda - last_good_lambda)*l;
-					c_val = func(c);
+					c_val = observed_func(c);
 
 					if(!std::isnan(c_val))
 						break;
@@ -153,7 +160,7 @@ namespace TooN{
 			{
 				lambda *= .5;
 				b = lambda;
-				b_val = func(b);
+				b_val = observed_func(b);
 
 				if(b_val < a_val)// we have a bracket
 					break;
@@ -175,6 +182,23 @@ namespace TooN{
 		return ret;
 	}
 
+	///Bracket a 1D function by searching forward from zero. The assumption
+	///is that a minima exists in \f$f(x),\ x>0\f$, and this function searches
+	///for a bracket using exponentially growning or shrinking steps.
+	///@param a_val The value of the function at zero.
+	///@param func Function to bracket
+	///@param initial_lambda Initial stepsize
+	///@param zeps Minimum bracket size.
+	///@return <code>m[i][0]</code> contains the values of \f$x\f$ for the bracket, in increasing order,
+	///        and <code>m[i][1]</code> contains the corresponding values of \f$f(x)\f$. If the bracket 
+	///        drops below the minimum bracket size, all zeros are returned.
+	///@ingroup gOptimize
+	template<typename Precision, typename Func> Matrix<3,2,Precision> bracket_minimum_forward(Precision a_val, const Func& func, Precision initial_lambda, Precision zeps)
+	{
+		NullObserver observer;
+		return bracket_minimum_forward(a_val, func, initial_lambda, zeps, observer);
+	}
+
 }
 
 
@@ -220,9 +244,12 @@ tunable parameters, and the internals are readily accessible, so alternative
 termination conditions etc can easily be substituted. However, ususally these
 will not be necessary.
 
+The optional \e Observer parameter receives the function, derivative and
+line search events; see NullObserver and OptimizationTrace.
+
 @ingroup gOptimize
 */
-template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
+template<int Size=Dynamic, class Precision=double, class Observer=NullObserver> struct ConjugateGradient
 {
 	const int size;      ///< Dimensionality of the space.
 	Vector<Size> g;      ///< Gradient vector used by the next call to iterate()
@@ -248,6 +275,8 @@ template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
 
 	int iterations; ///< Number of iterations performed
 
+	Observer observer; ///< Observer receiving the events from the optimization. See NullObserver.
+
 	///Initialize the ConjugateGradient class with sensible values.
 	///@param start Starting point, \e x
 	///@param func  Function \e f  to compute \f$f(x)\f$
@@ -257,6 +286,8 @@ template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
 	  g(size),h(size),minus_h(size),old_g(size),old_h(size),x(start),old_x(size)
 	{
 		init(start, func(start), deriv(start));
+		observer.function_evaluations(1);
+		observer.derivative_evaluations(1);
 	}	
 
 	///Initialize the ConjugateGradient class with sensible values.
@@ -268,6 +299,7 @@ template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
 	  g(size),h(size),minus_h(size),old_g(size),old_h(size),x(start),old_x(size)
 	{
 		init(start, func(start), deriv);
+		observer.function_evaluations(1);
 	}	
 
 	///Initialize the ConjugateGradient class with sensible values. Used internally.
@@ -322,10 +354,11 @@ template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
 	template<class Func> void find_next_point(const Func& func)
 	{
 		Internal::LineSearch<Size, Precision, Func> line(x, minus_h, func);
+		Internal::LineSearchObserver<Observer> line_observer(observer);
 
 		//Always search in the conjugate direction (h)
 		//First bracket a minimum.
-		Matrix<3,2,Precision> bracket = Internal::bracket_minimum_forward(y, line, bracket_initial_lambda, bracket_epsilon);
+		Matrix<3,2,Precision> bracket = Internal::bracket_minimum_forward(y, line, bracket_initial_lambda, bracket_epsilon, line_observer);
 		
 		double a = bracket[0][0];
 		double b = bracket[1][0];
@@ -359,7 +392,7 @@ template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
 			assert(a_val > b_val && b_val < c_val);
 
 			//Find the real minimum
-			Vector<2, Precision>  m = brent_line_search(a, b, c, b_val, line, linesearch_max_iterations, linesearch_tolerance, linesearch_epsilon);
+			Vector<2, Precision>  m = brent_line_search(a, b, c, b_val, line, linesearch_max_iterations, linesearch_tolerance, linesearch_epsilon, line_observer);
 
 			assert(m[0] >= a && m[0] <= c);
 			assert(m[1] <= b_val);
@@ -420,9 +453,13 @@ template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
 	{
 		find_next_point(func);
 
+		if(Internal::ObserverIsActive<Observer>::value)
+			observer.iteration(y, norm(x - old_x));
+
 		if(!finished())
 		{
 			update_vectors_PR(deriv(x));
+			observer.derivative_evaluations(1);
 			return 1;
 		}
 		else
@@ -431,3 +468,4 @@ template<int Size=Dynamic, class Precision=double> struct ConjugateGradient
 };
 
 }
+#endif
@@ -27,6 +27,7 @@
 #define TOON_DOWNHILL_SIMPLEX_H
 #include <TooN/TooN.h>
 #include <TooN/helpers.h>
+#include <TooN/optimization/observer.h>
 #include <algorithm>
 #include <cstdlib>
 
@@ -59,6 +60,21 @@ namespace TooN
 	- \f$\rho = 2\f$
 	- \f$\gamma = 1/2\f$
 	- \f$\sigma = 1/2\f$
+
+	For expensive functions, the independent evaluations can be performed
+	concurrently with OpenMP, if it is enabled. If #parallel is set, the
+	vertices are evaluated in parallel when the simplex is created or shrunk.
+	To evaluate the initial simplex in parallel, pass \e parallel_ to the
+	constructor, since the vertices are evaluated before it returns.
+	If #speculative is also set, the reflected, expanded and contracted points
+	are evaluated together at every iteration, even though at most two of them
+	will be needed. This costs extra evaluations, but reduces the time per
+	iteration. In either case, the function will be called concurrently from
+	different threads, so it must not modify any shared state. The sequence of
+	points visited is the same in all modes.
+
+	The optional \e Observer parameter receives the function evaluation and
+	iteration events; see NullObserver and OptimizationTrace.
 	
 	Example usage:
 	@code
@@ -99,7 +115,7 @@ int main()
 
 
 **/
-template<int N=-1, typename Precision=double> class DownhillSimplex
+template<int N=-1, typename Precision=double, class Observer=NullObserver> class DownhillSimplex
 {
 	static const int Vertices = (N==-1?-1:N+1);
 	typedef Matrix<Vertices, N, Precision> Simplex;
@@ -114,13 +130,19 @@ template<int N=-1, typename Precision=double> class DownhillSimplex
 		///@param c          Origin of the initial simplex. The dimension of this vector
 		///                  is used to determine the dimension of the run-time sized version.
 		///@param spread     Size of the initial simplex.
-		template<class Function> DownhillSimplex(const Function& func, const Vector<N>& c, Precision spread=1)
+		///@param parallel_  Initial value of #parallel. This is set before the vertices
+		///                  of the initial simplex are evaluated, so they are evaluated
+		///                  concurrently if it is true.
+		///@param speculative_ Initial value of #speculative.
+		template<class Function> DownhillSimplex(const Function& func, const Vector<N>& c, Precision spread=1, bool parallel_=0, bool speculative_=0)
 		:simplex(c.size()+1, c.size()),values(c.size()+1)
 		{
 			alpha = 1.0;
 			rho = 2.0;
 			gamma = 0.5;
 			sigma = 0.5;
+			parallel = parallel_;
+			speculative = speculative_;
 
 			using std::sqrt;
 			epsilon = sqrt(numeric_limits<Precision>::epsilon());
@@ -143,8 +165,7 @@ template<int N=-1, typename Precision=double> class DownhillSimplex
 			for(int i=0; i < simplex.num_cols(); i++)
 				simplex[i][i] += spread;
 
-			for(int i=0; i < values.size(); i++)
-				values[i] = func(simplex[i]);
+			evaluate_vertices(func, -1);
 		}
 		
 		///Check to see it iteration should stop. You probably do not want to use
@@ -233,13 +254,36 @@ template<int N=-1, typename Precision=double> class DownhillSimplex
 
 			//Reflect the worst point about the centroid.
 			Vector<N> xr = (1 + alpha) * x0 - alpha * simplex[worst];
-			Precision fr = func(xr);
+			Precision fr, fe = 0, fc = 0;
+
+			if(parallel && speculative)
+			{
+				//Evaluate the expanded and contracted points as well, even
+				//though they may not be needed.
+				Matrix<3, N, Precision> candidates(3, simplex.num_cols());
+				candidates[0] = xr;
+				candidates[1] = rho * xr + (1-rho) * x0;
+				candidates[2] = (1 + gamma) * x0 - gamma * simplex[worst];
+				Vector<3, Precision> f = evaluate(func, candidates);
+				fr = f[0];
+				fe = f[1];
+				fc = f[2];
+			}
+			else
+			{
+				fr = func(xr);
+				observer.function_evaluations(1);
+			}
 
 			if(fr < bestval)
 			{
 				//If the new point is better than the smallest, then try expanding the simplex.
 				Vector<N> xe = rho * xr + (1-rho) * x0;
-				Precision fe = func(xe);
+				if(!(parallel && speculative))
+				{
+					fe = func(xe);
+					observer.function_evaluations(1);
+				}
 
 				//Keep whichever is best
 				if(fe < fr)
@@ -272,7 +316,11 @@ template<int N=-1, typename Precision=double> class DownhillSimplex
 			if(fr < worst_val)
 			{
 				Vector<N> xc = (1 + gamma) * x0 - gamma * simplex[worst];
-				Precision fc = func(xc);
+				if(!(parallel && speculative))
+				{
+					fc = func(xc);
+					observer.function_evaluations(1);
+				}
 
 				//If this helped, use it
 				if(fc <= fr)
@@ -287,10 +335,9 @@ template<int N=-1, typename Precision=double> class DownhillSimplex
 			//than fr. So shrink the whole simplex around the best point.
 			for(int i=0; i < simplex.num_rows(); i++)
 				if(i != best)
-				{
 					simplex[i] = simplex[best] + sigma * (simplex[i] - simplex[best]);
-					values[i] = func(simplex[i]);
-				}
+
+			evaluate_vertices(func, best);
 		}
 
 		///Perform one iteration of the downhill Simplex algorithm, and return the result
@@ -299,6 +346,10 @@ template<int N=-1, typename Precision=double> class DownhillSimplex
 		template<class Function> bool iterate(const Function& func)
 		{
 			find_next_point(func);
+
+			if(Internal::ObserverIsActive<Observer>::value)
+				observer.iteration(values[get_best()], norm(simplex[get_best()] - simplex[get_worst()]));
+
 			return !finished();
 		}
 
@@ -308,9 +359,43 @@ template<int N=-1, typename Precision=double> class DownhillSimplex
 		Precision sigma; ///< Shrink ratio. Defaults to .5.
 		Precision epsilon;  ///< Tolerance used to determine if the optimization is complete. Defaults to square root of machine precision.
 		Precision zero_epsilon; ///< Additive term in tolerance to prevent excessive iterations if \f$x_\mathrm{optimal} = 0\f$. Known as \c ZEPS in numerical recipies. Defaults to 1e-20
+		bool parallel;    ///< Evaluate independent points concurrently, if OpenMP is enabled. Defaults to false.
+		bool speculative; ///< If #parallel is set, evaluate the reflected, expanded and contracted points together. Defaults to false.
+		Observer observer; ///< Observer receiving the events from the optimization. See NullObserver.
 
 	private:
 
+		//Evaluate all the vertices, apart from vertex skip
+		template<class Function> void evaluate_vertices(const Function& func, int skip)
+		{
+			const int n = simplex.num_rows();
+
+			#ifdef _OPENMP
+			#pragma omp parallel for schedule(dynamic) if(parallel)
+			#endif
+			for(int i=0; i < n; i++)
+				if(i != skip)
+					values[i] = func(simplex[i]);
+
+			observer.function_evaluations(skip == -1 ? n : n-1);
+		}
+
+		//Evaluate the function at each row of points
+		template<class Function, int R> Vector<R, Precision> evaluate(const Function& func, const Matrix<R, N, Precision>& points)
+		{
+			const int n = points.num_rows();
+			Vector<R, Precision> f(n);
+
+			#ifdef _OPENMP
+			#pragma omp parallel for schedule(dynamic) if(parallel)
+			#endif
+			for(int i=0; i < n; i++)
+				f[i] = func(points[i]);
+
+			observer.function_evaluations(n);
+			return f;
+		}
+
 		//Each row is a simplex vertex
 		Simplex simplex;
 
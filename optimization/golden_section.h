@@ -26,10 +26,12 @@
 #ifndef TOON_GOLDEN_SECTION_H
 #define TOON_GOLDEN_SECTION_H
 #include <TooN/TooN.h>
+#include <TooN/optimization/observer.h>
 #include <limits>
 #include <cmath>
 #include <cstdlib>
 #include <iomanip>
+#include <vector>
 
 namespace TooN
 {
@@ -45,12 +47,17 @@ namespace TooN
 	/// @param func The functor to minimize
 	/// @param maxiterations  Maximum number of iterations
 	/// @param tol Tolerance at which the search should be stopped.
+	/// @param observer Observer to receive the evaluation and iteration events. See NullObserver.
 	/// @return The minima position is returned as the first element of the vector,
 	///         and the minimal value as the second element.
 	/// @ingroup gOptimize
-	template<class Functor, class Precision> Vector<2, Precision> golden_section_search(Precision a, Precision b, Precision c, Precision fb, const Functor& func, int maxiterations, Precision tol = sqrt(numeric_limits<Precision>::epsilon()))
+	template<class Functor, class Precision, class Observer> Vector<2, Precision> golden_section_search(Precision a, Precision b, Precision c, Precision fb, const Functor& func, int maxiterations, Precision tol, Observer& observer)
 	{
+		const Internal::ObservedFunction<Functor, Precision, Observer> observed_func(func, observer);
+
 		using std::abs;
+		using std::sqrt;
+		using std::min;
 		//The golden ratio:
 		const Precision g = (3.0 - sqrt(5))/2;
 
@@ -64,7 +71,7 @@ namespace TooN
 			x1 = b - g*(b-a);
 			x2 = b;
 
-			fx1 = func(x1);
+			fx1 = observed_func(x1);
 			fx2 = fb;
 		}
 		else
@@ -73,7 +80,7 @@ namespace TooN
 			x1 = b;
 
 			fx1 = fb;
-			fx2 = func(x2);
+			fx2 = observed_func(x2);
 		}
 
 		//We now have an ordered list of points a x1 x2 c
@@ -92,7 +99,7 @@ namespace TooN
 				x2 = x1 + g * (c-x1);
 				
 				fx1 = fx2;
-				fx2 = func(x2);
+				fx2 = observed_func(x2);
 			}
 			else
 			{
@@ -104,8 +111,10 @@ namespace TooN
 				x1= x2 - g * (x2 - a);
 				
 				fx2 = fx1;
-				fx1 = func(x1);
+				fx1 = observed_func(x1);
 			}
+
+			observer.iteration(min(fx1, fx2), abs(x2 - x1));
 		}
 
 		
@@ -115,6 +124,25 @@ namespace TooN
 			return makeVector<Precision>(x2, fx2);
 	}
 
+	/// golden_section_search performs a golden section search line minimization
+	/// on the functor provided. The inputs a, b, c must bracket the minimum, and
+	/// must be in order, so  that \f$ a < b < c \f$ and \f$ f(a) > f(b) < f(c) \f$.
+	/// @param a The most negative point along the line.
+	/// @param b The central point.
+	/// @param fb The value of the function at the central point (\f$b\f$).
+	/// @param c The most positive point along the line.
+	/// @param func The functor to minimize
+	/// @param maxiterations  Maximum number of iterations
+	/// @param tol Tolerance at which the search should be stopped.
+	/// @return The minima position is returned as the first element of the vector,
+	///         and the minimal value as the second element.
+	/// @ingroup gOptimize
+	template<class Functor, class Precision> Vector<2, Precision> golden_section_search(Precision a, Precision b, Precision c, Precision fb, const Functor& func, int maxiterations, Precision tol = std::sqrt(numeric_limits<Precision>::epsilon()))
+	{
+		NullObserver observer;
+		return golden_section_search(a, b, c, fb, func, maxiterations, tol, observer);
+	}
+
 	/// golden_section_search performs a golden section search line minimization
 	/// on the functor provided. The inputs a, b, c must bracket the minimum, and
 	/// must be in order, so  that \f$ a < b < c \f$ and \f$ f(a) > f(b) < f(c) \f$.
@@ -127,10 +155,177 @@ namespace TooN
 	/// @return The minima position is returned as the first element of the vector,
 	///         and the minimal value as the second element.
 	/// @ingroup gOptimize
-	template<class Functor, class Precision> Vector<2, Precision> golden_section_search(Precision a, Precision b, Precision c, const Functor& func, int maxiterations, Precision tol = sqrt(numeric_limits<Precision>::epsilon()))
+	template<class Functor, class Precision> Vector<2, Precision> golden_section_search(Precision a, Precision b, Precision c, const Functor& func, int maxiterations, Precision tol = std::sqrt(numeric_limits<Precision>::epsilon()))
 	{
 		return golden_section_search(a, b, c, func(b), func, maxiterations, tol);
 	}
 
+	namespace Internal{
+		///@internal
+		///@brief State of each lane in golden_section_search_batch(). The first
+		///\e lanes entries are active; retired lanes are replaced by the last
+		///active lane so that the active lanes stay contiguous.
+		///@ingroup gInternal
+		template<class Precision> struct GoldenSectionLanes
+		{
+			GoldenSectionLanes(int n)
+			:lanes(n), problem(n), right(n), a(n), x1(n), x2(n), c(n), fx1(n), fx2(n), u(n), fu(n)
+			{}
+
+			int lanes;
+			std::vector<int> problem;
+			std::vector<int> right;
+			Vector<Dynamic, Precision> a, x1, x2, c, fx1, fx2, u, fu;
+
+			void retire(int l, Matrix<Dynamic, 2, Precision>& result)
+			{
+				if(fx1[l] < fx2[l])
+					result[problem[l]] = makeVector(x1[l], fx1[l]);
+				else
+					result[problem[l]] = makeVector(x2[l], fx2[l]);
+
+				lanes--;
+				problem[l] = problem[lanes];
+				a[l] = a[lanes];
+				x1[l] = x1[lanes];
+				x2[l] = x2[lanes];
+				c[l] = c[lanes];
+				fx1[l] = fx1[lanes];
+				fx2[l] = fx2[lanes];
+			}
+
+			//Evaluate u in every lane, and store the result in fx2 (if right
+			//is set) or fx1.
+			template<class Functor> void evaluate(const Functor& func)
+			{
+				for(int l=0; l < lanes; l++)
+					fu[l] = func(problem[l], u[l]);
+
+				for(int l=0; l < lanes; l++)
+				{
+					const Precision f1 = fx1[l], f2 = fx2[l], f = fu[l];
+					fx1[l] = right[l] ? f1 : f;
+					fx2[l] = right[l] ? f : f2;
+				}
+			}
+		};
+	}
+
+	/// golden_section_search_batch performs golden_section_search() on many
+	/// independent problems at once. All problems are advanced together, one
+	/// iteration at a time, and problems are retired as soon as they converge.
+	/// Each step is computed for every active problem with simple loops over
+	/// contiguous arrays and without data dependent control flow, so that the
+	/// compiler is able to vectorize them (GCC also needs <code>-fno-trapping-math</code>
+	/// to do so). Unless \e maxiterations is reached,
+	/// the result for each problem is the same as calling golden_section_search()
+	/// on it, apart from rounding differences if the compiler contracts the
+	/// arithmetic differently (e.g. into FMA instructions).
+	///
+	/// The functor is called as <code>func(i, u)</code> and must return the value
+	/// of the <i>i</i>th function at <i>u</i>. Within an iteration, it is called
+	/// once for each active problem in turn.
+	///
+	/// @param a The most negative point along the line, for each problem.
+	/// @param b The central point, for each problem.
+	/// @param c The most positive point along the line, for each problem.
+	/// @param fb The value of the function at each central point.
+	/// @param func The functor to minimize
+	/// @param maxiterations  Maximum number of iterations
+	/// @param tol Tolerance at which the search should be stopped.
+	/// @return Row <i>i</i> holds the minimum position and value for problem <i>i</i>,
+	///         as returned by golden_section_search().
+	/// @ingroup gOptimize
+	template<class Functor, int S, class Precision, class B1, class B2, class B3, class B4> Matrix<Dynamic, 2, Precision> golden_section_search_batch(const Vector<S, Precision, B1>& a, const Vector<S, Precision, B2>& b, const Vector<S, Precision, B3>& c, const Vector<S, Precision, B4>& fb, const Functor& func, int maxiterations, Precision tol = std::sqrt(numeric_limits<Precision>::epsilon()))
+	{
+		using std::abs;
+		using std::sqrt;
+
+		const int n = a.size();
+		SizeMismatch<S, S>::test(n, b.size());
+		SizeMismatch<S, S>::test(n, c.size());
+		SizeMismatch<S, S>::test(n, fb.size());
+
+		//The golden ratio:
+		const Precision g = (3.0 - sqrt(5))/2;
+
+		Matrix<Dynamic, 2, Precision> result(n, 2);
+		Internal::GoldenSectionLanes<Precision> s(n);
+
+		//Perform an initial iteration in each lane, to get a 4 point
+		//bracketing. See golden_section_search().
+		for(int l=0; l < n; l++)
+		{
+			s.problem[l] = l;
+			s.right[l] = !(abs(b[l]-a[l]) > abs(c[l]-b[l]));
+			s.a[l] = a[l];
+			s.c[l] = c[l];
+			s.x1[l] = s.right[l] ? b[l] : b[l] - g*(b[l]-a[l]);
+			s.x2[l] = s.right[l] ? b[l] + g*(c[l]-b[l]) : b[l];
+			s.fx1[l] = fb[l];
+			s.fx2[l] = fb[l];
+			s.u[l] = s.right[l] ? s.x2[l] : s.x1[l];
+		}
+
+		s.evaluate(func);
+
+		for(int i=1; ; i++)
+		{
+			//Retire the lanes which have finished. All lanes have done
+			//the same number of iterations.
+			for(int l=0; l < s.lanes; )
+				if(abs(s.c[l]-s.a[l]) > tol * (abs(s.x2[l])+abs(s.x1[l])) && i < maxiterations)
+					l++;
+				else
+					s.retire(l, result);
+
+			if(s.lanes == 0)
+				break;
+
+			//Shrink the bracket in each lane, from the right if fx1 > fx2
+			//and from the left otherwise.
+			for(int l=0; l < s.lanes; l++)
+			{
+				const Precision a = s.a[l], x1 = s.x1[l], x2 = s.x2[l], c = s.c[l];
+				const Precision fx1 = s.fx1[l], fx2 = s.fx2[l];
+				const bool right = fx1 > fx2;
+				const Precision new_x1 = right ? x2 : x1 - g * (x1 - a);
+				const Precision new_x2 = right ? x2 + g * (c - x2) : x1;
+
+				s.right[l] = right;
+				s.a[l]   = right ? x1 : a;
+				s.c[l]   = right ? c : x2;
+				s.x1[l]  = new_x1;
+				s.x2[l]  = new_x2;
+				s.fx1[l] = right ? fx2 : fx1;
+				s.fx2[l] = right ? fx2 : fx1;
+				s.u[l]   = right ? new_x2 : new_x1;
+			}
+
+			s.evaluate(func);
+		}
+
+		return result;
+	}
+
+	/// golden_section_search_batch performs golden_section_search() on many
+	/// independent problems at once. See the function above for details. This
+	/// version first evaluates <code>func(i, b[i])</code> for each problem.
+	/// @param a The most negative point along the line, for each problem.
+	/// @param b The central point, for each problem.
+	/// @param c The most positive point along the line, for each problem.
+	/// @param func The functor to minimize
+	/// @param maxiterations  Maximum number of iterations
+	/// @param tol Tolerance at which the search should be stopped.
+	/// @return Row <i>i</i> holds the minimum position and value for problem <i>i</i>.
+	/// @ingroup gOptimize
+	template<class Functor, int S, class Precision, class B1, class B2, class B3> Matrix<Dynamic, 2, Precision> golden_section_search_batch(const Vector<S, Precision, B1>& a, const Vector<S, Precision, B2>& b, const Vector<S, Precision, B3>& c, const Functor& func, int maxiterations, Precision tol = std::sqrt(numeric_limits<Precision>::epsilon()))
+	{
+		Vector<S, Precision> fb(b.size());
+		for(int i=0; i < b.size(); i++)
+			fb[i] = func(i, b[i]);
+
+		return golden_section_search_batch(a, b, c, fb, func, maxiterations, tol);
+	}
 }
 #endif
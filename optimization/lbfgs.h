@@ -0,0 +1,337 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_LBFGS_H
+#define TOON_LBFGS_H
+
+#include <TooN/optimization/conjugate_gradient.h>
+#include <cmath>
+#include <limits>
+
+namespace TooN{
+
+/** This class provides a limited memory BFGS (L-BFGS) optimizer. It is used
+in the same way as ConjugateGradient:
+@code
+	LBFGS<2> lbfgs(makeVector(0,0), Rosenbrock, RosenbrockDerivatives);
+
+	while(lbfgs.iterate(Rosenbrock, RosenbrockDerivatives))
+		cout << "y_" << iteration << " = " << lbfgs.y << endl;
+
+	cout << "Optimal value: " << lbfgs.y << endl;
+@endcode
+
+The inverse Hessian is approximated from the last few steps and changes in
+gradient, which are kept in a ring buffer allocated at construction. This
+makes it far more effective than ConjugateGradient on badly conditioned
+problems, while still using only \f$O(mN)\f$ memory.
+
+Each iteration first tries the quasi-Newton step. If that does not satisfy
+the strong Wolfe conditions
+\f[
+	f(\Vec{x} + \alpha\Vec{d}) \le f(\Vec{x}) + c_1\alpha\nabla f\cdot\Vec{d},\quad
+	|\nabla f(\Vec{x} + \alpha\Vec{d})\cdot\Vec{d}| \le c_2 |\nabla f\cdot\Vec{d}|,
+\f]
+then a line search is performed in the same way as ConjugateGradient, by
+bracketing with bracket_minimum_forward() and then using brent_line_search().
+Steps which do not satisfy the curvature condition \f$\Vec{s}\cdot\Vec{y} > 0\f$
+are not added to the history, so the approximation stays positive definite.
+
+@ingroup gOptimize
+*/
+template<int Size=Dynamic, class Precision=double> struct LBFGS
+{
+	const int size;      ///< Dimensionality of the space.
+	const int history;   ///< Number of steps kept to approximate the inverse Hessian.
+	Vector<Size, Precision> g;      ///< Gradient vector at \e x
+	Vector<Size, Precision> d;      ///< Search direction used by the last call to iterate()
+	Vector<Size, Precision> x;      ///< Current position (best known point)
+	Vector<Size, Precision> old_x;  ///< Previous best known point (not set at construction)
+	Precision y;         ///< Function at \f$x\f$
+	Precision old_y;     ///< Function at  old_x
+
+	Precision tolerance; ///< Tolerance used to determine if the optimization is complete. Defaults to square root of machine precision.
+	Precision epsilon;   ///< Additive term in tolerance to prevent excessive iterations if \f$x_\mathrm{optimal} = 0\f$. Defaults to 1e-20
+	int       max_iterations; ///< Maximum number of iterations. Defaults to \c size\f$*100\f$
+
+	Precision wolfe_c1;  ///< Sufficient decrease parameter of the Wolfe conditions, \f$c_1\f$. Defaults to 1e-4.
+	Precision wolfe_c2;  ///< Curvature parameter of the Wolfe conditions, \f$c_2\f$. Defaults to 0.9.
+
+	Precision bracket_initial_lambda;///< Initial stepsize used in bracketing the minimum for the line search. Defaults to 1.
+	Precision linesearch_tolerance; ///< Tolerance used to determine if the linesearch is complete. Defaults to square root of machine precision.
+	Precision linesearch_epsilon; ///< Additive term in tolerance to prevent excessive iterations if \f$x_\mathrm{optimal} = 0\f$. Defaults to 1e-20
+	int linesearch_max_iterations;  ///< Maximum number of iterations in the linesearch. Defaults to 100.
+
+	Precision bracket_epsilon; ///<Minimum size for initial minima bracketing. Below this, it is assumed that the system has converged. Defaults to 1e-20.
+
+	int iterations; ///< Number of iterations performed
+	int linesearches; ///< Number of iterations where the quasi-Newton step was not accepted, so a line search was needed
+
+	///Initialize the LBFGS class with sensible values.
+	///@param start Starting point, \e x
+	///@param func  Function \e f  to compute \f$f(x)\f$
+	///@param deriv  Function to compute \f$\nabla f(x)\f$
+	///@param m  The number of steps to remember
+	template<class Func, class Deriv> LBFGS(const Vector<Size, Precision>& start, const Func& func, const Deriv& deriv, int m=10)
+	: size(start.size()), history(m),
+	  g(size), d(size), x(start), old_x(size),
+	  my_s(m, size), my_y(m, size), my_rho(m), my_alpha(m), my_new_x(size), my_new_g(size)
+	{
+		init(start, func(start), deriv(start));
+	}
+
+	///Initialize the LBFGS class with sensible values.
+	///@param start Starting point, \e x
+	///@param func  \f$f(x)\f$
+	///@param deriv  \f$\nabla f(x)\f$
+	///@param m  The number of steps to remember
+	LBFGS(const Vector<Size, Precision>& start, Precision func, const Vector<Size, Precision>& deriv, int m=10)
+	: size(start.size()), history(m),
+	  g(size), d(size), x(start), old_x(size),
+	  my_s(m, size), my_y(m, size), my_rho(m), my_alpha(m), my_new_x(size), my_new_g(size)
+	{
+		init(start, func, deriv);
+	}
+
+	///Initialize the LBFGS class with sensible values. Used internally.
+	///@param start Starting point, \e x
+	///@param func  \f$f(x)\f$
+	///@param deriv  \f$\nabla f(x)\f$
+	void init(const Vector<Size, Precision>& start, const Precision& func, const Vector<Size, Precision>& deriv)
+	{
+		using std::numeric_limits;
+		using std::sqrt;
+
+		x = start;
+		g = deriv;
+		y = func;
+		old_y = y;
+
+		tolerance = sqrt(numeric_limits<Precision>::epsilon());
+		epsilon = 1e-20;
+		max_iterations = size * 100;
+
+		wolfe_c1 = 1e-4;
+		wolfe_c2 = 0.9;
+
+		bracket_initial_lambda = 1;
+
+		linesearch_tolerance =  sqrt(numeric_limits<Precision>::epsilon());
+		linesearch_epsilon = 1e-20;
+		linesearch_max_iterations=100;
+
+		bracket_epsilon=1e-20;
+
+		iterations=0;
+		linesearches=0;
+
+		clear_history();
+	}
+
+	///Forget the approximation to the inverse Hessian.
+	void clear_history()
+	{
+		my_count = 0;
+		my_newest = -1;
+	}
+
+	///Compute the search direction \e d from the gradient and the history,
+	///using the two loop recursion. You probably do not want to use this
+	///function. See iterate() instead.
+	void compute_direction()
+	{
+		using std::sqrt;
+		d = -g;
+
+		if(my_count == 0)
+		{
+			//With no curvature information, take a unit step downhill.
+			//At a stationary point there is no downhill, so d stays zero.
+			const Precision gg = g*g;
+			if(gg != 0)
+				d /= sqrt(gg);
+			return;
+		}
+
+		int k = my_newest;
+		for(int i=0; i < my_count; i++, k = (k + history - 1) % history)
+		{
+			my_alpha[k] = my_rho[k] * (my_s[k] * d);
+			d -= my_alpha[k] * my_y[k];
+		}
+
+		//Scale by the curvature along the newest step
+		d *= 1 / (my_rho[my_newest] * (my_y[my_newest] * my_y[my_newest]));
+
+		k = (my_newest + history - my_count + 1) % history;
+		for(int i=0; i < my_count; i++, k = (k + 1) % history)
+		{
+			const Precision beta = my_rho[k] * (my_y[k] * d);
+			d += (my_alpha[k] - beta) * my_s[k];
+		}
+	}
+
+	///Find the next point along the search direction, trying the quasi-Newton
+	///step first and then a line search. You probably do not want to use this
+	///function. See iterate() instead.
+	///This function updates:
+	/// - old_x
+	/// - old_y
+	/// - x
+	/// - y
+	/// - g
+	/// - iterations
+	/// - linesearches
+	/// - the history
+	///@param func Functor returning the function value at a given point.
+	///@param deriv Functor to compute derivatives at the specified point.
+	template<class Func, class Deriv> void find_next_point(const Func& func, const Deriv& deriv)
+	{
+		using std::abs;
+
+		Precision slope = g * d;
+		if(!(slope < 0))
+		{
+			//The approximation is not positive definite any more, so start again
+			clear_history();
+			compute_direction();
+			slope = g * d;
+		}
+
+		old_x = x;
+		old_y = y;
+		iterations++;
+
+		//The gradient is zero, so x is a stationary point and finished() is true
+		if(slope == 0)
+			return;
+
+		my_new_x = x + d;
+		Precision new_y = func(my_new_x);
+		bool accepted = false;
+
+		if(new_y <= y + wolfe_c1 * slope)
+		{
+			my_new_g = deriv(my_new_x);
+			accepted = abs(my_new_g * d) <= wolfe_c2 * abs(slope);
+		}
+
+		if(!accepted)
+		{
+			linesearches++;
+			Internal::LineSearch<Size, Precision, Func> line(x, d, func);
+
+			Matrix<3,2,Precision> bracket = Internal::bracket_minimum_forward(y, line, bracket_initial_lambda, bracket_epsilon);
+
+			Precision a = bracket[0][0];
+			Precision b = bracket[1][0];
+			Precision c = bracket[2][0];
+			Precision b_val = bracket[1][1];
+			Precision c_val = bracket[2][1];
+
+			//Local maximum achieved!
+			if(a==0 && b== 0 && c == 0)
+				return;
+
+			Precision step;
+			if(c < b)
+			{
+				//Failed to bracket due to NaN, so c is the best known point.
+				step = c;
+				new_y = c_val;
+			}
+			else
+			{
+				Vector<2, Precision> m = brent_line_search(a, b, c, b_val, line, linesearch_max_iterations, linesearch_tolerance, linesearch_epsilon);
+				step = m[0];
+				new_y = m[1];
+			}
+
+			my_new_x = x + step * d;
+			my_new_g = deriv(my_new_x);
+		}
+
+		//Record the step and change in gradient, if the curvature is positive
+		const Vector<Size, Precision> s = my_new_x - x;
+		const Vector<Size, Precision> dg = my_new_g - g;
+		const Precision sy = s * dg;
+		if(sy > std::numeric_limits<Precision>::epsilon() * (dg * dg))
+		{
+			my_newest = (my_newest + 1) % history;
+			my_s[my_newest] = s;
+			my_y[my_newest] = dg;
+			my_rho[my_newest] = 1 / sy;
+			if(my_count < history)
+				my_count++;
+		}
+
+		x = my_new_x;
+		y = new_y;
+		g = my_new_g;
+	}
+
+	///Check to see it iteration should stop. You probably do not want to use
+	///this function. See iterate() instead. This function updates nothing.
+	bool finished()
+	{
+		using std::abs;
+		return iterations > max_iterations || 2*abs(y - old_y) <= tolerance * (abs(y) + abs(old_y) + epsilon);
+	}
+
+	///Use this function to iterate over the optimization.
+	///This function updates:
+	/// - x
+	/// - old_x
+	/// - y
+	/// - old_y
+	/// - g
+	/// - d
+	/// - iterations
+	/// - the history
+	///@param func Functor returning the function value at a given point.
+	///@param deriv Functor to compute derivatives at the specified point.
+	///@return Whether to continue.
+	template<class Func, class Deriv> bool iterate(const Func& func, const Deriv& deriv)
+	{
+		compute_direction();
+		find_next_point(func, deriv);
+		return !finished();
+	}
+
+	private:
+		Matrix<Dynamic, Size, Precision> my_s;   ///< Ring buffer of steps
+		Matrix<Dynamic, Size, Precision> my_y;   ///< Ring buffer of changes in gradient
+		Vector<Dynamic, Precision> my_rho;       ///< \f$1/\Vec{s}\cdot\Vec{y}\f$ for each step
+		Vector<Dynamic, Precision> my_alpha;     ///< Workspace for the two loop recursion
+		Vector<Size, Precision> my_new_x;        ///< Workspace for the next point
+		Vector<Size, Precision> my_new_g;        ///< Workspace for the gradient at the next point
+		int my_count;                            ///< Number of steps in the history
+		int my_newest;                           ///< Position of the newest step in the history
+};
+
+}
+#endif
@@ -0,0 +1,405 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_LEVENBERG_MARQUARDT_H
+#define TOON_LEVENBERG_MARQUARDT_H
+
+#include <TooN/TooN.h>
+#include <TooN/wls.h>
+#include <TooN/optimization/wall_time.h>
+#include <cmath>
+#include <limits>
+#include <algorithm>
+
+namespace TooN{
+/** This class provides a nonlinear least squares optimizer, using either
+the Levenberg-Marquardt method or Powell's dogleg trust region method. It
+minimizes
+\f[
+	F(\Vec{x}) = \sum_i w_i m_i(\Vec{x})^2,
+\f]
+where \f$m_i\f$ are residuals with Jacobians \f$J_i\f$, using a WLS (or
+anything with the same interface, such as IRLS) to form and solve the normal
+equations. Two functors must be provided:
+ - <code>func(x)</code> returns \f$F(\Vec{x})\f$.
+ - <code>linearize(x, wls)</code> adds each residual to \e wls, with
+   <code>wls.add_mJ(m_i, J_i, w_i)</code> or any of the other add_mJ
+   functions. The residual is the observed value minus the predicted value,
+   and \f$J_i\f$ is the derivative of the predicted value, so that a step
+   \f$\Vec{\delta}\f$ changes the residual to \f$m_i - J_i\Vec{\delta}\f$.
+
+The following code fits \f$y = a e^{bt}\f$ to some data:
+@code
+struct Exponential
+{
+	Vector<> t, y;
+
+	double operator()(const Vector<2>& x) const
+	{
+		return norm_sq(y - x[0] * exp(x[1] * t));
+	}
+
+	void operator()(const Vector<2>& x, WLS<2>& wls) const
+	{
+		for(int i=0; i < t.size(); i++)
+		{
+			double e = exp(x[1] * t[i]);
+			wls.add_mJ(y[i] - x[0] * e, makeVector(e, x[0] * t[i] * e));
+		}
+	}
+};
+
+Exponential f = ...;
+LevenbergMarquardt<2> lm(makeVector(1, 0), f);
+while(lm.iterate(f, f))
+	cout << lm.y << endl;
+@endcode
+
+After each linearization, the inverse covariance accumulated in the WLS is
+kept. When a Levenberg-Marquardt step is rejected, only the damping on the
+diagonal is changed before the next factorization, so the residuals are not
+linearized again. When a dogleg step is rejected, the factorization is
+reused unchanged and only the trust region shrinks.
+
+Counters of function evaluations, linearizations and factorizations, and
+timings of the last iteration, are kept in public members.
+
+@ingroup gOptimize
+*/
+template<int Size=Dynamic, class Precision=double, class System=WLS<Size, Precision> > struct LevenbergMarquardt
+{
+	///The method used to compute steps.
+	enum Method
+	{
+		LM,     ///< Levenberg-Marquardt, with Marquardt's diagonal scaling.
+		Dogleg  ///< Powell's dogleg trust region method.
+	};
+
+	const int size;      ///< Dimensionality of the space.
+	Method method;       ///< Method used to compute steps. Defaults to LM.
+	System system;       ///< The least squares system, linearized at x.
+	Vector<Size, Precision> x;      ///< Current position (best known point)
+	Vector<Size, Precision> old_x;  ///< Previous best known point (not set at construction)
+	Vector<Size, Precision> step;   ///< The most recent step tried
+	Precision y;         ///< Function at \f$x\f$
+	Precision old_y;     ///< Function at old_x
+
+	Precision lambda;    ///< Levenberg-Marquardt damping. If negative, it is set from the diagonal on the first linearization. Defaults to -1.
+	Precision lambda_scale; ///< Initial damping relative to the largest diagonal element. Defaults to 1e-3.
+	Precision radius;    ///< Dogleg trust region radius. Defaults to 1.
+
+	Precision tolerance; ///< Tolerance used to determine if the optimization is complete. Defaults to square root of machine precision.
+	Precision epsilon;   ///< Additive term in tolerance to prevent excessive iterations if \f$x_\mathrm{optimal} = 0\f$. Defaults to 1e-20
+	int max_iterations;  ///< Maximum number of iterations. Defaults to \c size\f$*100\f$
+	int max_rejections;  ///< Maximum number of rejected steps in one iteration before giving up. Defaults to 30.
+
+	int iterations;      ///< Number of accepted steps
+	int rejections;      ///< Total number of rejected steps
+	int evaluations;     ///< Number of calls to \e func
+	int linearizations;  ///< Number of calls to \e linearize
+	int factorizations;  ///< Number of times the normal equations were solved
+
+	double linearize_time;  ///< Time spent linearizing in the last iteration, in seconds
+	double solve_time;      ///< Time spent solving the normal equations in the last iteration, in seconds
+	double evaluate_time;   ///< Time spent evaluating \e func in the last iteration, in seconds
+
+	///Initialize the optimizer with sensible values.
+	///@param start Starting point, \e x
+	///@param func  Function \e f  to compute \f$F(x)\f$
+	template<class Func> LevenbergMarquardt(const Vector<Size, Precision>& start, const Func& func)
+	: size(start.size()), system(size), x(start), old_x(size), step(size),
+	  my_diagonal(size), my_gauss_newton(size), my_linearized(false)
+	{
+		init(start, func(start));
+		evaluations = 1;
+	}
+
+	///Initialize the optimizer with sensible values.
+	///@param start Starting point, \e x
+	///@param func  \f$F(x)\f$
+	LevenbergMarquardt(const Vector<Size, Precision>& start, Precision func)
+	: size(start.size()), system(size), x(start), old_x(size), step(size),
+	  my_diagonal(size), my_gauss_newton(size), my_linearized(false)
+	{
+		init(start, func);
+	}
+
+	///Initialize the LevenbergMarquardt class with sensible values. Used internally.
+	///@param start Starting point, \e x
+	///@param func  \f$F(x)\f$
+	void init(const Vector<Size, Precision>& start, Precision func)
+	{
+		using std::sqrt;
+		using std::numeric_limits;
+
+		x = start;
+		y = func;
+		old_y = y;
+
+		method = LM;
+		lambda = -1;
+		lambda_scale = 1e-3;
+		radius = 1;
+		my_nu = 2;
+
+		tolerance = sqrt(numeric_limits<Precision>::epsilon());
+		epsilon = 1e-20;
+		max_iterations = size * 100;
+		max_rejections = 30;
+
+		iterations = 0;
+		rejections = 0;
+		evaluations = 0;
+		linearizations = 0;
+		factorizations = 0;
+
+		linearize_time = 0;
+		solve_time = 0;
+		evaluate_time = 0;
+
+		my_linearized = false;
+	}
+
+	///Linearize the residuals at \e x. You probably do not want to use
+	///this function. See iterate() instead.
+	///This function updates:
+	/// - system
+	/// - lambda (the first time only, if it is negative)
+	/// - linearizations
+	///@param linearize Functor adding the linearized residuals to a WLS.
+	template<class Linearize> void linearize_at_x(const Linearize& linearize)
+	{
+		const double t = Internal::wall_time();
+
+		system.clear();
+		linearize(x, system);
+		linearizations++;
+
+		//The lower triangle is filled in by system.compute(), so the
+		//diagonal has to be saved before any damping is added.
+		Matrix<Size, Size, Precision>& C = system.get_C_inv();
+		for(int i=0; i < size; i++)
+			my_diagonal[i] = C[i][i];
+
+		if(lambda < 0)
+			lambda = lambda_scale * max_element(my_diagonal).first;
+
+		my_linearized = true;
+		my_have_gauss_newton = false;
+		linearize_time += Internal::wall_time() - t;
+	}
+
+	///Compute the next step to try, and the reduction in \f$F\f$ which
+	///it is predicted to give. You probably do not want to use this function.
+	///See iterate() instead.
+	///This function updates:
+	/// - step
+	/// - factorizations
+	///@return The predicted reduction
+	Precision compute_step()
+	{
+		const double t = Internal::wall_time();
+		const Vector<Size, Precision>& g = system.get_vector();
+		Matrix<Size, Size, Precision>& C = system.get_C_inv();
+		Precision predicted;
+
+		if(method == LM)
+		{
+			//Only the diagonal changes between rejected steps
+			for(int i=0; i < size; i++)
+				C[i][i] = my_diagonal[i] + lambda * damping(i);
+
+			system.compute();
+			factorizations++;
+			step = system.get_mu();
+
+			//With (C + lambda D) step = g, the reduction in the linear model is
+			//2 step.g - step' C step = step.g + lambda step' D step
+			predicted = step * g;
+			for(int i=0; i < size; i++)
+				predicted += lambda * damping(i) * step[i] * step[i];
+		}
+		else
+		{
+			using std::sqrt;
+
+			//The Gauss-Newton step is computed once per linearization
+			if(!my_have_gauss_newton)
+			{
+				for(int i=0; i < size; i++)
+					C[i][i] = my_diagonal[i];
+
+				system.compute();
+				factorizations++;
+				my_gauss_newton = system.get_mu();
+				my_have_gauss_newton = true;
+			}
+
+			//C is now the full, undamped matrix.
+			const Vector<Size, Precision> Cg = C * g;
+			const Precision gg = g * g;
+			const Precision gCg = g * Cg;
+			const Precision gn_norm = norm(my_gauss_newton);
+
+			if(gn_norm <= radius)
+				step = my_gauss_newton;
+			else
+			{
+				//The minimum of the model along the gradient (the Cauchy point)
+				const Vector<Size, Precision> cauchy = g * (gg / gCg);
+				const Precision cauchy_norm = norm(cauchy);
+
+				//A NaN Gauss-Newton step (from a singular system) goes along the gradient
+				if(cauchy_norm >= radius || !(gn_norm < std::numeric_limits<Precision>::max()))
+					step = g * (radius / sqrt(gg));
+				else
+				{
+					//Go from the Cauchy point towards the Gauss-Newton step
+					//as far as the edge of the trust region.
+					const Vector<Size, Precision> d = my_gauss_newton - cauchy;
+					const Precision a = d * d;
+					const Precision b = 2 * (cauchy * d);
+					const Precision c = cauchy * cauchy - radius * radius;
+					const Precision beta = (-b + sqrt(b*b - 4*a*c)) / (2*a);
+					step = cauchy + beta * d;
+				}
+			}
+
+			predicted = 2 * (step * g) - step * (C * step);
+		}
+
+		solve_time += Internal::wall_time() - t;
+		return predicted;
+	}
+
+	///Check to see it iteration should stop. You probably do not want to use
+	///this function. See iterate() instead. This function updates nothing.
+	bool finished()
+	{
+		using std::abs;
+		return iterations > max_iterations || 2*abs(y - old_y) <= tolerance * (abs(y) + abs(old_y) + epsilon);
+	}
+
+	///Use this function to iterate over the optimization. Each call linearizes
+	///the residuals at \e x, and then tries steps until one reduces the
+	///function, adjusting the damping or trust region after each one.
+	///This function updates:
+	/// - x
+	/// - old_x
+	/// - y
+	/// - old_y
+	/// - step
+	/// - lambda or radius
+	/// - all the counters and times
+	///@param func Functor returning the function value at a given point.
+	///@param linearize Functor adding the linearized residuals at a given point to a WLS.
+	///@return Whether to continue.
+	template<class Func, class Linearize> bool iterate(const Func& func, const Linearize& linearize)
+	{
+		using std::abs;
+		using std::max;
+		using std::min;
+
+		linearize_time = 0;
+		solve_time = 0;
+		evaluate_time = 0;
+
+		if(!my_linearized)
+			linearize_at_x(linearize);
+
+		for(int attempt=0; attempt < max_rejections; attempt++)
+		{
+			const Precision predicted = compute_step();
+
+			//The step is too small to make any difference
+			if(norm_inf(step) <= tolerance * (norm_inf(x) + tolerance) || !(predicted > 0))
+				return false;
+
+			const Vector<Size, Precision> new_x = x + step;
+
+			const double t = Internal::wall_time();
+			const Precision new_y = func(new_x);
+			evaluations++;
+			evaluate_time += Internal::wall_time() - t;
+
+			const Precision rho = (y - new_y) / predicted;
+
+			if(rho > 0)
+			{
+				if(method == LM)
+				{
+					lambda *= max(Precision(1)/3, 1 - (2*rho - 1)*(2*rho - 1)*(2*rho - 1));
+					my_nu = 2;
+				}
+				else if(rho > 0.75)
+					radius = max(radius, 3 * norm(step));
+				else if(rho < 0.25)
+					radius /= 2;
+
+				old_x = x;
+				old_y = y;
+				x = new_x;
+				y = new_y;
+				iterations++;
+
+				if(finished())
+					return false;
+
+				linearize_at_x(linearize);
+				return true;
+			}
+
+			rejections++;
+			if(method == LM)
+			{
+				lambda *= my_nu;
+				my_nu *= 2;
+			}
+			else
+				radius = min(radius, norm(step)) / 4;
+		}
+
+		return false;
+	}
+
+	private:
+		Precision damping(int i) const
+		{
+			//Marquardt scaling, kept positive for parameters which the
+			//residuals do not depend on.
+			return std::max(my_diagonal[i], std::numeric_limits<Precision>::epsilon());
+		}
+
+		Vector<Size, Precision> my_diagonal;     ///< Undamped diagonal of the inverse covariance
+		Vector<Size, Precision> my_gauss_newton; ///< Undamped step, used by the dogleg method
+		Precision my_nu;                         ///< Growth factor for lambda after a rejected step
+		bool my_linearized;                      ///< Has the system been linearized at x?
+		bool my_have_gauss_newton;               ///< Has my_gauss_newton been computed at x?
+};
+
+}
+#endif
@@ -0,0 +1,319 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_MULTISTART_H
+#define TOON_MULTISTART_H
+
+#include <TooN/optimization/downhill_simplex.h>
+#include <TooN/optimization/conjugate_gradient.h>
+#include <TooN/optimization/lbfgs.h>
+#include <vector>
+#include <cmath>
+
+namespace TooN{
+
+	namespace Internal{
+		///@internal
+		///@brief Best function value found so far by an optimizer.
+		///@ingroup gInternal
+		template<int N, class Precision, class Observer> Precision multistart_value(const DownhillSimplex<N, Precision, Observer>& o)
+		{
+			return o.get_values()[o.get_best()];
+		}
+
+		///@internal
+		///@brief Best function value found so far by an optimizer.
+		///@ingroup gInternal
+		template<int Size, class Precision, class Observer> Precision multistart_value(const ConjugateGradient<Size, Precision, Observer>& o)
+		{
+			return o.y;
+		}
+
+		///@internal
+		///@brief Best function value found so far by an optimizer.
+		///@ingroup gInternal
+		template<int Size, class Precision> Precision multistart_value(const LBFGS<Size, Precision>& o)
+		{
+			return o.y;
+		}
+	}
+
+/// Statistics for a single run of a MultiStart optimization.
+/// @ingroup gOptimize
+template<class Precision=double> struct MultiStartRun
+{
+	/// State of a run.
+	enum Status
+	{
+		Running,   ///< The run is still being iterated.
+		Finished,  ///< The optimizer's iterate() returned false.
+		Dominated  ///< The run was terminated early by the dominance rule.
+	};
+
+	Status status;           ///< Current state of the run.
+	int iterations;          ///< Number of calls made to the optimizer's iterate().
+	Precision initial_value; ///< Function value when the run was added.
+	Precision value;         ///< Best function value found by the run.
+};
+
+/// The default dominance rule for MultiStart. A running optimization is
+/// terminated if, after #warmup iterations, its value is worse than the best
+/// run by more than \f$\mathrm{relative}\,|f_\mathrm{best}| + \mathrm{absolute}\f$.
+/// @ingroup gOptimize
+template<class Precision=double> struct MultiStartDominance
+{
+	int warmup;         ///< Runs are never terminated before this many iterations. Defaults to 20.
+	Precision relative; ///< Relative margin by which a run must be worse than the best. Defaults to 0.1.
+	Precision absolute; ///< Absolute margin by which a run must be worse than the best. Defaults to 1e-6.
+
+	MultiStartDominance()
+	:warmup(20), relative(0.1), absolute(1e-6)
+	{}
+
+	///@param run  A run which is still going.
+	///@param best The run with the lowest value, which may have finished.
+	///@return Whether to terminate \e run.
+	bool operator()(const MultiStartRun<Precision>& run, const MultiStartRun<Precision>& best) const
+	{
+		using std::abs;
+		return run.iterations >= warmup && run.value - best.value > relative * abs(best.value) + absolute;
+	}
+};
+
+/** This class runs many independent optimizations, for instance from
+different starting points, and keeps track of the best one. It is used in the
+same way as the optimizers which it holds:
+@code
+	MultiStart<DownhillSimplex<2> > ms;
+
+	for(int i=0; i < 64; i++)
+		ms.add(DownhillSimplex<2>(Rosenbrock, starts[i]));
+
+	while(ms.iterate(Rosenbrock))
+		cout << ms.num_active() << " runs remaining" << endl;
+
+	const DownhillSimplex<2>& best = ms.get_optimizer(ms.get_best());
+@endcode
+
+Each call to iterate() calls the iterate() function of every running optimizer
+#steps times. Optimizers which take a function and derivative, such as
+ConjugateGradient and LBFGS, are iterated with iterate(func, deriv). If
+#parallel is set and OpenMP is enabled, the runs are split between threads,
+each of which has its own copy of the functors.
+
+After every call, the dominance rule is applied to each running optimizer
+against the best run, and runs which it rejects are terminated. The rule is a
+functor taking two MultiStartRun structures (see MultiStartDominance, the
+default). A rule which always returns false disables early termination.
+
+The value of each optimizer is obtained with an overload of
+Internal::multistart_value(). These are provided for DownhillSimplex,
+ConjugateGradient and LBFGS.
+
+@ingroup gOptimize
+*/
+template<class Optimizer, class Precision=double, class Rule=MultiStartDominance<Precision> > class MultiStart
+{
+	public:
+		typedef MultiStartRun<Precision> Run;
+
+		MultiStart()
+		:steps(1), parallel(0)
+		{}
+
+		///Add an optimizer. It is copied and will be iterated by subsequent
+		///calls to iterate().
+		///@param o Initialized optimizer.
+		///@return Index of the run.
+		int add(const Optimizer& o)
+		{
+			Run r;
+			r.status = Run::Running;
+			r.iterations = 0;
+			r.initial_value = r.value = Internal::multistart_value(o);
+
+			optimizers.push_back(o);
+			runs.push_back(r);
+
+			return runs.size() - 1;
+		}
+
+		///Iterate all running optimizers which take only a function.
+		///@param func Functor to minimize.
+		///@return Whether any runs are still going.
+		template<class Function> bool iterate(const Function& func)
+		{
+			std::vector<int> active = active_runs();
+			const int n = active.size();
+
+			#ifdef _OPENMP
+			#pragma omp parallel if(parallel)
+			#endif
+			{
+				const Function local_func(func);
+
+				#ifdef _OPENMP
+				#pragma omp for schedule(dynamic)
+				#endif
+				for(int k=0; k < n; k++)
+				{
+					const int i = active[k];
+					for(int s=0; s < steps && runs[i].status == Run::Running; s++)
+					{
+						if(!optimizers[i].iterate(local_func))
+							runs[i].status = Run::Finished;
+						runs[i].iterations++;
+					}
+				}
+			}
+
+			return update();
+		}
+
+		///Iterate all running optimizers which take a function and its derivatives.
+		///@param func Functor to minimize.
+		///@param deriv Functor returning the gradient of \e func.
+		///@return Whether any runs are still going.
+		template<class Function, class Deriv> bool iterate(const Function& func, const Deriv& deriv)
+		{
+			std::vector<int> active = active_runs();
+			const int n = active.size();
+
+			#ifdef _OPENMP
+			#pragma omp parallel if(parallel)
+			#endif
+			{
+				const Function local_func(func);
+				const Deriv local_deriv(deriv);
+
+				#ifdef _OPENMP
+				#pragma omp for schedule(dynamic)
+				#endif
+				for(int k=0; k < n; k++)
+				{
+					const int i = active[k];
+					for(int s=0; s < steps && runs[i].status == Run::Running; s++)
+					{
+						if(!optimizers[i].iterate(local_func, local_deriv))
+							runs[i].status = Run::Finished;
+						runs[i].iterations++;
+					}
+				}
+			}
+
+			return update();
+		}
+
+		///Get the index of the run with the lowest value. Ties go to the
+		///run added first.
+		int get_best() const
+		{
+			int best = 0;
+			for(int i=1; i < num_runs(); i++)
+				if(runs[i].value < runs[best].value)
+					best = i;
+			return best;
+		}
+
+		///Get the optimizer for a given run.
+		///@param i Index of the run.
+		const Optimizer& get_optimizer(int i) const
+		{
+			return optimizers[i];
+		}
+
+		///Get the statistics for a given run.
+		///@param i Index of the run.
+		const Run& get_run(int i) const
+		{
+			return runs[i];
+		}
+
+		///Get the total number of runs.
+		int num_runs() const
+		{
+			return runs.size();
+		}
+
+		///Get the number of runs which are still going.
+		int num_active() const
+		{
+			int n = 0;
+			for(int i=0; i < num_runs(); i++)
+				if(runs[i].status == Run::Running)
+					n++;
+			return n;
+		}
+
+		///Get the total number of optimizer iterations performed by all runs.
+		int total_iterations() const
+		{
+			int n = 0;
+			for(int i=0; i < num_runs(); i++)
+				n += runs[i].iterations;
+			return n;
+		}
+
+		Rule rule;     ///< Rule used to terminate dominated runs.
+		int steps;     ///< Number of optimizer iterations per run for each call to iterate(). Defaults to 1.
+		bool parallel; ///< Split the runs between threads, if OpenMP is enabled. Defaults to false.
+
+	private:
+
+		std::vector<int> active_runs() const
+		{
+			std::vector<int> active;
+			for(int i=0; i < num_runs(); i++)
+				if(runs[i].status == Run::Running)
+					active.push_back(i);
+			return active;
+		}
+
+		//Refresh the values, then terminate dominated runs.
+		bool update()
+		{
+			if(runs.empty())
+				return 0;
+
+			for(int i=0; i < num_runs(); i++)
+				runs[i].value = Internal::multistart_value(optimizers[i]);
+
+			const int best = get_best();
+
+			for(int i=0; i < num_runs(); i++)
+				if(i != best && runs[i].status == Run::Running && rule(runs[i], runs[best]))
+					runs[i].status = Run::Dominated;
+
+			return num_active() != 0;
+		}
+
+		std::vector<Optimizer> optimizers;
+		std::vector<Run> runs;
+};
+
+}
+#endif
@@ -0,0 +1,292 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_OBSERVER_H
+#define TOON_OBSERVER_H
+
+#include <vector>
+#include <ostream>
+#include <cmath>
+#include <TooN/optimization/wall_time.h>
+
+namespace TooN{
+
+/** An observer which ignores all events. This is the default observer for
+the optimizers, and since all of its functions are empty and inline, it has
+no run-time cost.
+
+An observer can be passed to brent_line_search() and golden_section_search(),
+or given as a template parameter to ConjugateGradient and DownhillSimplex, in
+which case it is available as the public member \c observer. Any class with
+the same member functions as NullObserver can be used. The events are:
+- <code>function_evaluations(n)</code>: the function has been evaluated \e n more times.
+- <code>derivative_evaluations(n)</code>: the derivatives have been evaluated \e n more times.
+- <code>bracket_expansions(n)</code>: the bracket of a line search has been expanded \e n more times.
+- <code>iteration(value, step)</code>: an iteration has finished. \e value is the best
+  function value so far, and \e step is the size of the iteration's step. For
+  ConjugateGradient this is the distance moved, for DownhillSimplex the distance
+  between the best and worst vertices, for brent_line_search() the distance from
+  the best point to the new point, and for golden_section_search() the distance
+  between the two inner points.
+
+Events from the line searches performed by ConjugateGradient are passed on to
+its observer, apart from their iterations.
+
+OptimizationTrace records the events, so that they can be written out as CSV
+or JSON.
+@ingroup gOptimize
+*/
+struct NullObserver
+{
+	void function_evaluations(int) {}
+	void derivative_evaluations(int) {}
+	void bracket_expansions(int) {}
+	template<class Precision> void iteration(Precision, Precision) {}
+};
+
+namespace Internal{
+	///@internal
+	///@brief Wrap a function, and tell an observer each time it is evaluated.
+	///@ingroup gInternal
+	template<class Func, class Precision, class Observer> struct ObservedFunction
+	{
+		ObservedFunction(const Func& f_, Observer& o)
+		:f(f_), observer(o)
+		{}
+
+		const Func& f;
+		Observer& observer;
+
+		template<class X> Precision operator()(const X& x) const
+		{
+			observer.function_evaluations(1);
+			return f(x);
+		}
+	};
+
+	///@internal
+	///@brief Pass on the events from a line search to the observer of the
+	///enclosing optimizer, apart from the iterations.
+	///@ingroup gInternal
+	template<class Observer> struct LineSearchObserver
+	{
+		LineSearchObserver(Observer& o)
+		:observer(o)
+		{}
+
+		Observer& observer;
+
+		void function_evaluations(int n)
+		{
+			observer.function_evaluations(n);
+		}
+
+		void derivative_evaluations(int n)
+		{
+			observer.derivative_evaluations(n);
+		}
+
+		void bracket_expansions(int n)
+		{
+			observer.bracket_expansions(n);
+		}
+
+		template<class Precision> void iteration(Precision, Precision)
+		{}
+	};
+
+	///@internal
+	///@brief Whether an observer uses the events. This is used to skip
+	///computing event data which is not free, such as step sizes.
+	///@ingroup gInternal
+	template<class Observer> struct ObserverIsActive
+	{
+		static const bool value = true;
+	};
+
+	template<> struct ObserverIsActive<NullObserver>
+	{
+		static const bool value = false;
+	};
+}
+
+/** An observer which records a trace of an optimization. One record is made
+per iteration, holding the total number of evaluations so far, the value and
+step size, and the wall time since the trace was started. See NullObserver
+for details of the events.
+
+@code
+	ConjugateGradient<2, double, OptimizationTrace<> > cg(makeVector(0,0), Rosenbrock, RosenbrockDerivatives);
+
+	while(cg.iterate(Rosenbrock, RosenbrockDerivatives))
+	{}
+
+	cg.observer.write_csv(cout);
+@endcode
+@ingroup gOptimize
+*/
+template<class Precision=double> class OptimizationTrace
+{
+	public:
+		/// The state after one iteration.
+		struct Record
+		{
+			int iteration;              ///< Number of the iteration, counting from 1.
+			int function_evaluations;   ///< Total function evaluations so far.
+			int derivative_evaluations; ///< Total derivative evaluations so far.
+			int bracket_expansions;     ///< Total line search bracket expansions so far.
+			Precision value;            ///< Best function value so far.
+			Precision step;             ///< Step size of this iteration.
+			double time;                ///< Wall time since the start of the trace, in seconds.
+		};
+
+		OptimizationTrace()
+		{
+			clear();
+		}
+
+		///Remove all records, reset the counts, and restart the clock.
+		void clear()
+		{
+			records.clear();
+			function_count = 0;
+			derivative_count = 0;
+			expansion_count = 0;
+			start = Internal::wall_time();
+		}
+
+		void function_evaluations(int n)
+		{
+			function_count += n;
+		}
+
+		void derivative_evaluations(int n)
+		{
+			derivative_count += n;
+		}
+
+		void bracket_expansions(int n)
+		{
+			expansion_count += n;
+		}
+
+		void iteration(Precision value, Precision step)
+		{
+			Record r;
+			r.iteration = records.size() + 1;
+			r.function_evaluations = function_count;
+			r.derivative_evaluations = derivative_count;
+			r.bracket_expansions = expansion_count;
+			r.value = value;
+			r.step = step;
+			r.time = Internal::wall_time() - start;
+			records.push_back(r);
+		}
+
+		///Get the recorded iterations.
+		const std::vector<Record>& get_records() const
+		{
+			return records;
+		}
+
+		///Get the total number of function evaluations.
+		int get_function_evaluations() const
+		{
+			return function_count;
+		}
+
+		///Get the total number of derivative evaluations.
+		int get_derivative_evaluations() const
+		{
+			return derivative_count;
+		}
+
+		///Get the total number of line search bracket expansions.
+		int get_bracket_expansions() const
+		{
+			return expansion_count;
+		}
+
+		///Write the records as CSV, with a header line. Numbers are written
+		///using the precision of the stream.
+		///@param o Stream to write to.
+		void write_csv(std::ostream& o) const
+		{
+			o << "iteration,function_evaluations,derivative_evaluations,bracket_expansions,value,step,time\n";
+			for(unsigned int i=0; i < records.size(); i++)
+			{
+				const Record& r = records[i];
+				o << r.iteration << "," << r.function_evaluations << "," << r.derivative_evaluations << ","
+				  << r.bracket_expansions << "," << r.value << "," << r.step << "," << r.time << "\n";
+			}
+		}
+
+		///Write the records as a JSON array of objects. Numbers are written
+		///using the precision of the stream, and values which are not finite
+		///are written as null.
+		///@param o Stream to write to.
+		void write_json(std::ostream& o) const
+		{
+			o << "[";
+			for(unsigned int i=0; i < records.size(); i++)
+			{
+				const Record& r = records[i];
+				o << (i ? ",\n " : "\n ");
+				o << "{\"iteration\": " << r.iteration
+				  << ", \"function_evaluations\": " << r.function_evaluations
+				  << ", \"derivative_evaluations\": " << r.derivative_evaluations
+				  << ", \"bracket_expansions\": " << r.bracket_expansions
+				  << ", \"value\": ";
+				write_json_number(o, r.value);
+				o << ", \"step\": ";
+				write_json_number(o, r.step);
+				o << ", \"time\": ";
+				write_json_number(o, r.time);
+				o << "}";
+			}
+			o << "\n]\n";
+		}
+
+	private:
+
+		template<class P> static void write_json_number(std::ostream& o, P x)
+		{
+			if(std::isfinite(x))
+				o << x;
+			else
+				o << "null";
+		}
+
+		std::vector<Record> records;
+		int function_count;
+		int derivative_count;
+		int expansion_count;
+		double start;
+};
+
+}
+#endif
@@ -0,0 +1,59 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_WALL_TIME_H
+#define TOON_WALL_TIME_H
+
+#ifdef WIN32
+#include <ctime>
+#else
+#include <sys/time.h>
+#endif
+
+namespace TooN{
+namespace Internal{
+
+	///@internal
+	///@brief Wall clock time in seconds, used to time the optimizers.
+	///The Microsoft C runtime's clock() measures wall time, unlike the
+	///POSIX one, so it is used on Windows.
+	///@ingroup gInternal
+	inline double wall_time()
+	{
+		#ifdef WIN32
+			return std::clock() * 1.0 / CLOCKS_PER_SEC;
+		#else
+			struct timeval tv;
+			gettimeofday(&tv, 0);
+			return tv.tv_sec + tv.tv_usec * 1e-6;
+		#endif
+	}
+
+}
+}
+
+#endif
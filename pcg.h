@@ -0,0 +1,411 @@
+// -*- c++ -*-
+
+// Copyright (C) TooN contributors
+
+//All rights reserved.
+//
+//Redistribution and use in source and binary forms, with or without
+//modification, are permitted provided that the following conditions
+//are met:
+//1. Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//2. Redistributions in binary form must reproduce the above copyright
+//   notice, this list of conditions and the following disclaimer in the
+//   documentation and/or other materials provided with the distribution.
+//
+//THIS SOFTWARE IS PROVIDED BY THE AUTHOR AND OTHER CONTRIBUTORS ``AS IS''
+//AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+//IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE
+//ARE DISCLAIMED.  IN NO EVENT SHALL THE AUTHOR OR OTHER CONTRIBUTORS BE
+//LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR
+//CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF
+//SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+//INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+//CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE)
+//ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+//POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef TOON_INCLUDE_PCG_H
+#define TOON_INCLUDE_PCG_H
+
+#include <TooN/TooN.h>
+#include <TooN/Cholesky.h>
+#include <TooN/SparseMatrix.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+namespace TooN {
+
+namespace Internal
+{
+	///@internal
+	///@brief Compute y = A*x for the operators used by PCG.
+	///Anything which provides <code>A * x</code> can be used. This is
+	///overloaded for types which can write the result directly in to \e y.
+	///@ingroup gInternal
+	template<class Op, class Precision>
+	void pcg_multiply(const Op& A, const Vector<Dynamic, Precision>& x, Vector<Dynamic, Precision>& y)
+	{
+		y = A * x;
+	}
+
+	template<class Precision, class Layout>
+	void pcg_multiply(const SparseMatrix<Precision, Layout>& A, const Vector<Dynamic, Precision>& x, Vector<Dynamic, Precision>& y)
+	{
+		A.multiply(x, y);
+	}
+}
+
+/// A preconditioner which does nothing, for use with PCG.
+/// @ingroup gEquations
+template<class Precision=DefaultPrecision>
+struct IdentityPreconditioner
+{
+	///Compute \f$\underline{z} = M^{-1}\underline{r}\f$.
+	void apply(const Vector<Dynamic, Precision>& r, Vector<Dynamic, Precision>& z) const
+	{
+		z = r;
+	}
+};
+
+/// The Jacobi (diagonal) preconditioner, for use with PCG.
+/// @ingroup gEquations
+template<class Precision=DefaultPrecision>
+class JacobiPreconditioner
+{
+public:
+	///Construct from the diagonal of the matrix.
+	template<int S, class B>
+	explicit JacobiPreconditioner(const Vector<S, Precision, B>& diagonal)
+	:my_inverse(diagonal.size())
+	{
+		for(int i=0; i < diagonal.size(); i++)
+			my_inverse[i] = 1 / diagonal[i];
+	}
+
+	///Construct from a dense matrix.
+	template<int R, int C, class B>
+	explicit JacobiPreconditioner(const Matrix<R, C, Precision, B>& m)
+	:my_inverse(m.num_rows())
+	{
+		for(int i=0; i < m.num_rows(); i++)
+			my_inverse[i] = 1 / m[i][i];
+	}
+
+	///Construct from a sparse matrix.
+	template<class Layout>
+	explicit JacobiPreconditioner(const SparseMatrix<Precision, Layout>& m)
+	:my_inverse(m.num_rows())
+	{
+		my_inverse = Zeros;
+		for(int i=0; i < m.num_rows(); i++)
+			for(int p=m.get_offsets()[i]; p < m.get_offsets()[i+1]; p++)
+				if(m.get_indices()[p] == i)
+					my_inverse[i] = 1 / m.get_values()[p];
+	}
+
+	///Compute \f$\underline{z} = M^{-1}\underline{r}\f$.
+	void apply(const Vector<Dynamic, Precision>& r, Vector<Dynamic, Precision>& z) const
+	{
+		for(int i=0; i < r.size(); i++)
+			z[i] = r[i] * my_inverse[i];
+	}
+
+private:
+	Vector<Dynamic, Precision> my_inverse;
+};
+
+/// The block Jacobi preconditioner, for use with PCG. The diagonal
+/// blocks of size BlockSize are inverted, which suits problems such as pose
+/// graphs where the parameters come in small, strongly coupled groups.
+/// @param BlockSize The size of the blocks. The matrix size must be a multiple of this.
+/// @ingroup gEquations
+template<int BlockSize, class Precision=DefaultPrecision>
+class BlockJacobiPreconditioner
+{
+public:
+	///Construct from a dense matrix.
+	template<int R, int C, class B>
+	explicit BlockJacobiPreconditioner(const Matrix<R, C, Precision, B>& m)
+	:my_inverse(m.num_rows() / BlockSize)
+	{
+		for(size_t b=0; b < my_inverse.size(); b++)
+			invert(b, m.template slice<Dynamic, Dynamic, BlockSize, BlockSize>(b*BlockSize, b*BlockSize, BlockSize, BlockSize));
+	}
+
+	///Construct from a sparse matrix.
+	template<class Layout>
+	explicit BlockJacobiPreconditioner(const SparseMatrix<Precision, Layout>& m)
+	:my_inverse(m.num_rows() / BlockSize)
+	{
+		std::vector<Matrix<BlockSize, BlockSize, Precision> > blocks(my_inverse.size(), Zeros);
+		for(int i=0; i < m.num_rows(); i++)
+			for(int p=m.get_offsets()[i]; p < m.get_offsets()[i+1]; p++)
+			{
+				const int j = m.get_indices()[p];
+				if(i / BlockSize == j / BlockSize)
+					blocks[i / BlockSize](i % BlockSize, j % BlockSize) = m.get_values()[p];
+			}
+
+		for(size_t b=0; b < my_inverse.size(); b++)
+			invert(b, blocks[b]);
+	}
+
+	///Compute \f$\underline{z} = M^{-1}\underline{r}\f$.
+	void apply(const Vector<Dynamic, Precision>& r, Vector<Dynamic, Precision>& z) const
+	{
+		for(size_t b=0; b < my_inverse.size(); b++)
+			z.template slice<Dynamic, BlockSize>(b*BlockSize, BlockSize) = my_inverse[b] * r.template slice<Dynamic, BlockSize>(b*BlockSize, BlockSize);
+	}
+
+private:
+	template<class P2, class B>
+	void invert(int b, const Matrix<BlockSize, BlockSize, P2, B>& m)
+	{
+		Cholesky<BlockSize, Precision> chol(m);
+		my_inverse[b] = chol.get_inverse();
+	}
+
+	std::vector<Matrix<BlockSize, BlockSize, Precision> > my_inverse;
+};
+
+/// The incomplete Cholesky preconditioner with no fill in, IC(0), for use
+/// with PCG. The factor has the same sparsity pattern as the lower
+/// triangle of the matrix. If the factorization breaks down, which can
+/// happen for matrices which are not diagonally dominant, it is repeated
+/// with an increasing shift added to the diagonal.
+/// @ingroup gEquations
+template<class Precision=DefaultPrecision>
+class IncompleteCholeskyPreconditioner
+{
+public:
+	///Construct from a sparse symmetric matrix, with both triangles stored.
+	template<class Layout>
+	explicit IncompleteCholeskyPreconditioner(const SparseMatrix<Precision, Layout>& m)
+	:my_shift(0)
+	{
+		SizeMismatch<Dynamic, Dynamic>::test(m.num_rows(), m.num_cols());
+
+		//The lower triangle by rows. For a symmetric matrix, this is the
+		//same as the upper triangle by columns, so either layout can be used.
+		const int n = m.num_rows();
+		my_offsets.assign(1, 0);
+		Precision max_diagonal = 0;
+		for(int i=0; i < n; i++)
+		{
+			for(int p=m.get_offsets()[i]; p < m.get_offsets()[i+1]; p++)
+				if(m.get_indices()[p] <= i)
+				{
+					my_indices.push_back(m.get_indices()[p]);
+					my_values.push_back(m.get_values()[p]);
+				}
+			my_offsets.push_back(my_indices.size());
+
+			//The last element of each row must be the diagonal
+			if(my_indices.empty() || my_indices.back() != i)
+			{
+				my_indices.push_back(i);
+				my_values.push_back(0);
+				my_offsets.back()++;
+			}
+			max_diagonal = std::max(max_diagonal, my_values.back());
+		}
+
+		const std::vector<Precision> original = my_values;
+		for(Precision shift = max_diagonal > 0 ? 1e-3 * max_diagonal : 1; !factorize(); shift *= 2)
+		{
+			my_values = original;
+			my_shift = shift;
+			for(int i=0; i < n; i++)
+				my_values[my_offsets[i+1]-1] += shift;
+		}
+	}
+
+	///The shift which was added to the diagonal so that the factorization succeeded.
+	Precision get_shift() const { return my_shift; }
+
+	///Compute \f$\underline{z} = M^{-1}\underline{r}\f$, by solving with \f$L\f$ and then \f$L^{\mathsf T}\f$.
+	void apply(const Vector<Dynamic, Precision>& r, Vector<Dynamic, Precision>& z) const
+	{
+		const int n = r.size();
+		for(int i=0; i < n; i++)
+		{
+			Precision val = r[i];
+			const int diag = my_offsets[i+1]-1;
+			for(int p=my_offsets[i]; p < diag; p++)
+				val -= my_values[p] * z[my_indices[p]];
+			z[i] = val / my_values[diag];
+		}
+
+		for(int i=n-1; i >= 0; i--)
+		{
+			const int diag = my_offsets[i+1]-1;
+			z[i] /= my_values[diag];
+			for(int p=my_offsets[i]; p < diag; p++)
+				z[my_indices[p]] -= my_values[p] * z[i];
+		}
+	}
+
+private:
+	bool factorize()
+	{
+		using std::sqrt;
+		const int n = my_offsets.size() - 1;
+		for(int i=0; i < n; i++)
+		{
+			const int diag = my_offsets[i+1]-1;
+			for(int p=my_offsets[i]; p <= diag; p++)
+			{
+				const int k = my_indices[p];
+
+				//Dot product of the parts of rows i and k before column k
+				Precision val = my_values[p];
+				int a = my_offsets[i], b = my_offsets[k];
+				const int b_end = my_offsets[k+1]-1;
+				while(a < p && b < b_end)
+				{
+					if(my_indices[a] < my_indices[b])
+						a++;
+					else if(my_indices[a] > my_indices[b])
+						b++;
+					else
+						val -= my_values[a++] * my_values[b++];
+				}
+
+				if(k < i)
+					my_values[p] = val / my_values[b_end];
+				else if(val > 0)
+					my_values[p] = sqrt(val);
+				else
+					return false;
+			}
+		}
+		return true;
+	}
+
+	std::vector<int> my_offsets;
+	std::vector<int> my_indices;
+	std::vector<Precision> my_values;
+	Precision my_shift;
+};
+
+/**
+Solves \f$A\underline{x} = \underline{b}\f$ for a large symmetric positive
+definite \f$A\f$ using the preconditioned (linear) conjugate gradient method.
+
+\f$A\f$ is only used through products <code>A * x</code>, so it can be a
+Matrix, a SparseMatrix, or any class which provides that operator for a
+<code>Vector<></code>, such as one which computes \f$J^{\mathsf T}J\underline{x}\f$
+without forming \f$J^{\mathsf T}J\f$. The preconditioner can be any class with a
+member <code>apply(r, z)</code> which computes \f$\underline{z} = M^{-1}\underline{r}\f$,
+such as JacobiPreconditioner, BlockJacobiPreconditioner or
+IncompleteCholeskyPreconditioner.
+
+All the working vectors are allocated when the class is constructed, so
+solving does not allocate memory, provided that the products do not (which
+is the case for Matrix and SparseMatrix).
+@code
+	SparseMatrix<> A = ...;
+	PCG<> pcg(A.num_rows());
+	pcg.tolerance = 1e-8;
+	Vector<> x = Zeros(A.num_rows());  //Or the previous solution, as a warm start
+	pcg.solve(A, b, x, JacobiPreconditioner<>(A));
+@endcode
+
+@param Precision The numerical precision used
+@ingroup gEquations
+**/
+template<class Precision=DefaultPrecision>
+class PCG
+{
+public:
+	///Construct with the size of the system.
+	PCG(int size)
+	:r(size), z(size), p(size), Ap(size)
+	{
+		tolerance = std::sqrt(numeric_limits<Precision>::epsilon());
+		max_iterations = size;
+		iterations = 0;
+		residual_norm = 0;
+	}
+
+	///Solve the system. The iterations stop when \f$|A\underline{x} - \underline{b}| \le \text{tolerance}\,|\underline{b}|\f$,
+	///or after max_iterations.
+	///@param A The matrix or operator
+	///@param b The right hand side
+	///@param x The initial estimate, which is replaced by the solution
+	///@param M The preconditioner
+	///@return Whether the solution converged
+	template<class Op, class Preconditioner>
+	bool solve(const Op& A, const Vector<Dynamic, Precision>& b, Vector<Dynamic, Precision>& x, const Preconditioner& M)
+	{
+		using std::sqrt;
+		const int n = b.size();
+		SizeMismatch<Dynamic, Dynamic>::test(r.size(), n);
+		SizeMismatch<Dynamic, Dynamic>::test(r.size(), x.size());
+
+		const Precision stop = tolerance * norm(b);
+
+		Internal::pcg_multiply(A, x, Ap);
+		for(int i=0; i < n; i++)
+			r[i] = b[i] - Ap[i];
+
+		residual_norm = norm(r);
+		iterations = 0;
+		if(residual_norm <= stop)
+			return true;
+
+		M.apply(r, z);
+		p = z;
+		Precision rz = r * z;
+
+		while(iterations < max_iterations)
+		{
+			Internal::pcg_multiply(A, p, Ap);
+			const Precision alpha = rz / (p * Ap);
+			for(int i=0; i < n; i++)
+			{
+				x[i] += alpha * p[i];
+				r[i] -= alpha * Ap[i];
+			}
+			iterations++;
+
+			residual_norm = norm(r);
+			if(residual_norm <= stop)
+				return true;
+
+			M.apply(r, z);
+			const Precision rz_new = r * z;
+			const Precision beta = rz_new / rz;
+			rz = rz_new;
+			for(int i=0; i < n; i++)
+				p[i] = z[i] + beta * p[i];
+		}
+
+		return false;
+	}
+
+	///Solve the system without a preconditioner.
+	///@param A The matrix or operator
+	///@param b The right hand side
+	///@param x The initial estimate, which is replaced by the solution
+	///@return Whether the solution converged
+	template<class Op>
+	bool solve(const Op& A, const Vector<Dynamic, Precision>& b, Vector<Dynamic, Precision>& x)
+	{
+		return solve(A, b, x, IdentityPreconditioner<Precision>());
+	}
+
+	Precision tolerance; ///< Relative tolerance on the residual. Defaults to the square root of machine precision.
+	int max_iterations;  ///< Maximum number of iterations. Defaults to the size of the system.
+	int iterations;      ///< Number of iterations used by the last call to solve()
+	Precision residual_norm; ///< Norm of the residual \f$A\underline{x} - \underline{b}\f$ at the end of the last solve().
+
+private:
+	Vector<Dynamic, Precision> r, z, p, Ap;
+};
+
+}
+
+#endif
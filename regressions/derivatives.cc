@@ -0,0 +1,163 @@
+#include "regressions/regression.h"
+#include <TooN/functions/derivatives.h>
+using namespace TooN;
+using namespace std;
+
+//A function with nonzero cross derivatives, and a count of evaluations
+//which is copied along with the functor.
+struct Function
+{
+	mutable int evaluations;
+
+	Function()
+	:evaluations(0)
+	{}
+
+	double operator()(const Vector<>& x) const
+	{
+		evaluations++;
+		double f = 0;
+		for(int i=0; i < x.size(); i++)
+			f += sin(x[i]) * exp(0.1 * i * x[(i+1) % x.size()]);
+		return f;
+	}
+};
+
+//The same function, templated on the precision so that it can be evaluated
+//with complex numbers.
+struct Templated
+{
+	template<class P> P operator()(const Vector<Dynamic, P>& x) const
+	{
+		P f = 0;
+		for(int i=0; i < x.size(); i++)
+			f += sin(x[i]) * exp(0.1 * i * x[(i+1) % x.size()]);
+		return f;
+	}
+};
+
+Vector<> gradient(const Vector<>& x)
+{
+	const int n = x.size();
+	Vector<> g = Zeros(n);
+	for(int i=0; i < n; i++)
+	{
+		const int j = (i+1) % n;
+		const double e = exp(0.1 * i * x[j]);
+		g[i] += cos(x[i]) * e;
+		g[j] += sin(x[i]) * 0.1 * i * e;
+	}
+	return g;
+}
+
+//Residuals with a tridiagonal Jacobian
+struct Residuals
+{
+	mutable int evaluations;
+
+	Residuals()
+	:evaluations(0)
+	{}
+
+	Vector<> operator()(const Vector<>& x) const
+	{
+		evaluations++;
+		const int n = x.size();
+		Vector<> r(n);
+		for(int i=0; i < n; i++)
+			r[i] = x[i] * x[i] - x[(i+n-1)%n] * (i > 0) * x[(i+1)%n] * (i < n-1) + sin(x[i]);
+		return r;
+	}
+};
+
+int main()
+{
+	Vector<> x(6);
+	for(int i=0; i < x.size(); i++)
+		x[i] = 0.3 * i - 0.7;
+
+	Function f;
+
+	Vector<> g = numerical_gradient(f, x);
+	Vector<> gp = numerical_gradient_parallel(f, x);
+	cout << g << endl;
+	cout << norm_inf(g - gp) << endl;
+
+	Matrix<> ge = numerical_gradient_with_errors(f, x);
+	Matrix<> gep = numerical_gradient_with_errors_parallel(f, x);
+	cout << norm_fro(ge - gep) << endl;
+
+	Matrix<> h = numerical_hessian(f, x);
+	Matrix<> hp = numerical_hessian_parallel(f, x);
+	cout << h << endl;
+	cout << norm_fro(h - hp) << endl;
+
+	pair<Matrix<>, Matrix<> > he = numerical_hessian_with_errors(f, x);
+	pair<Matrix<>, Matrix<> > hep = numerical_hessian_with_errors_parallel(f, x);
+	cout << norm_fro(he.first - hep.first) << " " << norm_fro(he.second - hep.second) << endl;
+
+	//Computing both together gives the same answer with fewer evaluations
+	f.evaluations = 0;
+	numerical_gradient(f, x);
+	numerical_hessian(f, x);
+	int separate = f.evaluations;
+
+	f.evaluations = 0;
+	pair<Vector<>, Matrix<> > gh = numerical_gradient_and_hessian(f, x);
+	cout << norm_inf(gh.first - g) << " " << norm_fro(gh.second - h) << " " << (f.evaluations < separate) << endl;
+
+	pair<Matrix<>, pair<Matrix<>, Matrix<> > > ghe = numerical_gradient_and_hessian_with_errors(f, x);
+	cout << norm_fro(ghe.first - ge) << " " << norm_fro(ghe.second.first - he.first) << " " << norm_fro(ghe.second.second - he.second) << endl;
+
+	//The fast modes
+	Vector<> exact = gradient(x);
+	cout << (norm_inf(g - exact) < 1e-10) << endl;
+	cout << (norm_inf(numerical_gradient_central(f, x) - exact) < 1e-9) << endl;
+	cout << (norm_inf(numerical_gradient_central(f, x, 1e-4) - exact) < 1e-6) << endl;
+	cout << (norm_inf(numerical_gradient_complex_step(Templated(), x) - exact) < 1e-15) << endl;
+
+	//Sparse Jacobians
+	{
+		const int n = 20;
+		Vector<> y(n);
+		for(int i=0; i < n; i++)
+			y[i] = 0.1 * i - 0.5;
+
+		SparseMatrix<> pattern(n, n);
+		for(int i=0; i < n; i++)
+			for(int j=max(i-1, 0); j <= min(i+1, n-1); j++)
+				pattern.add(i, j, 1);
+		pattern.compress();
+
+		vector<int> colours = column_colouring(pattern);
+		cout << *max_element(colours.begin(), colours.end()) + 1 << endl;
+
+		Residuals r;
+		Matrix<> J = numerical_jacobian(r, y);
+		cout << r.evaluations << endl;
+
+		r.evaluations = 0;
+		SparseMatrix<> Js = numerical_jacobian(r, y, pattern, colours);
+		cout << r.evaluations << " " << Js.num_nonzeros() << " " << norm_fro(Js.get_matrix() - J) << endl;
+
+		SparseMatrix<double, ColMajor> Jc = numerical_jacobian(r, y, SparseMatrix<double, ColMajor>(pattern));
+		cout << norm_fro(Jc.get_matrix() - J) << endl;
+
+		Matrix<> exact = Zeros(n);
+		for(int i=0; i < n; i++)
+		{
+			exact[i][i] = 2 * y[i] + cos(y[i]);
+			if(i > 0 && i < n-1)
+			{
+				exact[i][i-1] = -y[i+1];
+				exact[i][i+1] = -y[i-1];
+			}
+		}
+		cout << (norm_fro(J - exact) < 1e-8) << endl;
+	}
+
+	//The parallel versions only evaluate copies of the functor
+	int evaluations = f.evaluations;
+	numerical_hessian_parallel(f, x);
+	cout << (evaluations > 0) << " " << (f.evaluations == evaluations) << endl;
+}
@@ -0,0 +1,64 @@
+#include "regressions/regression.h"
+#include <TooN/functions/dual.h>
+#include <TooN/functions/derivatives.h>
+using namespace TooN;
+using namespace std;
+
+template<class P> P f(const Vector<3, P>& x)
+{
+	using std::sin;
+	using std::exp;
+	using std::sqrt;
+	using std::atan2;
+	return sin(x[0]) * exp(x[1] / x[2]) + sqrt(x * x) - atan2(x[1], x[0]) + 2.0 / x[2];
+}
+
+struct F
+{
+	double operator()(const Vector<3>& x) const
+	{
+		return f(x);
+	}
+};
+
+int main()
+{
+	Vector<3> x = makeVector(0.3, -0.5, 1.2);
+
+	//Gradient of a scalar function
+	Dual<double, 3> y = f(make_dual_vector<3>(x));
+	cout << y << " " << f(x) << endl;
+	cout << get_gradient(y) << endl;
+	cout << (norm_inf(get_gradient(y) - numerical_gradient(F(), x)) < 1e-8) << endl;
+
+	//Jacobian of Matrix and Vector operations, mixing Dual and double
+	Matrix<2, 3> A = Data(1, 2, 3, 4, 5, 6);
+	Vector<3, Dual<double, 3> > xd = make_dual_vector<3>(x);
+	Vector<2, Dual<double, 3> > Ax = A * xd + makeVector(1.0, 2.0);
+	cout << get_value(Ax) << endl;
+	cout << get_jacobian(Ax) << endl;
+
+	Vector<3, Dual<double, 3> > xx = xd * (xd * xd);
+	Matrix<3> dxx = x.as_col() * x.as_row() * 2;
+	for(int i=0; i < 3; i++)
+		dxx[i][i] += x * x;
+	cout << norm_fro(get_jacobian(xx) - dxx) << endl;
+
+	//Derivatives of a transformed point with respect to a small motion
+	SE3<> T = SE3<>::exp(makeVector(0.1, -0.2, 0.3, 0.4, 0.5, -0.6));
+	Vector<3> p = makeVector(1, 2, 3);
+
+	Vector<3, Dual<double, 6> > q = make_left_dual_se3<6>(T) * p;
+	Matrix<3, 6> J = get_jacobian(q);
+	Vector<4> Tp = unproject(T * p);
+	double err = 0;
+	for(int i=0; i < 6; i++)
+		err = max(err, norm_inf(J.T()[i] - SE3<>::generator_field(i, Tp).slice<0,3>()));
+	cout << norm_inf(get_value(q) - T * p) << " " << err << endl;
+
+	//The same for SO3
+	Vector<3, Dual<double, 3> > r = make_left_dual_so3<3>(T.get_rotation()) * p;
+	Vector<3> Rp = T.get_rotation() * p;
+	Matrix<3> dRp = Data(0, Rp[2], -Rp[1], -Rp[2], 0, Rp[0], Rp[1], -Rp[0], 0);
+	cout << norm_fro(get_jacobian(r) - dRp) << endl;
+}
@@ -0,0 +1,140 @@
+#include "regressions/regression.h"
+#include <TooN/LU.h>
+#include <TooN/Cholesky.h>
+#include <TooN/Lapack_Cholesky.h>
+#include <TooN/SVD.h>
+#include <TooN/QR_Lapack.h>
+using namespace TooN;
+using namespace std;
+
+Matrix<> random_matrix(int rows, int cols)
+{
+	Matrix<> m(rows, cols);
+	for(int r=0; r < rows; r++)
+		for(int c=0; c < cols; c++)
+			m[r][c] = xor128d();
+	return m;
+}
+
+//Decompositions computed in place must give exactly the same
+//results as the ones which copy the matrix.
+void test_square()
+{
+	double lu=0, chol=0, lchol=0, svd=0;
+	for(int i=0; i < 50; i++)
+	{
+		int n = xor128u() % 30 + 1;
+		Matrix<> m = random_matrix(n, n);
+		Matrix<> s = m * m.T() + Identity(n);
+		Vector<> b = random_matrix(n, 1).T()[0];
+
+		{
+			LU<> a(m), c(n);
+			Matrix<> t = m;
+			c.compute_in_place(t);
+			lu = max(lu, norm(a.backsub(b) - c.backsub(b)));
+			lu = max(lu, norm_fro(t - a.get_lu()));
+		}
+
+		{
+			Cholesky<> a(s), c(n);
+			Matrix<> t = s;
+			c.compute_in_place(wrapMatrix(t.my_data, n, n));
+			chol = max(chol, norm(a.backsub(b) - c.backsub(b)));
+		}
+
+		{
+			Lapack_Cholesky<Dynamic> a(s), c(n);
+			Matrix<> t = s;
+			c.compute_in_place(t);
+			lchol = max(lchol, norm(a.backsub(b) - c.backsub(b)));
+			lchol = max(lchol, norm_fro(a.get_L() - c.get_L()));
+		}
+
+		{
+			SVD<> a(m), c(n, n);
+			Matrix<> t = m;
+			c.compute_in_place(t);
+			svd = max(svd, norm(a.backsub(b) - c.backsub(b)));
+		}
+	}
+	cout << lu << " " << chol << " " << lchol << " " << svd << endl;
+}
+
+void test_qr(bool pivot)
+{
+	double err=0;
+	for(int i=0; i < 50; i++)
+	{
+		int rows = xor128u() % 30 + 1;
+		int cols = xor128u() % 30 + 1;
+		Matrix<> m = random_matrix(rows, cols);
+		Vector<> b = random_matrix(rows, 1).T()[0];
+
+		QR_Lapack<> a(m, pivot), c(rows, cols, pivot);
+		Matrix<Dynamic, Dynamic, double, ColMajor> t = m;
+		c.compute_in_place(t);
+
+		err = max(err, norm(a.backsub(b) - c.backsub(b)));
+		err = max(err, norm_fro(a.get_Q() - c.get_Q()));
+		err = max(err, norm_fro(a.get_R() - c.get_R()));
+	}
+	cout << err << endl;
+}
+
+//Static sizes, with both the copying and in place interfaces.
+void test_static()
+{
+	Matrix<4> m = random_matrix(4, 4);
+	Matrix<4> s = m * m.T();
+	s += Identity;
+	Matrix<4> t = s;
+
+	LU<4> lu(m);
+	Cholesky<4> chol(s);
+	Lapack_Cholesky<4> lchol;
+	lchol.compute_in_place(t);
+
+	Matrix<4> I = Identity;
+	double err = 0;
+	err = max(err, norm_fro(m * lu.get_inverse() - I));
+	err = max(err, norm_fro(s * chol.get_inverse() - I));
+	err = max(err, norm_fro(s * lchol.get_inverse() - I));
+	cout << err << endl;
+}
+
+//Matrices which are not packed in the layout a decomposition uses are
+//copied, and must be left unmodified.
+void test_not_packed()
+{
+	int n = 7;
+	Matrix<> m = random_matrix(n, n);
+	Vector<> b = random_matrix(n, 1).T()[0];
+	double err=0;
+
+	{
+		LU<> a(m), c(n);
+		Matrix<Dynamic, Dynamic, double, ColMajor> t = m;
+		c.compute_in_place(t);
+		err = max(err, norm(a.backsub(b) - c.backsub(b)));
+		err = max(err, norm_fro(t - m));
+	}
+
+	{
+		QR_Lapack<> a(m), c(n, n);
+		Matrix<> t = m;
+		c.compute_in_place(t);
+		err = max(err, norm(a.backsub(b) - c.backsub(b)));
+		err = max(err, norm_fro(t - m));
+	}
+	cout << err << endl;
+}
+
+int main()
+{
+	test_square();
+	test_qr(0);
+	test_qr(1);
+	test_static();
+	test_not_packed();
+}
@@ -0,0 +1,73 @@
+#include "regressions/regression.h"
+#include <TooN/irls.h>
+using namespace TooN;
+using namespace std;
+
+//Check that true_scale() is the derivative of x w(x)
+template<template<typename> class Reweight> void test_true_scale()
+{
+	Reweight<double> r;
+	r.set_sd(0.7);
+
+	double err = 0;
+	const double h = 1e-6;
+	for(double x=-3.1; x <= 3; x += 0.25)
+	{
+		const double d = ((x+h)*r.reweight(x+h) - (x-h)*r.reweight(x-h)) / (2*h);
+		err = max(err, abs(d - r.true_scale(x)));
+	}
+	cout << (err < 1e-6 ? 0 : err) << endl;
+}
+
+//Check that add_mJ_rows() gives the same as add_mJ()
+template<template<typename> class Reweight> void test_rows(int n, int size)
+{
+	Matrix<> J(n, size);
+	Vector<> m(n);
+	for(int i=0; i < n; i++)
+	{
+		for(int j=0; j < size; j++)
+			J[i][j] = xor128d() - .5;
+		m[i] = 4*xor128d() - 2;
+	}
+
+	IRLS<Dynamic, double, Reweight> irls1(size), irls2(size);
+	irls1.set_sd(0.5);
+	irls2.set_sd(0.5);
+
+	for(int i=0; i < n; i++)
+		irls1.add_mJ(m[i], Vector<>(J[i]));
+	irls2.add_mJ_rows(m, J);
+
+	double err = norm_inf(irls1.get_vector() - irls2.get_vector());
+	err += abs(irls1.get_residual() - irls2.get_residual()) / abs(irls1.get_residual());
+
+	irls1.add_prior(1);
+	irls2.add_prior(1);
+	irls1.compute();
+	irls2.compute();
+	err += norm_inf(irls1.get_mu() - irls2.get_mu());
+
+	//compute() completes the lower triangle of the true inverse covariance
+	Vector<> ts(n);
+	for(int i=0; i < n; i++)
+		ts[i] = irls2.true_scale(m[i]);
+	Matrix<> true_C_inv = J.T() * diagmult(ts, J);
+	err += norm_fro(irls1.get_true_C_inv() - irls2.get_true_C_inv()) / norm_fro(irls1.get_true_C_inv());
+	err += norm_fro(irls2.get_true_C_inv() - true_C_inv) / norm_fro(true_C_inv);
+
+	cout << err << endl;
+}
+
+int main()
+{
+	test_true_scale<RobustI>();
+	test_true_scale<RobustII>();
+	test_true_scale<RobustIII>();
+	test_true_scale<ILinear>();
+
+	test_rows<RobustI>(10, 3);
+	test_rows<RobustII>(200, 70);
+	test_rows<RobustIII>(130, 100);
+	test_rows<ILinear>(65, 5);
+}
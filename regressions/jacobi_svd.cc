@@ -0,0 +1,52 @@
+#include "regressions/regression.h"
+#include <TooN/Jacobi_SVD.h>
+#include <TooN/GR_SVD.h>
+using namespace TooN;
+using namespace std;
+
+template<int M, int N> void test()
+{
+	double err_recon=0, err_ortho=0, err_sv=0;
+
+	for(int i=0; i < 1000; i++)
+	{
+		Matrix<M,N> m;
+		for(int r=0; r < M; r++)
+			for(int c=0; c < N; c++)
+				m[r][c] = xor128d() - .5;
+
+		Jacobi_SVD<M,N> j(m);
+		GR_SVD<M,N> g(m);
+
+		j.reorder();
+		g.reorder();
+
+		err_recon = max(err_recon, norm_fro(j.get_U() * diagmult(j.get_diagonal(), j.get_V().T()) - m));
+		err_ortho = max(err_ortho, norm_fro(j.get_V().T() * j.get_V() - Matrix<N>(Identity)));
+		err_sv = max(err_sv, norm_inf(j.get_diagonal() - g.get_diagonal()));
+	}
+
+	cout << M << " " << N << " " << (err_recon < 1e-12) << " " << (err_ortho < 1e-12) << " " << (err_sv < 1e-12) << endl;
+}
+
+int main()
+{
+	Matrix<6,4> m=Data(7.1259081599432528e-01, 4.2097952268306421e-01, 8.3341077322495927e-01, 9.9124489489770040e-01, 3.1784660216412347e-01, 4.1949631857048914e-01, 4.7727559718070028e-01, 7.9377920184015760e-01, 7.6661245683649937e-01, 2.1747993041326713e-01, 1.8637696266582987e-01, 3.7701050694140509e-01, 6.0122381327712404e-01, 9.9548617645170079e-01, 5.0222598175122368e-01, 2.2963368033181392e-01, 5.6726962865418729e-01, 1.7610468108004690e-01, 5.5242462794417013e-01, 4.9506236661284891e-01, 8.8282275746795025e-01, 3.7981396117759264e-01, 3.3036735284418856e-01, 9.2338197268264907e-02);
+
+	Jacobi_SVD<6,4> a(m);
+	cout << setprecision(16);
+	cout << a.get_pinv() << endl;
+
+	test<2,2>();
+	test<3,3>();
+	test<4,4>();
+	test<6,6>();
+	test<6,4>();
+	test<3,5>();
+
+	//Single precision
+	Matrix<6,4,float> mf = m;
+	Jacobi_SVD<6,4,float> f(mf);
+	cout << (norm_fro(f.get_pinv() * mf - Matrix<4,4,float>(Identity)) < 1e-4) << endl;
+	cout << (norm_inf(f.backsub(mf * makeVector<float>(1, 2, 3, 4)) - makeVector<float>(1, 2, 3, 4)) < 1e-4) << endl;
+}
@@ -0,0 +1,142 @@
+#include "regressions/regression.h"
+#include <TooN/optimization/lbfgs.h>
+using namespace TooN;
+using namespace std;
+
+double sq(double x)
+{
+	return x*x;
+}
+
+struct Rosenbrock
+{
+	double operator()(const Vector<2>& v) const
+	{
+		return sq(1 - v[0]) + 100 * sq(v[1] - sq(v[0]));
+	}
+};
+
+struct RosenbrockDerivatives
+{
+	Vector<2> operator()(const Vector<2>& v) const
+	{
+		double x = v[0];
+		double y = v[1];
+
+		Vector<2> ret;
+		ret[0] = -2+2*x-400*(y-sq(x))*x;
+		ret[1] = 200*y-200*sq(x);
+
+		return ret;
+	}
+};
+
+//A badly conditioned quadratic, 0.5 x^T A x - b.x with diagonal A
+struct Quadratic
+{
+	Vector<> a, b;
+
+	Quadratic(int n)
+	:a(n), b(n), evaluations(0)
+	{
+		for(int i=0; i < n; i++)
+		{
+			a[i] = pow(10.0, 4.0 * i / (n-1));
+			b[i] = 1;
+		}
+	}
+
+	mutable int evaluations;
+
+	double operator()(const Vector<>& x) const
+	{
+		evaluations++;
+		double f = 0;
+		for(int i=0; i < x.size(); i++)
+			f += 0.5 * a[i] * sq(x[i]) - b[i] * x[i];
+		return f;
+	}
+};
+
+struct QuadraticDerivatives
+{
+	const Quadratic& q;
+	QuadraticDerivatives(const Quadratic& q_)
+	:q(q_)
+	{}
+
+	Vector<> operator()(const Vector<>& x) const
+	{
+		Vector<> g(x.size());
+		for(int i=0; i < x.size(); i++)
+			g[i] = q.a[i] * x[i] - q.b[i];
+		return g;
+	}
+};
+
+//f(x) = x.x, which has a zero gradient at the origin
+struct Square
+{
+	double operator()(const Vector<2>& v) const
+	{
+		return v * v;
+	}
+};
+
+struct SquareDerivatives
+{
+	Vector<2> operator()(const Vector<2>& v) const
+	{
+		return 2 * v;
+	}
+};
+
+int main()
+{
+	{
+		LBFGS<2> lbfgs(makeVector(-1.2, 1), Rosenbrock(), RosenbrockDerivatives());
+		while(lbfgs.iterate(Rosenbrock(), RosenbrockDerivatives()))
+		{}
+
+		cout << lbfgs.x << endl;
+		cout << (lbfgs.y < 1e-10) << endl;
+		cout << (lbfgs.iterations < 60) << endl;
+	}
+
+	{
+		Quadratic q(50);
+		QuadraticDerivatives dq(q);
+
+		Vector<> x0 = Zeros(50);
+		LBFGS<> lbfgs(x0, q, dq, 5);
+		lbfgs.tolerance = 1e-14;
+		while(lbfgs.iterate(q, dq))
+		{}
+		int lbfgs_evaluations = q.evaluations;
+
+		q.evaluations = 0;
+		ConjugateGradient<> cg(x0, q, dq);
+		cg.tolerance = 1e-14;
+		while(cg.iterate(q, dq))
+		{}
+
+		Vector<> e(50);
+		for(int i=0; i < 50; i++)
+			e[i] = lbfgs.x[i] * q.a[i] - 1;
+		cout << (norm_inf(e) < 1e-4) << endl;
+
+		//Only some of the steps need a line search
+		cout << (lbfgs.linesearches < lbfgs.iterations / 10) << endl;
+		cout << (lbfgs_evaluations < q.evaluations / 2) << endl;
+	}
+
+	{
+		//Starting at a stationary point must stop at once
+		LBFGS<2> lbfgs(makeVector(0, 0), Square(), SquareDerivatives());
+		while(lbfgs.iterate(Square(), SquareDerivatives()))
+		{}
+
+		cout << lbfgs.x << endl;
+		cout << lbfgs.iterations << endl;
+	}
+}
@@ -0,0 +1,91 @@
+#include "regressions/regression.h"
+#include <TooN/optimization/levenberg_marquardt.h>
+#include <TooN/irls.h>
+using namespace TooN;
+using namespace std;
+
+double sq(double x)
+{
+	return x*x;
+}
+
+//Rosenbrock's function as a least squares problem
+struct Rosenbrock
+{
+	double operator()(const Vector<2>& x) const
+	{
+		return sq(10*(x[1] - sq(x[0]))) + sq(1 - x[0]);
+	}
+
+	template<class W> void operator()(const Vector<2>& x, W& wls) const
+	{
+		wls.add_mJ(10*(x[1] - sq(x[0])), makeVector(20*x[0], -10.0));
+		wls.add_mJ(1 - x[0], makeVector(1.0, 0.0));
+	}
+};
+
+//Fit y = a exp(b t) to noiseless data
+struct Exponential
+{
+	Vector<> t, y;
+
+	Exponential()
+	:t(20), y(20)
+	{
+		for(int i=0; i < t.size(); i++)
+		{
+			t[i] = i * 0.1;
+			y[i] = 3 * exp(-1.5 * t[i]);
+		}
+	}
+
+	double operator()(const Vector<>& x) const
+	{
+		double f = 0;
+		for(int i=0; i < t.size(); i++)
+			f += sq(y[i] - x[0] * exp(x[1] * t[i]));
+		return f;
+	}
+
+	template<class W> void operator()(const Vector<>& x, W& wls) const
+	{
+		for(int i=0; i < t.size(); i++)
+		{
+			double e = exp(x[1] * t[i]);
+			wls.add_mJ(y[i] - x[0] * e, Vector<>(makeVector(e, x[0] * t[i] * e)));
+		}
+	}
+};
+
+template<class LM, class F> void run(LM& lm, const F& f)
+{
+	while(lm.iterate(f, f))
+	{}
+
+	cout << lm.x << " " << (lm.evaluations == lm.iterations + lm.rejections + 1) << " " 
+	     << (lm.linearizations == lm.iterations + 1 || lm.linearizations == lm.iterations) << endl;
+}
+
+int main()
+{
+	Rosenbrock r;
+	Exponential e;
+
+	LevenbergMarquardt<2> lm1(makeVector(-1.2, 1), r);
+	run(lm1, r);
+
+	LevenbergMarquardt<2> lm2(makeVector(-1.2, 1), r);
+	lm2.method = lm2.Dogleg;
+	run(lm2, r);
+
+	LevenbergMarquardt<> lm3(Vector<>(makeVector(1, 0)), e);
+	run(lm3, e);
+
+	LevenbergMarquardt<> lm4(Vector<>(makeVector(1, 0)), e);
+	lm4.method = lm4.Dogleg;
+	run(lm4, e);
+
+	//A system without reweighting gives the same as WLS
+	LevenbergMarquardt<Dynamic, double, IRLS<Dynamic, double, ILinear> > lm5(Vector<>(makeVector(1, 0)), e);
+	run(lm5, e);
+}
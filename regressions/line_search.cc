@@ -0,0 +1,103 @@
+#include "regressions/regression.h"
+#include <TooN/optimization/brent.h>
+#include <TooN/optimization/golden_section.h>
+using namespace TooN;
+using namespace std;
+
+//A family of 1D functions, f_i(u) = exp(s_i (u - t_i)) - s_i (u - t_i) + i,
+//with minima at t_i.
+struct Family
+{
+	Family()
+	:evaluations(0)
+	{}
+
+	mutable int evaluations;
+
+	double t(int i) const
+	{
+		return 0.37 * i - 5;
+	}
+
+	double s(int i) const
+	{
+		return 0.5 + (i % 7) * 0.3;
+	}
+
+	double operator()(int i, double u) const
+	{
+		evaluations++;
+		double d = s(i) * (u - t(i));
+		return exp(d) - d + i;
+	}
+};
+
+//One problem from the family
+struct Single
+{
+	Single(const Family& f_, int i_)
+	:f(f_), i(i_)
+	{}
+
+	const Family& f;
+	int i;
+
+	double operator()(double u) const
+	{
+		return f(i, u);
+	}
+};
+
+int main()
+{
+	const int n = 29;
+	Family f;
+	Vector<> a(n), x(n), b(n), fx(n);
+
+	for(int i=0; i < n; i++)
+	{
+		a[i] = f.t(i) - 1 - 0.1 * (i % 5);
+		x[i] = f.t(i) + 0.1 + 0.05 * (i % 3);
+		b[i] = f.t(i) + 2 + 0.3 * (i % 4);
+		fx[i] = f(i, x[i]);
+	}
+
+	for(int maxiterations=100; maxiterations >= 5; maxiterations -= 95)
+	{
+		//The batch versions give exactly the same results as the
+		//single problem versions, with the same number of evaluations
+		f.evaluations = 0;
+		Matrix<Dynamic, 2> brent = brent_line_search_batch(a, x, b, fx, f, maxiterations);
+		int batch_evaluations = f.evaluations;
+
+		f.evaluations = 0;
+		int mismatches = 0;
+		for(int i=0; i < n; i++)
+			if(brent[i] != brent_line_search(a[i], x[i], b[i], fx[i], Single(f, i), maxiterations))
+				mismatches++;
+
+		cout << mismatches << " " << (batch_evaluations == f.evaluations) << endl;
+		cout << brent[0] << brent[n-1] << endl;
+	}
+
+	f.evaluations = 0;
+	Matrix<Dynamic, 2> golden = golden_section_search_batch(a, x, b, fx, f, 100);
+	int batch_evaluations = f.evaluations;
+
+	f.evaluations = 0;
+	int mismatches = 0;
+	for(int i=0; i < n; i++)
+		if(golden[i] != golden_section_search(a[i], x[i], b[i], fx[i], Single(f, i), 100))
+			mismatches++;
+
+	cout << mismatches << " " << (batch_evaluations == f.evaluations) << endl;
+	cout << golden[0] << golden[n-1] << endl;
+
+	//Versions which evaluate the centre point, with statically sized inputs
+	Vector<3> a3 = a.slice<0,3>(), x3 = x.slice<0,3>(), b3 = b.slice<0,3>();
+	cout << brent_line_search_batch(a3, x3, b3, f, 100) << endl;
+	cout << golden_section_search_batch(a3, x3, b3, f, 100) << endl;
+
+	//No problems at all
+	cout << brent_line_search_batch(Vector<>(0), Vector<>(0), Vector<>(0), f, 100).num_rows() << endl;
+}
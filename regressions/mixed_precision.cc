@@ -0,0 +1,68 @@
+#include "regressions/regression.h"
+#include <TooN/MixedPrecision.h>
+#include <TooN/Lapack_Cholesky.h>
+using namespace TooN;
+using namespace std;
+
+Matrix<> random_matrix(int rows, int cols)
+{
+	Matrix<> m(rows, cols);
+	for(int r=0; r < rows; r++)
+		for(int c=0; c < cols; c++)
+			m[r][c] = xor128d();
+	return m;
+}
+
+//Well conditioned systems must be solved to double precision accuracy
+//without falling back to a double precision decomposition.
+template<template<int, class> class D> void test_random(bool spd)
+{
+	double err=0;
+	int fallbacks=0;
+	for(int i=0; i < 100; i++)
+	{
+		int n = xor128u() % 50 + 1;
+		Matrix<> m = random_matrix(n, n);
+		if(spd)
+			m = m * m.T();
+		m += 4 * n * Identity;
+
+		Matrix<> b = random_matrix(n, 3);
+
+		MixedPrecision<Dynamic, D> mp(m);
+		Matrix<> x = mp.backsub(b);
+		Vector<> v = mp.backsub(b.T()[0]);
+
+		err = max(err, norm_fro(m * x - b) / norm_fro(b));
+		err = max(err, norm(v - x.T()[0]) / norm(v));
+		fallbacks += mp.is_high_precision();
+	}
+	cout << err << " " << fallbacks << endl;
+}
+
+//A Hilbert matrix is too badly conditioned for single precision.
+template<template<int, class> class D> void test_hilbert()
+{
+	Matrix<10> h;
+	for(int r=0; r < 10; r++)
+		for(int c=0; c < 10; c++)
+			h[r][c] = 1.0 / (r + c + 1);
+
+	Vector<10> x = Ones;
+	Vector<10> b = h * x;
+
+	MixedPrecision<10, D> mp(h);
+	Vector<10> y = mp.backsub(b);
+	Vector<10> z = D<10, double>(h).backsub(b);
+
+	cout << mp.is_high_precision() << " " << norm(y - z) / norm(z) << endl;
+}
+
+int main()
+{
+	test_random<LU>(0);
+	test_random<LU>(1);
+	test_random<Lapack_Cholesky>(1);
+	test_hilbert<LU>();
+	test_hilbert<Lapack_Cholesky>();
+}
@@ -0,0 +1,115 @@
+#include "regressions/regression.h"
+#include <TooN/optimization/multistart.h>
+using namespace TooN;
+using namespace std;
+
+double sq(double x)
+{
+	return x*x;
+}
+
+struct Rastrigin
+{
+	double operator()(const Vector<2>& v) const
+	{
+		return 20 + sq(v[0]) + sq(v[1]) - 10*cos(2*M_PI*v[0]) - 10*cos(2*M_PI*v[1]);
+	}
+};
+
+struct Rosenbrock
+{
+	double operator()(const Vector<2>& v) const
+	{
+		return sq(1 - v[0]) + 100 * sq(v[1] - sq(v[0]));
+	}
+};
+
+struct RosenbrockDerivatives
+{
+	Vector<2> operator()(const Vector<2>& v) const
+	{
+		double x = v[0];
+		double y = v[1];
+
+		Vector<2> ret;
+		ret[0] = -2+2*x-400*(y-sq(x))*x;
+		ret[1] = 200*y-200*sq(x);
+
+		return ret;
+	}
+};
+
+struct NeverDominated
+{
+	bool operator()(const MultiStartRun<>&, const MultiStartRun<>&) const
+	{
+		return 0;
+	}
+};
+
+template<class M> void add_grid(M& ms)
+{
+	for(int i=0; i < 8; i++)
+		for(int j=0; j < 8; j++)
+			ms.add(DownhillSimplex<2>(Rastrigin(), makeVector(-4.7 + 1.2*i, -4.6 + 1.2*j), .3));
+}
+
+template<class M> void print_summary(const M& ms)
+{
+	int status[3] = {0, 0, 0};
+	for(int i=0; i < ms.num_runs(); i++)
+		status[ms.get_run(i).status]++;
+
+	cout << status[0] << " " << status[1] << " " << status[2] << endl;
+}
+
+int main()
+{
+	//Every run is iterated to convergence
+	MultiStart<DownhillSimplex<2>, double, NeverDominated> all;
+	add_grid(all);
+	while(all.iterate(Rastrigin()))
+	{}
+
+	const DownhillSimplex<2>& a = all.get_optimizer(all.get_best());
+	cout << a.get_simplex()[a.get_best()] << a.get_values()[a.get_best()] << endl;
+	print_summary(all);
+
+	//Losing runs are terminated early, but the same optimum is found
+	//with fewer iterations
+	for(int parallel=0; parallel < 2; parallel++)
+	{
+		MultiStart<DownhillSimplex<2> > pruned;
+		pruned.parallel = parallel;
+		pruned.steps = 5;
+		add_grid(pruned);
+		while(pruned.iterate(Rastrigin()))
+		{}
+
+		const DownhillSimplex<2>& p = pruned.get_optimizer(pruned.get_best());
+		cout << p.get_simplex()[p.get_best()] << p.get_values()[p.get_best()] << endl;
+		print_summary(pruned);
+		cout << (pruned.get_best() == all.get_best()) << " " << (pruned.total_iterations() < all.total_iterations()) << endl;
+	}
+
+	//Optimizers using derivatives
+	MultiStart<ConjugateGradient<2> > cg;
+	cg.add(ConjugateGradient<2>(makeVector(-1.2, 1), Rosenbrock(), RosenbrockDerivatives()));
+	cg.add(ConjugateGradient<2>(makeVector(2, 2), Rosenbrock(), RosenbrockDerivatives()));
+	while(cg.iterate(Rosenbrock(), RosenbrockDerivatives()))
+	{}
+	cout << cg.get_optimizer(cg.get_best()).x << cg.get_run(cg.get_best()).value << endl;
+	cout << cg.get_run(0).initial_value << " " << cg.get_run(1).initial_value << endl;
+	print_summary(cg);
+
+	MultiStart<LBFGS<2> > lbfgs;
+	lbfgs.add(LBFGS<2>(makeVector(-1.2, 1), Rosenbrock(), RosenbrockDerivatives()));
+	lbfgs.add(LBFGS<2>(makeVector(2, 2), Rosenbrock(), RosenbrockDerivatives()));
+	while(lbfgs.iterate(Rosenbrock(), RosenbrockDerivatives()))
+	{}
+	cout << lbfgs.get_optimizer(lbfgs.get_best()).x << lbfgs.get_run(lbfgs.get_best()).value << endl;
+
+	//Nothing to do
+	MultiStart<LBFGS<2> > empty;
+	cout << empty.iterate(Rosenbrock(), RosenbrockDerivatives()) << " " << empty.num_active() << endl;
+}
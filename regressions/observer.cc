@@ -0,0 +1,145 @@
+#include "regressions/regression.h"
+#include <TooN/optimization/conjugate_gradient.h>
+#include <TooN/optimization/downhill_simplex.h>
+#include <TooN/optimization/golden_section.h>
+#include <sstream>
+using namespace TooN;
+using namespace std;
+
+double sq(double x)
+{
+	return x*x;
+}
+
+struct Rosenbrock
+{
+	Rosenbrock(int& e)
+	:evaluations(e)
+	{}
+
+	int& evaluations;
+
+	double operator()(const Vector<2>& v) const
+	{
+		evaluations++;
+		return sq(1 - v[0]) + 100 * sq(v[1] - sq(v[0]));
+	}
+};
+
+struct RosenbrockDerivatives
+{
+	RosenbrockDerivatives(int& e)
+	:evaluations(e)
+	{}
+
+	int& evaluations;
+
+	Vector<2> operator()(const Vector<2>& v) const
+	{
+		evaluations++;
+		double x = v[0];
+		double y = v[1];
+
+		Vector<2> ret;
+		ret[0] = -2+2*x-400*(y-sq(x))*x;
+		ret[1] = 200*y-200*sq(x);
+
+		return ret;
+	}
+};
+
+struct Cosh
+{
+	Cosh(int& e)
+	:evaluations(e)
+	{}
+
+	int& evaluations;
+
+	double operator()(double x) const
+	{
+		evaluations++;
+		return cosh(x - 0.3);
+	}
+};
+
+int lines(const string& s)
+{
+	int n=0;
+	for(unsigned int i=0; i < s.size(); i++)
+		n += s[i] == '\n';
+	return n;
+}
+
+template<class Trace> void print_trace(const Trace& t, int function_evaluations, int derivative_evaluations)
+{
+	cout << (t.get_function_evaluations() == function_evaluations) << " "
+	     << (t.get_derivative_evaluations() == derivative_evaluations) << " "
+	     << t.get_records().size() << endl;
+
+	//The totals in the records never decrease
+	bool increasing = 1;
+	for(unsigned int i=1; i < t.get_records().size(); i++)
+		increasing &= t.get_records()[i].function_evaluations >= t.get_records()[i-1].function_evaluations &&
+		              t.get_records()[i].time >= t.get_records()[i-1].time;
+	cout << increasing << endl;
+}
+
+int main()
+{
+	int f=0, df=0;
+
+	//Conjugate gradient with and without an observer
+	ConjugateGradient<2> cg(makeVector(-1.2, 1), Rosenbrock(f), RosenbrockDerivatives(df));
+	while(cg.iterate(Rosenbrock(f), RosenbrockDerivatives(df)))
+	{}
+
+	f = df = 0;
+	ConjugateGradient<2, double, OptimizationTrace<> > cg_trace(makeVector(-1.2, 1), Rosenbrock(f), RosenbrockDerivatives(df));
+	while(cg_trace.iterate(Rosenbrock(f), RosenbrockDerivatives(df)))
+	{}
+
+	cout << (cg.x == cg_trace.x) << " " << (cg.y == cg_trace.y) << endl;
+	print_trace(cg_trace.observer, f, df);
+	cout << (cg_trace.observer.get_records().size() == (unsigned int)cg_trace.iterations) << " " << cg_trace.observer.get_bracket_expansions() << endl;
+	cout << cg_trace.observer.get_records().back().value << endl;
+
+	//Downhill simplex, in both evaluation modes
+	for(int speculative=0; speculative < 2; speculative++)
+	{
+		f = 0;
+		DownhillSimplex<2, double, OptimizationTrace<> > dh(Rosenbrock(f), makeVector(-1.2, 1));
+		dh.parallel = speculative;
+		dh.speculative = speculative;
+		while(dh.iterate(Rosenbrock(f)))
+		{}
+
+		print_trace(dh.observer, f, 0);
+	}
+
+	//Line searches
+	f = 0;
+	double f0 = cosh(-0.3);
+	OptimizationTrace<> brent_trace;
+	Vector<2> brent = brent_line_search(-1.0, 0.0, 2.0, f0, Cosh(f), 100, 1e-8, 1e-16, brent_trace);
+	cout << (brent == brent_line_search(-1.0, 0.0, 2.0, f0, Cosh(df), 100, 1e-8, 1e-16)) << endl;
+	print_trace(brent_trace, f, 0);
+
+	f = 0;
+	OptimizationTrace<> golden_trace;
+	Vector<2> golden = golden_section_search(-1.0, 0.0, 2.0, f0, Cosh(f), 100, 1e-8, golden_trace);
+	cout << (golden == golden_section_search(-1.0, 0.0, 2.0, f0, Cosh(df), 100, 1e-8)) << endl;
+	print_trace(golden_trace, f, 0);
+	cout << golden_trace.get_records()[0].step << endl;
+
+	//Output
+	ostringstream csv, json;
+	golden_trace.write_csv(csv);
+	golden_trace.write_json(json);
+
+	cout << csv.str().substr(0, csv.str().find('\n')) << endl;
+	cout << lines(csv.str()) << " " << lines(json.str()) << endl;
+
+	golden_trace.clear();
+	golden_trace.write_json(cout);
+}
@@ -0,0 +1,98 @@
+#include "regressions/regression.h"
+#include <TooN/pcg.h>
+using namespace TooN;
+using namespace std;
+
+//The 2D Poisson equation on a grid, with two unknowns per node which are
+//strongly coupled to each other, but not to the neighbours
+SparseMatrix<> poisson(int w, int h)
+{
+	const int n = w*h;
+	SparseMatrix<> s(2*n, 2*n);
+	for(int y=0; y < h; y++)
+		for(int x=0; x < w; x++)
+		{
+			const int i = x + y*w;
+			for(int k=0; k < 2; k++)
+			{
+				s.add(2*i+k, 2*i+k, 14.01);
+				s.add(2*i+k, 2*i+1-k, 9.9);
+				if(x+1 < w)
+				{
+					s.add(2*i+k, 2*(i+1)+k, -1);
+					s.add(2*(i+1)+k, 2*i+k, -1);
+				}
+				if(y+1 < h)
+				{
+					s.add(2*i+k, 2*(i+w)+k, -1);
+					s.add(2*(i+w)+k, 2*i+k, -1);
+				}
+			}
+		}
+	s.compress();
+	return s;
+}
+
+//Computes J^T J x without forming J^T J
+struct NormalEquations
+{
+	Matrix<> J;
+
+	NormalEquations(int rows, int cols)
+	:J(rows, cols)
+	{
+		for(int r=0; r < rows; r++)
+			for(int c=0; c < cols; c++)
+				J[r][c] = xor128d();
+	}
+
+	Vector<> operator*(const Vector<>& x) const
+	{
+		return J.T() * (J * x);
+	}
+};
+
+template<class Op, class Pre> int test(const Op& A, const Matrix<>& dense, const Pre& M, const char* name)
+{
+	const int n = dense.num_rows();
+	Vector<> b(n);
+	for(int i=0; i < n; i++)
+		b[i] = xor128d();
+
+	PCG<> pcg(n);
+	pcg.tolerance = 1e-10;
+	pcg.max_iterations = 10*n;
+	Vector<> x = Zeros(n);
+	const bool converged = pcg.solve(A, b, x, M);
+	const int iterations = pcg.iterations;
+
+	//A warm start from the solution finishes immediately
+	pcg.solve(A, b, x, M);
+
+	cout << name << " " << converged << " " << (norm(dense * x - b) <= 1e-9 * norm(b)) << " " << pcg.iterations << endl;
+	return iterations;
+}
+
+int main()
+{
+	const SparseMatrix<> s = poisson(20, 20);
+	const Matrix<> m = s.get_matrix();
+
+	const int none = test(s, m, IdentityPreconditioner<>(), "none");
+	const int block_jacobi = test(s, m, BlockJacobiPreconditioner<2>(s), "block_jacobi");
+	const int ic0 = test(s, m, IncompleteCholeskyPreconditioner<>(s), "ic0");
+	test(s, m, JacobiPreconditioner<>(s), "jacobi");
+	test(s, m, BlockJacobiPreconditioner<2>(m), "block_jacobi_dense");
+	test(m, m, JacobiPreconditioner<>(m), "dense");
+
+	//The better preconditioners need fewer iterations
+	cout << (block_jacobi < none) << " " << (ic0 < block_jacobi) << endl;
+
+	NormalEquations ne(30, 10);
+	test(ne, ne.J.T() * ne.J, IdentityPreconditioner<>(), "matrix_free");
+
+	//An indefinite matrix needs a shift for IC(0) to succeed
+	SparseMatrix<> t(Matrix<3>(Data(1, 2, 0, 2, 1, 0, 0, 0, 1)));
+	IncompleteCholeskyPreconditioner<> ic(t);
+	cout << (ic.get_shift() > 0) << endl;
+}
@@ -0,0 +1,143 @@
+#include "regressions/regression.h"
+#include <TooN/QR.h>
+#include <TooN/Cholesky.h>
+using namespace TooN;
+using namespace std;
+
+Matrix<> random_matrix(int rows, int cols)
+{
+	Matrix<> m(rows, cols);
+	for(int r=0; r < rows; r++)
+		for(int c=0; c < cols; c++)
+			m[r][c] = xor128d();
+	return m;
+}
+
+//Least squares on tall matrices, compared to the normal equations
+template<class C> void test_tall(bool pivot)
+{
+	double err=0;
+	for(int i=0; i < 300; i++)
+	{
+		int cols = xor128u() % 20 + 1;
+		int rows = cols + xor128u() % 200;
+
+		Matrix<> m = random_matrix(rows, cols);
+		Matrix<> b = random_matrix(rows, 2);
+
+		C q(m, pivot);
+		Matrix<> x = q.backsub(b);
+		Matrix<> x_normal = Cholesky<>(m.T() * m).backsub(m.T() * b);
+
+		Vector<> v = q.backsub(b.T()[0]);
+
+		err = max(err, norm_fro(x - x_normal) / norm_fro(x_normal));
+		err = max(err, norm(v - x.T()[0]) / norm(v));
+	}
+	cout << err << endl;
+}
+
+//Basic solutions on wide matrices must satisfy the equations exactly
+template<class C> void test_wide(bool pivot)
+{
+	double err=0;
+	for(int i=0; i < 300; i++)
+	{
+		int rows = xor128u() % 20 + 1;
+		int cols = rows + xor128u() % 20;
+
+		Matrix<> m = random_matrix(rows, cols);
+		Vector<> b = random_matrix(rows, 1).T()[0];
+
+		C q(m, pivot);
+		Vector<> x = q.backsub(b);
+
+		err = max(err, norm(m*x - b) / norm(b));
+	}
+	cout << err << endl;
+}
+
+//The pivoted economy sized decomposition of tall matrices
+void test_lapack_tall()
+{
+	double err=0;
+	for(int i=0; i < 300; i++)
+	{
+		int cols = xor128u() % 20 + 1;
+		int rows = cols + xor128u() % 200;
+
+		Matrix<> m = random_matrix(rows, cols);
+		QR_Lapack<> q(m, 1);
+
+		Matrix<> mp(rows, cols);
+		for(int c=0; c < cols; c++)
+			mp.T()[c] = m.T()[q.get_P()[c]];
+
+		err = max(err, norm_fro(q.get_Q() * q.get_R() - mp));
+		err = max(err, norm_fro(q.get_Q().T() * q.get_Q() - Matrix<>(Identity(cols))));
+	}
+	cout << err << endl;
+}
+
+//Rank deficient least squares: the last column duplicates the first, so
+//R has a negligible diagonal element. The solution must still be finite
+//and satisfy the normal equations.
+template<class C> void test_rank_deficient(bool pivot)
+{
+	double err=0;
+	bool finite=1;
+	for(int i=0; i < 100; i++)
+	{
+		int cols = xor128u() % 10 + 2;
+		int rows = cols + xor128u() % 50;
+
+		Matrix<> m = random_matrix(rows, cols);
+		m.T()[cols-1] = m.T()[0];
+		Vector<> b = random_matrix(rows, 1).T()[0];
+
+		C q(m, pivot);
+		Vector<> x = q.backsub(b);
+
+		for(int j=0; j < cols; j++)
+			finite &= (x[j] == x[j]) && std::abs(x[j]) < 1e10;
+
+		err = max(err, norm(m.T() * (m*x - b)) / norm(m.T()*b));
+	}
+	cout << finite << " " << err << endl;
+}
+
+//Adapt the native classes, which do not pivot, to the QR_Lapack interface
+template<int BlockSize> struct Blocked: public QR_Blocked<Dynamic, Dynamic, double, BlockSize>
+{
+	template<class M> Blocked(const M& m, bool)
+	:QR_Blocked<Dynamic, Dynamic, double, BlockSize>(m)
+	{}
+};
+
+struct Native: public QR<>
+{
+	template<class M> Native(const M& m, bool)
+	:QR<>(m)
+	{}
+};
+
+int main()
+{
+	cout << setprecision(6) << fixed;
+
+	test_tall<QR_Lapack<> >(0);
+	test_tall<QR_Lapack<> >(1);
+	test_tall<Blocked<16> >(0);
+	test_tall<Blocked<4> >(0);
+
+	test_wide<QR_Lapack<> >(0);
+	test_wide<QR_Lapack<> >(1);
+	test_wide<Blocked<16> >(0);
+	test_wide<Native>(0);
+
+	test_lapack_tall();
+
+	test_rank_deficient<QR_Lapack<> >(1);
+	test_rank_deficient<QR_Lapack<> >(0);
+	test_rank_deficient<Blocked<4> >(0);
+}
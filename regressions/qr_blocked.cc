@@ -0,0 +1,82 @@
+#include "regressions/regression.h"
+#include <TooN/QR.h>
+using namespace TooN;
+using namespace std;
+
+template<class C> void test(bool tall)
+{
+	double err=0;
+	
+	//Test a bunch of matrices 
+	for(int i=0; i < 300; i++)
+	{
+		int rows = xor128u() % 100 + 2;
+		int cols = rows  + xor128u() % 20;
+
+		if(tall)
+			swap(rows, cols);
+
+		Matrix<> m(rows, cols);
+
+		for(int r=0; r < rows; r++)
+			for(int c=0; c < cols; c++)
+				m[r][c] = xor128d();
+
+		C q(m);
+		
+		Matrix<> Q = q.get_Q();
+		int k = min(rows, cols);
+
+		double edecomp = norm_fro(Q * q.get_R() - m);
+		double e_ortho = norm_fro(Q.T() * Q - Matrix<>(Identity(k)));
+
+		//Applying Q^T then Q must get back to where we started.
+		Matrix<> n = m;
+		q.apply_QT(n);
+		double e_apply = norm_fro(n.slice(0, 0, k, cols) - q.get_R());
+		q.apply_Q(n);
+		e_apply += norm_fro(n - m);
+
+		for(int r=0; r < k; r++)
+			for(int c=0; c < r; c++)
+				err = max(err, (q.get_R()[r][c] != 0)*1.0);
+		
+		err = max(err, max(edecomp, max(e_ortho, e_apply)));
+	}
+
+	cout << err << endl;
+}
+
+int main()
+{
+	Matrix<3,4> m;
+	
+	m = Data(5.4388593399963903e-01,
+9.9370462412085203e-01,
+1.0969746452319418e-01,
+4.4837291206649532e-01,
+7.2104662057981139e-01,
+2.1867663239963386e-01,
+6.3591370975105699e-02,
+3.6581617683817125e-01,
+5.2249530577710213e-01,
+1.0579827325022817e-01,
+4.0457999585762583e-01,
+7.6350464084881342e-01);
+	
+	cout << setprecision(20) << scientific;
+	cout << m << endl;
+
+	QR_Blocked<3, 4> q(m);
+
+	cout << q.get_R() << endl;
+	cout << q.get_Q() << endl;
+
+	cout << q.get_Q() * q.get_R() - m << endl;
+
+	cout << setprecision(6) << fixed;
+	test<QR_Blocked<> >(0);
+	test<QR_Blocked<> >(1);
+	test<QR_Blocked<Dynamic, Dynamic, double, 4> >(0);
+	test<QR_Blocked<Dynamic, Dynamic, double, 4> >(1);
+}
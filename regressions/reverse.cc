@@ -0,0 +1,88 @@
+#include "regressions/regression.h"
+#include <TooN/functions/reverse.h>
+#include <TooN/functions/dual.h>
+#include <TooN/optimization/conjugate_gradient.h>
+using namespace TooN;
+using namespace std;
+
+template<class P> P f(const Vector<3, P>& x)
+{
+	using std::sin;
+	using std::exp;
+	using std::sqrt;
+	using std::atan2;
+	return sin(x[0]) * exp(x[1] / x[2]) + sqrt(x * x) - atan2(x[1], x[0]) + 2.0 / x[2];
+}
+
+struct F
+{
+	template<class P> P operator()(const Vector<3, P>& x) const
+	{
+		return f(x);
+	}
+};
+
+//The extended Rosenbrock function
+struct Rosenbrock
+{
+	template<class P> P operator()(const Vector<Dynamic, P>& x) const
+	{
+		P r = 0;
+		for(int i=0; i < x.size() - 1; i++)
+		{
+			P a = x[i+1] - x[i] * x[i];
+			P b = 1 - x[i];
+			r += 100 * a * a + b * b;
+		}
+		return r;
+	}
+};
+
+struct RosenbrockGradient
+{
+	mutable Tape<> tape;
+
+	Vector<> operator()(const Vector<>& x) const
+	{
+		return reverse_gradient(Rosenbrock(), x, tape);
+	}
+};
+
+int main()
+{
+	Vector<3> x = makeVector(0.3, -0.5, 1.2);
+
+	//Compare to forward mode
+	Vector<3> g = reverse_gradient(F(), x);
+	cout << g << endl;
+	cout << norm_inf(g - get_gradient(f(make_dual_vector<3>(x)))) << endl;
+
+	//Matrix and Vector operations, mixing Reverse and double
+	Matrix<3> A = Data(1, 2, 3, 4, 5, 6, 7, 8, 10);
+	Tape<> tape;
+	Vector<3, Reverse<> > xr = tape.variables(x);
+	Reverse<> y = xr * (A * xr) + 3;
+	cout << y << " " << x * (A * x) + 3 << endl;
+	cout << (norm_inf(tape.gradient(y) - (A + A.T()) * x) < 1e-12) << endl;
+
+	//Constants are not recorded
+	int size = tape.size();
+	Reverse<> c = Reverse<>(2) * 3 + 1;
+	cout << c << " " << (tape.size() == size) << " " << c.index << endl;
+
+	//Minimize a large function with gradients from a reused tape
+	Vector<> x0(100);
+	for(int i=0; i < x0.size(); i++)
+		x0[i] = i % 2 ? 1 : -1.2;
+
+	RosenbrockGradient grad;
+	ConjugateGradient<> cg(x0, Rosenbrock(), grad);
+	while(cg.iterate(Rosenbrock(), grad))
+	{}
+
+	double err = 0;
+	for(int i=0; i < cg.x.size(); i++)
+		err = max(err, abs(cg.x[i] - 1));
+	cout << (cg.y < 1e-10) << " " << (err < 1e-5) << endl;
+	cout << grad.tape.num_variables() << " " << grad.tape.size() << endl;
+}
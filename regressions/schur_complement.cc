@@ -0,0 +1,98 @@
+#include "regressions/regression.h"
+#include <TooN/SchurComplement.h>
+#include <TooN/wls.h>
+using namespace TooN;
+using namespace std;
+
+//Compare the Schur complement solution with a dense WLS for random measurements
+void test_random(int cameras, int points)
+{
+	const int size = 6*cameras + 3*points;
+	SchurComplement<> sc(cameras, points);
+	WLS<> wls(size);
+
+	//Run twice, to check that clear() works with the existing structure
+	for(int pass=0; pass < 2; pass++)
+	{
+		sc.clear();
+		wls.clear();
+
+		for(int j=0; j < points; j++)
+			for(int i=0; i < cameras; i++)
+			{
+				//Each point is seen by about half the cameras
+				if(xor128d() < .5 && i != j % cameras)
+					continue;
+
+				Vector<2> m;
+				Matrix<2,6> Jc;
+				Matrix<2,3> Jp;
+				Matrix<2> invcov;
+				for(int r=0; r < 2; r++)
+				{
+					m[r] = xor128d();
+					for(int c=0; c < 6; c++)
+						Jc[r][c] = xor128d();
+					for(int c=0; c < 3; c++)
+						Jp[r][c] = xor128d();
+				}
+				invcov = Identity * (xor128d() + 1);
+				invcov[0][1] = invcov[1][0] = .1;
+
+				if(pass == 0)
+					sc.add_mJ(i, j, m, Jc, Jp, invcov);
+				else
+					sc.add_mJ(i, j, m, Jc, Jp, invcov[0][0]);
+
+				Matrix<> J(2, size);
+				J = Zeros;
+				J.slice(0, 6*i, 2, 6) = Jc;
+				J.slice(0, 6*cameras + 3*j, 2, 3) = Jp;
+				if(pass == 0)
+					wls.add_mJ_rows(Vector<>(m), J, Matrix<>(invcov));
+				else
+					wls.add_mJ_rows(Vector<>(m), J, Matrix<>(Identity(2) * invcov[0][0]));
+			}
+
+		sc.add_prior(.1);
+		wls.add_prior(.1);
+		sc.compute();
+		wls.compute();
+
+		double err = 0;
+		for(int i=0; i < cameras; i++)
+			err = max(err, norm_inf(sc.get_camera_mu(i) - wls.get_mu().slice(6*i, 6)));
+		for(int j=0; j < points; j++)
+			err = max(err, norm_inf(sc.get_point_mu(j) - wls.get_mu().slice(6*cameras + 3*j, 3)));
+
+		cout << err / norm_inf(wls.get_mu()) << endl;
+	}
+}
+
+//Check that update() applies the steps in the usual way
+void test_update()
+{
+	SchurComplement<> sc(2, 1);
+	sc.add_mJ(0, 0, makeVector(1., 2.), Matrix<2,6>(Data(1,0,0,0,0,0, 0,1,0,0,0,0)), Matrix<2,3>(Data(1,0,0, 0,1,0)));
+	sc.add_mJ(1, 0, makeVector(3., 1.), Matrix<2,6>(Data(0,0,0,1,0,0, 0,0,0,0,1,0)), Matrix<2,3>(Data(0,0,1, 0,1,0)));
+	sc.add_prior(1);
+	sc.compute();
+
+	vector<SE3<> > cameras(2, SE3<>::exp(makeVector(1, 2, 3, .1, .2, .3)));
+	vector<Vector<3> > points(1, makeVector(4, 5, 6));
+	sc.update(cameras, points);
+
+	double err = 0;
+	for(int i=0; i < 2; i++)
+		err += norm_inf((cameras[i] * (SE3<>::exp(sc.get_camera_mu(i)) * SE3<>::exp(makeVector(1, 2, 3, .1, .2, .3))).inverse()).ln());
+	err += norm_inf(points[0] - makeVector(4, 5, 6) - sc.get_point_mu(0));
+
+	cout << err << endl;
+}
+
+int main()
+{
+	test_random(1, 4);
+	test_random(5, 20);
+	test_update();
+}
@@ -51,6 +51,17 @@ int main()
 
 	cout << dh_variable.get_simplex()[dh_variable.get_best()] << endl
 	     << dh_variable.get_values()[dh_variable.get_best()] << endl;
+
+	//Parallel and speculative evaluation visit the same points
+	for(int mode=1; mode <= 2; mode++)
+	{
+		DownhillSimplex<> dh(Spiral, starting_point, .001, 1, mode == 2);
+
+		while(dh.iterate(Spiral))
+		{}
+
+		cout << norm_fro(dh.get_simplex() - dh_variable.get_simplex()) << " " << norm(dh.get_values() - dh_variable.get_values()) << endl;
+	}
 }
 
 
@@ -0,0 +1,139 @@
+#include "regressions/regression.h"
+#include <TooN/SparseMatrix.h>
+#include <TooN/SparseCholesky.h>
+#include <TooN/Cholesky.h>
+using namespace TooN;
+using namespace std;
+
+//A random sparse symmetric positive definite matrix: the Laplacian of a
+//grid with some extra random edges, plus the identity
+Matrix<> random_spd(int w, int h, int extra)
+{
+	const int n = w*h;
+	Matrix<> m = Identity(n);
+	for(int y=0; y < h; y++)
+		for(int x=0; x < w; x++)
+		{
+			const int i = x + y*w;
+			for(int e=0; e < 2 + extra; e++)
+			{
+				int j;
+				if(e == 0 && x+1 < w)
+					j = i + 1;
+				else if(e == 1 && y+1 < h)
+					j = i + w;
+				else if(e > 1)
+					j = xor128u() % n;
+				else
+					continue;
+
+				if(i == j)
+					continue;
+				const double v = xor128d() + .5;
+				m[i][i] += v;
+				m[j][j] += v;
+				m[i][j] -= v;
+				m[j][i] -= v;
+			}
+		}
+	return m;
+}
+
+void test_multiply()
+{
+	Matrix<> m(7, 5);
+	for(int r=0; r < m.num_rows(); r++)
+		for(int c=0; c < m.num_cols(); c++)
+			m[r][c] = xor128d() < .3 ? xor128d() : 0;
+
+	SparseMatrix<> csr(m);
+	SparseMatrix<double, ColMajor> csc(csr);
+	SparseMatrix<double, ColMajor> csc2(m);
+
+	double x_data[5];
+	for(int i=0; i < 5; i++)
+		x_data[i] = xor128d();
+	Vector<5> x = wrapVector<5>(x_data);
+
+	double err = norm_fro(csr.get_matrix() - m) + norm_fro(csc.get_matrix() - m);
+	err += (csc.get_indices() != csc2.get_indices()) + (csc.get_offsets() != csc2.get_offsets());
+	err += norm_inf(csr * wrapVector<5>(x_data) - m * x);
+	err += norm_inf(csc * x - m * x);
+	err += norm_inf(csr.T() * makeVector(1, 2, 3, 4, 5, 6, 7) - m.T() * makeVector(1, 2, 3, 4, 5, 6, 7));
+
+	//Building by add() sums duplicates, and compress() can be called repeatedly
+	SparseMatrix<> s(2, 3);
+	s.add(1, 2, 1);
+	s.add(0, 0, 2);
+	s.add(1, 2, 3);
+	s.compress();
+	s.add(0, 1, 5);
+	s.add(0, 0, 1);
+	s.compress();
+	err += norm_fro(s.get_matrix() - Matrix<2, 3>(Data(3, 5, 0, 0, 0, 4)));
+	err += s.num_nonzeros() - 3;
+
+	cout << err << endl;
+}
+
+void test_cholesky(int w, int h, int extra)
+{
+	const Matrix<> m = random_spd(w, h, extra);
+	const int n = m.num_rows();
+	SparseMatrix<> s(m);
+
+	Vector<> b(n);
+	for(int i=0; i < n; i++)
+		b[i] = xor128d();
+
+	SparseCholesky<> chol(s);
+	Cholesky<> dense(m);
+
+	double err = norm_inf(chol.backsub(b) - dense.backsub(b)) / norm_inf(dense.backsub(b));
+	err += abs(chol.determinant() / dense.determinant() - 1);
+	err += chol.rank() - n;
+
+	//Check the factors directly
+	Matrix<> P = Zeros(n);
+	for(int k=0; k < n; k++)
+		P[k][chol.get_permutation()[k]] = 1;
+	const Matrix<> L = chol.get_unscaled_L().get_matrix();
+	err += norm_fro(L * diagmult(chol.get_D(), L.T()) - P * m * P.T()) / norm_fro(m);
+
+	//New values with the same structure
+	for(size_t i=0; i < s.get_values().size(); i++)
+		s.get_values()[i] *= 2;
+	chol.compute(s);
+	err += norm_inf(2 * chol.backsub(b) - dense.backsub(b)) / norm_inf(dense.backsub(b));
+
+	cout << err << endl;
+}
+
+//An arrow matrix with the dense row first fills in completely unless it is reordered.
+void test_ordering()
+{
+	const int n = 50;
+	SparseMatrix<> s(n, n);
+	for(int i=0; i < n; i++)
+	{
+		s.add(i, i, n);
+		if(i > 0)
+		{
+			s.add(0, i, 1);
+			s.add(i, 0, 1);
+		}
+	}
+	s.compress();
+
+	SparseCholesky<> chol(s);
+	cout << chol.num_nonzeros() << " " << chol.get_permutation().back() << endl;
+}
+
+int main()
+{
+	test_multiply();
+	test_cholesky(1, 1, 0);
+	test_cholesky(10, 10, 0);
+	test_cholesky(15, 12, 1);
+	test_ordering();
+}
@@ -0,0 +1,140 @@
+#include "regressions/regression.h"
+#include <TooN/SymmetricMatrix.h>
+#include <TooN/Cholesky.h>
+#include <TooN/Lapack_Cholesky.h>
+#include <TooN/wls.h>
+using namespace TooN;
+using namespace std;
+
+Matrix<> random_symmetric(int n)
+{
+	Matrix<> m(n, n);
+	for(int r=0; r < n; r++)
+		for(int c=r; c < n; c++)
+			m[r][c] = m[c][r] = xor128d();
+	return m;
+}
+
+//Construction, element access and symv
+template<int Size> void test_basic(int n)
+{
+	Matrix<Size> m = random_symmetric(n);
+	SymmetricMatrix<Size> s(m);
+
+	double err = norm_fro(s.get_matrix() - m);
+	for(int r=0; r < n; r++)
+		for(int c=0; c < n; c++)
+			err += abs(s(r,c) - m[r][c]);
+
+	Vector<Size> v(n);
+	for(int i=0; i < n; i++)
+		v[i] = xor128d();
+	err += norm_inf(s * v - m * v);
+
+	cout << err << endl;
+}
+
+//Rank 1 and rank k updates
+void test_updates(int n, int k)
+{
+	Matrix<> J(k, n);
+	Vector<> w(k);
+	for(int i=0; i < k; i++)
+	{
+		for(int j=0; j < n; j++)
+			J[i][j] = xor128d();
+		w[i] = xor128d() + 1;
+	}
+
+	SymmetricMatrix<> s1(n), s2(n);
+	s1.get_packed() = Zeros;
+	s2.get_packed() = Zeros;
+	for(int i=0; i < k; i++)
+		s1.add_rank_1(J[i], w[i]);
+	s2.add_rank_k(J, w);
+
+	Matrix<> ref = J.T() * diagmult(w, J);
+	cout << norm_fro(s1.get_matrix() - ref) / norm_fro(ref) << " " 
+	     << norm_fro(s2.get_matrix() - ref) / norm_fro(ref) << endl;
+}
+
+//Decomposition of a packed matrix, and use as a WLS prior
+void test_consumers(int n)
+{
+	Matrix<> J(2*n, n);
+	for(int i=0; i < 2*n; i++)
+		for(int j=0; j < n; j++)
+			J[i][j] = xor128d();
+
+	SymmetricMatrix<> s(n);
+	s.get_packed() = Zeros;
+	s.add_rank_k(J, Vector<>(Ones(2*n)));
+	s.add_diagonal(1);
+	Matrix<> m = s.get_matrix();
+
+	Vector<> b(n);
+	for(int i=0; i < n; i++)
+		b[i] = xor128d();
+
+	Cholesky<> chol(s);
+	double err = norm_inf(m * chol.backsub(b) - b);
+
+	WLS<> wls1(n), wls2(n);
+	wls1.add_prior(s);
+	wls2.add_prior(m);
+	for(int i=0; i < n; i++)
+	{
+		wls1.add_mJ(b[i], Vector<>(J[i]));
+		wls2.add_mJ(b[i], Vector<>(J[i]));
+	}
+	wls1.compute();
+	wls2.compute();
+	err += norm_inf(wls1.get_mu() - wls2.get_mu());
+
+	cout << err << endl;
+}
+
+//Lapack_Cholesky factors a packed matrix in packed storage. The results
+//must match those of the full decomposition.
+template<int Size> void test_lapack(int n)
+{
+	Matrix<Dynamic> J(2*n, n);
+	for(int i=0; i < 2*n; i++)
+		for(int j=0; j < n; j++)
+			J[i][j] = xor128d();
+
+	SymmetricMatrix<Size> s(n);
+	s.get_packed() = Zeros;
+	s.add_rank_k(J, Vector<>(Ones(2*n)));
+	s.add_diagonal(1);
+	Matrix<Size> m = s.get_matrix();
+
+	Vector<Size> b(n);
+	Matrix<Size, 3> B(n, 3);
+	for(int i=0; i < n; i++)
+	{
+		b[i] = xor128d();
+		B[i] = makeVector(xor128d(), xor128d(), xor128d());
+	}
+
+	Lapack_Cholesky<Size> packed(s), full(m);
+	double err = norm_inf(m * packed.backsub(b) - b);
+	err = max(err, norm_fro(m * packed.backsub(B) - B));
+	err = max(err, norm_fro(packed.get_L() - full.get_L()));
+	err = max(err, norm_fro(packed.get_inverse() - full.get_inverse()));
+	err = max(err, abs(packed.determinant() / full.determinant() - 1));
+	err = max(err, abs(packed.mahalanobis(b) - full.mahalanobis(b)));
+	cout << err << " " << packed.rank() - n << endl;
+}
+
+int main()
+{
+	test_basic<Dynamic>(1);
+	test_basic<Dynamic>(7);
+	test_basic<4>(4);
+	test_updates(5, 3);
+	test_updates(40, 150);
+	test_consumers(20);
+	test_lapack<Dynamic>(20);
+	test_lapack<4>(4);
+}
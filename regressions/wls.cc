@@ -0,0 +1,175 @@
+#include "regressions/regression.h"
+#include <TooN/wls.h>
+using namespace TooN;
+using namespace std;
+
+//A linear system with known Jacobians and measurements
+struct Measurements
+{
+	Matrix<> J;
+	Vector<> m;
+	Vector<> w;
+
+	Measurements(int n, int size)
+	:J(n, size), m(n), w(n)
+	{
+		for(int i=0; i < n; i++)
+		{
+			for(int j=0; j < size; j++)
+				J[i][j] = xor128d();
+			m[i] = xor128d();
+			w[i] = xor128d() + 1;
+		}
+	}
+
+	template<class W> void operator()(int i, W& wls) const
+	{
+		wls.add_mJ(m[i], Vector<>(J[i]), w[i]);
+	}
+};
+
+//The result of adding all measurements to a single WLS
+Vector<> reference(const Measurements& meas)
+{
+	WLS<> wls(meas.J.num_cols());
+	for(int i=0; i < meas.m.size(); i++)
+		meas(i, wls);
+	wls.add_prior(1);
+	wls.compute();
+	return wls.get_mu();
+}
+
+//Merging WLS systems which hold different measurements
+void test_merge()
+{
+	double err=0;
+	for(int i=0; i < 20; i++)
+	{
+		int size = xor128u() % 20 + 1;
+		Measurements meas(xor128u() % 200 + 1, size);
+		Vector<> ref = reference(meas);
+
+		WLS<> a(size), b(size);
+		for(int j=0; j < meas.m.size(); j++)
+			meas(j, j%3 ? a : b);
+		a.add_prior(1);
+		a += b;
+		a.compute();
+
+		err = max(err, norm(a.get_mu() - ref) / norm(ref));
+	}
+	cout << err << endl;
+}
+
+//Adding measurements in parallel, which is sequential if OpenMP is disabled
+void test_parallel()
+{
+	double err=0;
+	for(int i=0; i < 20; i++)
+	{
+		int size = xor128u() % 20 + 1;
+		Measurements meas(xor128u() % 1000 + 1, size);
+		Vector<> ref = reference(meas);
+
+		WLS<> wls(size);
+		wls.add_prior(1);
+		wls.add_mJ_parallel(0, meas.m.size(), meas);
+		wls.compute();
+
+		err = max(err, norm(wls.get_mu() - ref) / norm(ref));
+	}
+	cout << err << endl;
+}
+
+//Adding a block of measurements at once. The sizes are large enough to
+//cover several tiles.
+void test_block()
+{
+	double err=0;
+	for(int i=0; i < 10; i++)
+	{
+		int size = xor128u() % 300 + 1;
+		Measurements meas(xor128u() % 400 + 1, size);
+		Vector<> ref = reference(meas);
+
+		WLS<> wls(size);
+		wls.add_prior(1);
+		wls.add_mJ_rows(meas.m, meas.J, meas.w);
+		wls.compute();
+
+		err = max(err, norm(wls.get_mu() - ref) / norm(ref));
+	}
+
+	//Static sizes
+	Measurements meas(10, 3);
+	Vector<> ref = reference(meas);
+	WLS<3> wls;
+	wls.add_prior(1);
+	wls.add_mJ_rows(Vector<10>(meas.m), Matrix<10,3>(meas.J), Vector<10>(meas.w));
+	wls.compute();
+	err = max(err, norm(wls.get_mu() - ref) / norm(ref));
+
+	cout << err << endl;
+}
+
+//Sparse Jacobians with two blocks or a list of elements, as in 
+//bundle adjustment.
+void test_sparse()
+{
+	double err_blocks=0, err_pairs=0;
+	for(int i=0; i < 20; i++)
+	{
+		int size = xor128u() % 50 + 12;
+		int n = xor128u() % 200 + 1;
+		Measurements meas(n, size);
+		WLS<> blocks(size), pairs(size);
+
+		for(int j=0; j < n; j++)
+		{
+			//A 6 element block and a 3 element block in random positions
+			int index1 = xor128u() % (size - 9 + 1);
+			int index2 = xor128u() % (size - 9 + 1);
+			if(index2 < index1 + 6 && index1 < index2 + 3)
+				index2 = index1 < size - 9 ? size - 3 : 0;
+
+			Vector<6> J1 = meas.J[j].slice(index1, 6);
+			Vector<3> J2 = meas.J[j].slice(index2, 3);
+			meas.J[j] = Zeros;
+			meas.J[j].slice(index1, 6) = J1;
+			meas.J[j].slice(index2, 3) = J2;
+			blocks.add_sparse_mJ(meas.m[j], J1, index1, J2, index2, meas.w[j]);
+
+			//The same, as a list of elements in a jumbled order
+			Vector<9, int> index;
+			Vector<9> J;
+			for(int k=0; k < 3; k++)
+			{
+				index[k] = index2 + 2 - k;
+				J[k] = J2[2-k];
+			}
+			for(int k=0; k < 6; k++)
+			{
+				index[k+3] = index1 + k;
+				J[k+3] = J1[k];
+			}
+			pairs.add_sparse_mJ(meas.m[j], index, J, meas.w[j]);
+		}
+
+		Vector<> ref = reference(meas);
+		blocks.add_prior(1);
+		blocks.compute();
+		pairs.add_prior(1);
+		pairs.compute();
+		err_blocks = max(err_blocks, norm(blocks.get_mu() - ref) / norm(ref));
+		err_pairs = max(err_pairs, norm(pairs.get_mu() - ref) / norm(ref));
+	}
+	cout << err_blocks << " " << err_pairs << endl;
+}
+
+int main()
+{
+	test_merge();
+	test_parallel();
+	test_block();
+	test_sparse();
+}
@@ -30,9 +30,15 @@
 
 #include <TooN/TooN.h>
 #include <TooN/Cholesky.h>
+#include <TooN/SymmetricMatrix.h>
 #include <TooN/helpers.h>
 
 #include <cmath>
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 namespace TooN {
 
@@ -90,6 +96,18 @@ public:
 		my_C_inv+=m;
 	}
 
+	/// Applies a whole-matrix regularisation term held in packed form.
+	/// Only the upper triangle is updated, since compute() fills in the rest.
+	/// The inverse covariance accumulated by WLS is still a full Matrix.
+	/// @param m The inverse covariance matrix to add
+	template<class P2>
+	void add_prior(const SymmetricMatrix<Size,P2>& m){
+		SizeMismatch<Size,Size>::test(my_C_inv.num_rows(), m.num_rows());
+		for(int r=0; r < my_C_inv.num_rows(); r++)
+			for(int c=r; c < my_C_inv.num_rows(); c++)
+				my_C_inv[r][c] += m(r,c);
+	}
+
 	/// Add a single measurement 
 	/// @param m The value of the measurement
 	/// @param J The Jacobian for the measurement \f$\frac{\partial\text{m}}{\partial\text{param}_i}\f$
@@ -133,6 +151,86 @@ public:
 		my_vector += temp * m;
 	}
 
+	/// Add a block of independent measurements at once. This is equivalent to
+	/// calling add_mJ(m[i], J[i], weight[i]) for each row, but the upper right 
+	/// triangle of the inverse covariance is updated as a symmetric rank-N update
+	/// which is divided in to cache sized tiles, so it is much more efficient for
+	/// large blocks.
+	/// @param m The measurements to add
+	/// @param J The Jacobian matrix, with one row per measurement \f$\frac{\partial\text{m}_i}{\partial\text{param}_j}\f$
+	/// @param weight The inverse variance of each measurement
+	template<int N, class B1, class B2, class B3>
+	inline void add_mJ_rows(const Vector<N,Precision,B1>& m,
+					   const Matrix<N,Size,Precision,B2>& J,
+					   const Vector<N,Precision,B3>& weight){
+		SizeMismatch<N,N>::test(m.size(), J.num_rows());
+		SizeMismatch<N,N>::test(m.size(), weight.size());
+		SizeMismatch<Size,Size>::test(my_C_inv.num_rows(), J.num_cols());
+
+		const int size = my_C_inv.num_rows();
+		const int rows = J.num_rows();
+
+		//Packed copies of a tile of rows of J, and the weighted rows
+		Matrix<Dynamic,Size,Precision> Jt(std::min(rows, row_tile), size);
+		Matrix<Dynamic,Size,Precision> WJ(std::min(rows, row_tile), size);
+
+		for(int k0=0; k0 < rows; k0 += row_tile)
+		{
+			const int kb = std::min(row_tile, rows - k0);
+			for(int k=0; k < kb; k++)
+			{
+				Jt[k] = J[k0+k];
+				WJ[k] = Jt[k] * weight[k0+k];
+				my_vector += WJ[k] * m[k0+k];
+			}
+
+			//Upper triangle of C += WJ^T J, one pair of column tiles at a time
+			//so that the parts of C, WJ and J in use stay in cache. Four rows
+			//of C are updated together, so each element of J is loaded once
+			//for four updates. This writes a few elements just below the 
+			//diagonal, which is harmless since the lower triangle is unused.
+			const int stride = my_C_inv.num_cols();
+			for(int i0=0; i0 < size; i0 += col_tile)
+			{
+				const int ib = std::min(col_tile, size - i0);
+				for(int j0=i0; j0 < size; j0 += col_tile)
+				{
+					const int jb = std::min(col_tile, size - j0);
+					int i=i0;
+					for(; i+4 <= i0+ib; i+=4)
+					{
+						Precision* const C = &my_C_inv[i][0];
+						const int j_start = std::max(i, j0);
+						for(int k=0; k < kb; k++)
+						{
+							const Precision a0 = WJ[k][i], a1 = WJ[k][i+1], a2 = WJ[k][i+2], a3 = WJ[k][i+3];
+							const Precision* const Jk = &Jt[k][0];
+							for(int j=j_start; j < j0 + jb; j++)
+							{
+								const Precision x = Jk[j];
+								C[j] += a0 * x;
+								C[j + stride] += a1 * x;
+								C[j + 2*stride] += a2 * x;
+								C[j + 3*stride] += a3 * x;
+							}
+						}
+					}
+					for(; i < i0+ib; i++)
+					{
+						Precision* const C = &my_C_inv[i][0];
+						for(int k=0; k < kb; k++)
+						{
+							const Precision a = WJ[k][i];
+							const Precision* const Jk = &Jt[k][0];
+							for(int j=std::max(i, j0); j < j0 + jb; j++)
+								C[j] += a * Jk[j];
+						}
+					}
+				}
+			}
+		}
+	}
+
 	/// Add a single measurement at once with a sparse Jacobian (much, much more efficiently)
 	/// @param m The measurements to add
 	/// @param J1 The first block of the Jacobian matrix \f$\frac{\partial\text{m}_i}{\partial\text{param}_j}\f$
@@ -152,6 +250,63 @@ public:
 		}
 	}
 
+	/// Add a single measurement with a Jacobian which is zero except for two
+	/// blocks, such as a camera and a point in bundle adjustment. Only the 
+	/// affected parts of the inverse covariance are updated, so the cost 
+	/// depends on the size of the blocks, not the size of the system.
+	/// The blocks must not overlap.
+	/// @param m The measurement to add
+	/// @param J1 The first block of the Jacobian \f$\frac{\partial\text{m}}{\partial\text{param}_j}\f$
+	/// @param index1 starting index for the first block
+	/// @param J2 The second block of the Jacobian
+	/// @param index2 starting index for the second block
+	/// @param weight The inverse variance of the measurement (default = 1)
+	template<int N1, int N2, typename B1, typename B2>
+	inline void add_sparse_mJ(const Precision m,
+					   const Vector<N1,Precision,B1>& J1, const int index1,
+					   const Vector<N2,Precision,B2>& J2, const int index2,
+					   const Precision weight = 1){
+		add_sparse_mJ(m, J1, index1, weight);
+		add_sparse_mJ(m, J2, index2, weight);
+
+		//The block of the upper right triangle coupling J1 and J2
+		for(int r=0; r < J1.size(); r++)
+		{
+			const Precision Jw = weight * J1[r];
+			for(int c=0; c < J2.size(); c++)
+				if(index1 < index2)
+					my_C_inv[r+index1][c+index2] += Jw * J2[c];
+				else
+					my_C_inv[c+index2][r+index1] += Jw * J2[c];
+		}
+	}
+
+	/// Add a single measurement with a Jacobian given as a list of nonzero 
+	/// elements. Only the affected elements of the inverse covariance are
+	/// updated, so the cost is \f$O(N^2)\f$ in the number of nonzero elements.
+	/// The indices must be distinct, but need not be sorted.
+	/// @param m The measurement to add
+	/// @param index The indices of the nonzero elements of the Jacobian
+	/// @param J The nonzero elements of the Jacobian, \f$\frac{\partial\text{m}}{\partial\text{param}_{\text{index}_i}}\f$
+	/// @param weight The inverse variance of the measurement (default = 1)
+	template<int N, typename B1, typename B2>
+	inline void add_sparse_mJ(const Precision m,
+					   const Vector<N,int,B1>& index,
+					   const Vector<N,Precision,B2>& J,
+					   const Precision weight = 1){
+		SizeMismatch<N,N>::test(index.size(), J.size());
+
+		//Upper right triangle only, for speed
+		for(int r=0; r < J.size(); r++)
+		{
+			const Precision Jw = weight * J[r];
+			my_vector[index[r]] += m * Jw;
+			for(int c=0; c < J.size(); c++)
+				if(index[r] <= index[c])
+					my_C_inv[index[r]][index[c]] += Jw * J[c];
+		}
+	}
+
 	/// Add multiple measurements at once with a sparse Jacobian (much, much more efficiently)
 	/// @param m The measurements to add
 	/// @param J1 The first block of the Jacobian matrix \f$\frac{\partial\text{m}_i}{\partial\text{param}_j}\f$
@@ -205,11 +360,60 @@ public:
 		my_mu=my_decomposition.backsub(my_vector);
 	}
 
+	/// Combine measurements from two WLS systems. Only the upper right
+	/// triangle of the inverse covariance matrix is used, as with add_mJ().
+	/// @param meas The measurements to combine with
+	void merge(const WLS& meas){
+		SizeMismatch<Size,Size>::test(my_C_inv.num_rows(), meas.my_C_inv.num_rows());
+		my_vector+=meas.my_vector;
+		for(int r=0; r < my_C_inv.num_rows(); r++)
+			my_C_inv[r].slice(r, my_C_inv.num_cols()-r) += meas.my_C_inv[r].slice(r, my_C_inv.num_cols()-r);
+	}
+
 	/// Combine measurements from two WLS systems
 	/// @param meas The measurements to combine with
 	void operator += (const WLS& meas){
-		my_vector+=meas.my_vector;
-		my_C_inv += meas.my_C_inv;
+		merge(meas);
+	}
+
+	/// Add a range of measurements, in parallel if OpenMP is enabled.
+	/// Each thread accumulates measurements in to its own WLS, and these 
+	/// are merged in to this one at the end. The work is divided between 
+	/// threads statically, so for a given number of threads, the result
+	/// does not depend on the timing.
+	///
+	/// The function is called as <code>f(i, wls)</code> for each \e i in
+	/// <code>[begin, end)</code> and should add the measurements for \e i
+	/// to \e wls using add_mJ() or similar. It is called concurrently from
+	/// different threads, so it must not modify any shared state.
+	/// @param begin Index of the first measurement
+	/// @param end One past the index of the last measurement
+	/// @param f The function which adds a measurement
+	template<class Func>
+	void add_mJ_parallel(int begin, int end, const Func& f){
+		#ifdef _OPENMP
+			const int threads = std::min(omp_get_max_threads(), end - begin);
+			if(threads > 1)
+			{
+				std::vector<WLS> partial(threads, WLS(my_C_inv.num_rows()));
+
+				#pragma omp parallel num_threads(threads)
+				{
+					WLS& local = partial[omp_get_thread_num()];
+
+					#pragma omp for schedule(static)
+					for(int i=begin; i < end; i++)
+						f(i, local);
+				}
+
+				for(int t=0; t < threads; t++)
+					merge(partial[t]);
+				return;
+			}
+		#endif
+
+		for(int i=begin; i < end; i++)
+			f(i, *this);
 	}
 
 	/// Returns the inverse covariance matrix
@@ -225,6 +429,9 @@ public:
 
 
 private:
+	static const int row_tile = 64;  ///< Number of measurements processed together by add_mJ_rows()
+	static const int col_tile = 128; ///< Number of parameters processed together by add_mJ_rows()
+
 	Matrix<Size,Size,Precision> my_C_inv;
 	Vector<Size,Precision> my_vector;
 	Decomposition<Size,Precision> my_decomposition;
@@ -235,6 +442,12 @@ private:
 	// int operator = ( WLS& copyof );
 };
 
+template <int Size, class Precision, template<int DecompSize, class DecompPrecision> class Decomposition>
+const int WLS<Size, Precision, Decomposition>::row_tile;
+
+template <int Size, class Precision, template<int DecompSize, class DecompPrecision> class Decomposition>
+const int WLS<Size, Precision, Decomposition>::col_tile;
+
 }
 
 #endif